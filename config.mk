@@ -22,6 +22,9 @@ CC = cc
 WRN_FLAGS = -std=c99 -Wall -Wextra -Wpedantic
 
 # How much to optimize the generated code.
+#
+# TIP: Add `-mavx2` (or `-march=native`) to render text with AVX2 instead of
+# SSE2 on x86-64 hosts that support it.
 OPT_FLAGS = -DNDEBUG -O3
 
 # How to instruct the compiler to generate a make-compliant ".d" dependency-
@@ -1,17 +1,46 @@
+src/bpcond.o: src/bpcond.c src/bpcond.h src/errors.h src/cpu.h \
+ src/timing.h
+src/checkpt.o: src/checkpt.c src/checkpt.h src/errors.h src/cpu.h \
+ src/bpcond.h src/timing.h src/memory.h
 src/concur.o: src/concur.c src/concur.h src/errors.h
-src/cpu.o: src/cpu.c src/cpu.h src/errors.h src/concur.h src/memory.h \
- src/ops.h
-src/cuss.o: src/cuss.c src/concur.h src/errors.h src/cpu.h src/logger.h \
- src/memory.h src/monitor.h src/sdlmonio.h src/sdlui.h
+src/cpu.o: src/cpu.c src/cpu.h src/bpcond.h src/errors.h src/timing.h \
+ src/checkpt.h src/concur.h src/memory.h src/ops.h src/pipeline.h \
+ src/stbuf.h
 src/errors.o: src/errors.c src/errors.h
 src/logger.o: src/logger.c src/logger.h
-src/memory.o: src/memory.c src/memory.h src/errors.h src/logger.h
-src/monitor.o: src/monitor.c src/monitor.h src/errors.h src/cpu.h \
- src/memory.h src/opdec.h
-src/opdec.o: src/opdec.c src/opdec.h
-src/ops.o: src/ops.c src/ops.h src/errors.h src/cpu.h src/memory.h
+src/memory.o: src/memory.c src/memory.h src/errors.h src/concur.h \
+ src/logger.h
+src/opdec.o: src/opdec.c src/opdec.h src/opcodes.h
+src/openc.o: src/openc.c src/openc.h src/errors.h src/opcodes.h
+src/ops.o: src/ops.c src/ops.h src/cpu.h src/bpcond.h src/errors.h \
+ src/timing.h src/concur.h src/memory.h src/opcodes.h src/stbuf.h
+src/pipeline.o: src/pipeline.c src/pipeline.h src/timing.h
+src/stbuf.o: src/stbuf.c src/stbuf.h src/errors.h src/memory.h
+src/symtab.o: src/symtab.c src/symtab.h src/errors.h
+src/timing.o: src/timing.c src/timing.h
+src/sdldisp.o: src/sdldisp.c src/sdldisp.h src/errors.h src/memory.h \
+ src/sdltxt.h
 src/sdlmonio.o: src/sdlmonio.c src/sdlmonio.h src/errors.h src/concur.h \
  src/logger.h src/sdltxt.h
 src/sdltxt.o: src/sdltxt.c src/sdltxt.h src/errors.h
-src/sdlui.o: src/sdlui.c src/sdlui.h src/errors.h src/logger.h \
+src/cuss.o: src/cuss.c src/checkpt.h src/errors.h src/concur.h src/cpu.h \
+ src/bpcond.h src/timing.h src/gdbstub.h src/logger.h src/memory.h \
+ src/monitor.h src/pipeline.h src/sdlmonio.h src/sdlui.h src/symtab.h
+src/gdbstub.o: src/gdbstub.c src/gdbstub.h src/errors.h src/checkpt.h \
+ src/cpu.h src/bpcond.h src/timing.h src/logger.h src/memory.h
+src/monitor.o: src/monitor.c src/monitor.h src/errors.h src/checkpt.h \
+ src/concur.h src/cpu.h src/bpcond.h src/timing.h src/logger.h \
+ src/memory.h src/opdec.h src/pipeline.h src/symtab.h
+src/sdlui.o: src/sdlui.c src/sdlui.h src/errors.h src/concur.h src/cpu.h \
+ src/bpcond.h src/timing.h src/logger.h src/memory.h src/sdldisp.h \
  src/sdlmonio.h src/sdltxt.h
+src/lockstep.o: src/lockstep.c src/cpu.h src/bpcond.h src/errors.h \
+ src/timing.h src/logger.h src/memory.h src/opdec.h src/openc.h src/ops.h \
+ src/refcup.h
+src/refcup.o: src/refcup.c src/refcup.h src/cpu.h src/bpcond.h \
+ src/errors.h src/timing.h src/memory.h
+src/microbench.o: src/microbench.c src/cpu.h src/bpcond.h src/errors.h \
+ src/timing.h src/logger.h src/memory.h src/opdec.h src/ops.h \
+ src/sdlmonio.h src/sdltxt.h
+src/cupasm.o: src/cupasm.c src/errors.h src/logger.h src/openc.h \
+ src/timing.h
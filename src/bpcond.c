@@ -0,0 +1,293 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "bpcond.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+// The maximum depth of the evaluation-stack.
+#define MAX_STACK_DEPTH 8
+
+// The instructions of the bytecode. Operands are pushed onto the stack and
+// operators replace their operands on the stack with their result.
+typedef enum {
+    // Followed by the register-number.
+    OP_REG = 1,
+    // Followed by the four little-endian bytes of the number.
+    OP_IMM,
+    OP_PC,
+    OP_PSR,
+    OP_EP,
+    OP_HITS,
+    OP_VAL,
+    OP_OLD,
+    OP_NOT,
+    OP_BIT_AND,
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_AND,
+    OP_OR,
+} BpOp;
+
+typedef struct Compiler {
+    const char* p;
+    CuBpCond* cond;
+    int depth;
+} Compiler;
+
+static bool ParseOr(Compiler* restrict c, CuError* restrict err);
+
+static bool Emit(Compiler* restrict c, uint8_t byte, CuError* restrict err) {
+    if (c->cond->len >= CU_BP_COND_MAX_CODE) {
+        return CuErrMsg(err, "Condition too long.");
+    }
+    c->cond->code[c->cond->len++] = byte;
+    return true;
+}
+
+static bool EmitOperand(Compiler* restrict c, BpOp op, CuError* restrict err) {
+    if (++c->depth > MAX_STACK_DEPTH) {
+        return CuErrMsg(err, "Condition too deeply nested.");
+    }
+    return Emit(c, (uint8_t)op, err);
+}
+
+static bool EmitOperator(Compiler* restrict c, BpOp op, CuError* restrict err) {
+    c->depth--;
+    return Emit(c, (uint8_t)op, err);
+}
+
+// Skip white-space and consume `tok` if it comes next.
+static bool Match(Compiler* restrict c, const char* restrict tok) {
+    while (isspace((unsigned char)*c->p)) {
+        c->p++;
+    }
+    const size_t len = strlen(tok);
+    if (strncmp(c->p, tok, len) != 0) {
+        return false;
+    }
+    c->p += len;
+    return true;
+}
+
+static bool ParseName(Compiler* restrict c, CuError* restrict err) {
+    const char* start = c->p;
+    while (isalnum((unsigned char)*c->p) || *c->p == '_') {
+        c->p++;
+    }
+    const size_t len = (size_t)(c->p - start);
+
+    static const struct {
+        const char* name;
+        BpOp op;
+    } names[] = {
+        {"pc", OP_PC}, {"psr", OP_PSR}, {"ep", OP_EP}, {"hits", OP_HITS},
+        {"val", OP_VAL}, {"old", OP_OLD},
+    };
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; i++) {
+        if (strlen(names[i].name) == len &&
+          strncmp(start, names[i].name, len) == 0) {
+            return EmitOperand(c, names[i].op, err);
+        }
+    }
+    if (len >= 2 && len <= 3 && start[0] == 'r' &&
+      isdigit((unsigned char)start[1]) &&
+      (len == 2 || isdigit((unsigned char)start[2]))) {
+        const int r = atoi(start + 1);
+        if (r < CU_NUM_IREGS) {
+            RET_ON_ERR(EmitOperand(c, OP_REG, err));
+            return Emit(c, (uint8_t)r, err);
+        }
+    }
+    return CuErrMsg(err, "Unknown name '%.*s' in condition.", (int)len, start);
+}
+
+static bool ParseUnary(Compiler* restrict c, CuError* restrict err) {
+    if (Match(c, "!")) {
+        RET_ON_ERR(ParseUnary(c, err));
+        return Emit(c, OP_NOT, err);
+    }
+    if (Match(c, "(")) {
+        RET_ON_ERR(ParseOr(c, err));
+        if (!Match(c, ")")) {
+            return CuErrMsg(err, "Missing ')' in condition.");
+        }
+        return true;
+    }
+    if (isdigit((unsigned char)*c->p)) {
+        char* end = NULL;
+        const unsigned long long val = strtoull(c->p, &end, 0);
+        if (val > UINT32_MAX) {
+            return CuErrMsg(err, "Number too large in condition.");
+        }
+        c->p = end;
+        RET_ON_ERR(EmitOperand(c, OP_IMM, err));
+        for (int i = 0; i < 4; i++) {
+            RET_ON_ERR(Emit(c, (uint8_t)(val >> (8 * i)), err));
+        }
+        return true;
+    }
+    if (isalpha((unsigned char)*c->p)) {
+        return ParseName(c, err);
+    }
+    if (*c->p == '\0') {
+        return CuErrMsg(err, "Incomplete condition.");
+    }
+    return CuErrMsg(err, "Unexpected '%c' in condition.", *c->p);
+}
+
+static bool ParseBitAnd(Compiler* restrict c, CuError* restrict err) {
+    RET_ON_ERR(ParseUnary(c, err));
+    for (;;) {
+        if (!Match(c, "&")) {
+            return true;
+        }
+        if (*c->p == '&') {
+            // This is a logical AND, not a bit-wise AND.
+            c->p--;
+            return true;
+        }
+        RET_ON_ERR(ParseUnary(c, err));
+        RET_ON_ERR(EmitOperator(c, OP_BIT_AND, err));
+    }
+}
+
+static bool ParseCmp(Compiler* restrict c, CuError* restrict err) {
+    RET_ON_ERR(ParseBitAnd(c, err));
+
+    // Two-character operators must be matched before their prefixes.
+    static const struct {
+        const char* tok;
+        BpOp op;
+    } cmps[] = {
+        {"==", OP_EQ}, {"!=", OP_NE}, {"<=", OP_LE}, {">=", OP_GE},
+        {"<", OP_LT}, {">", OP_GT},
+    };
+    for (size_t i = 0; i < sizeof cmps / sizeof cmps[0]; i++) {
+        if (Match(c, cmps[i].tok)) {
+            RET_ON_ERR(ParseBitAnd(c, err));
+            return EmitOperator(c, cmps[i].op, err);
+        }
+    }
+    return true;
+}
+
+static bool ParseAnd(Compiler* restrict c, CuError* restrict err) {
+    RET_ON_ERR(ParseCmp(c, err));
+    while (Match(c, "&&")) {
+        RET_ON_ERR(ParseCmp(c, err));
+        RET_ON_ERR(EmitOperator(c, OP_AND, err));
+    }
+    return true;
+}
+
+static bool ParseOr(Compiler* restrict c, CuError* restrict err) {
+    RET_ON_ERR(ParseAnd(c, err));
+    while (Match(c, "||")) {
+        RET_ON_ERR(ParseAnd(c, err));
+        RET_ON_ERR(EmitOperator(c, OP_OR, err));
+    }
+    return true;
+}
+
+bool CuCompileBpCond(const char* restrict src, CuBpCond* restrict cond,
+  CuError* restrict err) {
+    if (cond == NULL) {
+        return CuErrMsg(err, "NULL `cond`.");
+    }
+    cond->len = 0;
+    if (src == NULL) {
+        return true;
+    }
+    Compiler c = {.p = src, .cond = cond, .depth = 0};
+    if (Match(&c, "") && *c.p == '\0') {
+        return true;
+    }
+    if (!ParseOr(&c, err)) {
+        cond->len = 0;
+        return false;
+    }
+    if (Match(&c, "") && *c.p != '\0') {
+        cond->len = 0;
+        return CuErrMsg(err, "Unexpected '%c' in condition.", *c.p);
+    }
+    return true;
+}
+
+bool CuEvalBpCond(const CuBpCond* restrict cond,
+  const CuBpCondCtx* restrict ctx) {
+    if (cond->len == 0) {
+        return true;
+    }
+    uint64_t stack[MAX_STACK_DEPTH];
+    int sp = -1;
+    const uint8_t* code = cond->code;
+    const uint8_t* end = code + cond->len;
+    while (code < end) {
+        switch ((BpOp)*code++) {
+          case OP_REG:
+            stack[++sp] = ctx->core->iregs[*code++];
+            break;
+
+          case OP_IMM:
+            stack[++sp] = (uint64_t)code[0] | ((uint64_t)code[1] << 8) |
+              ((uint64_t)code[2] << 16) | ((uint64_t)code[3] << 24);
+            code += 4;
+            break;
+
+          case OP_PC:
+            stack[++sp] = ctx->core->pc;
+            break;
+
+          case OP_PSR:
+            stack[++sp] = ctx->core->psr;
+            break;
+
+          case OP_EP:
+            stack[++sp] = ctx->core->epr;
+            break;
+
+          case OP_HITS:
+            stack[++sp] = ctx->hits;
+            break;
+
+          case OP_VAL:
+            stack[++sp] = ctx->val;
+            break;
+
+          case OP_OLD:
+            stack[++sp] = ctx->old;
+            break;
+
+          case OP_NOT:
+            stack[sp] = !stack[sp];
+            break;
+
+#define BINARY_OP(op, expr) \
+          case op: \
+            sp--; \
+            stack[sp] = (expr); \
+            break;
+
+          BINARY_OP(OP_BIT_AND, stack[sp] & stack[sp + 1])
+          BINARY_OP(OP_EQ, stack[sp] == stack[sp + 1])
+          BINARY_OP(OP_NE, stack[sp] != stack[sp + 1])
+          BINARY_OP(OP_LT, stack[sp] < stack[sp + 1])
+          BINARY_OP(OP_LE, stack[sp] <= stack[sp + 1])
+          BINARY_OP(OP_GT, stack[sp] > stack[sp + 1])
+          BINARY_OP(OP_GE, stack[sp] >= stack[sp + 1])
+          BINARY_OP(OP_AND, stack[sp] && stack[sp + 1])
+          BINARY_OP(OP_OR, stack[sp] || stack[sp + 1])
+#undef BINARY_OP
+        }
+    }
+    return stack[0] != 0;
+}
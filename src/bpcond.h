@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_BPCOND_INCLUDED
+#define CUSS_BPCOND_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "errors.h"
+
+// Conditions on break-points and watch-points, such as "r3 == 0x10 && hits >
+// 1000", compiled once into a tiny stack-based bytecode that is evaluated
+// every time the break-point or the watch-point is hit.
+//
+// The operands are the registers `r0`-`r31`, `pc`, `psr`, and `ep`, unsigned
+// numbers, `hits` (how many times the break-point or the watch-point has been
+// hit, including this time), and, for watch-points, `val` and `old` (the new
+// and the old value at the watched location). The operators, from the lowest
+// to the highest precedence, are `||`, `&&`, the comparisons `==`, `!=`, `<`,
+// `<=`, `>`, and `>=` (all unsigned), `&`, and `!`, along with parentheses.
+
+// The maximum length of the source-text and of the bytecode of a condition.
+#define CU_BP_COND_MAX_SRC 64
+#define CU_BP_COND_MAX_CODE 96
+
+typedef struct CuBpCond {
+    // No bytecode means that the condition is always true.
+    uint8_t len;
+    uint8_t code[CU_BP_COND_MAX_CODE];
+} CuBpCond;
+
+struct CuCore;
+
+// The core whose registers are the operands, and the values of the operands
+// that are not registers.
+typedef struct CuBpCondCtx {
+    const struct CuCore* core;
+    uint64_t hits;
+    uint32_t val;
+    uint32_t old;
+} CuBpCondCtx;
+
+// Compile `src` into `cond`, with an empty or NULL `src` always being true.
+extern bool CuCompileBpCond(const char* restrict src, CuBpCond* restrict cond,
+  CuError* restrict err);
+
+extern bool CuEvalBpCond(const CuBpCond* restrict cond,
+  const CuBpCondCtx* restrict ctx);
+
+#endif  // CUSS_BPCOND_INCLUDED
@@ -0,0 +1,296 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "checkpt.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "memory.h"
+
+// The maximum number of checkpoints kept at a time, regardless of the budget.
+#define MAX_CKPTS 1024
+
+typedef struct Checkpoint {
+    // The number of instructions executed as of this checkpoint.
+    uint64_t insns;
+    uint32_t iregs[CU_NUM_IREGS];
+    uint32_t pc;
+    uint32_t psr;
+    uint32_t epr;
+    bool resv_valid;
+    uint32_t resv_addr;
+    uint32_t resv_val;
+    CuTimCounters tim;
+    // Re-executing from here counts the hits of break-points and watch-points
+    // on top of these, so that their conditions see the same hit-counts as
+    // when the instructions were first executed.
+    CuPointHits hits;
+    // Pages written to since this checkpoint have a write-generation of at
+    // least this.
+    uint32_t gen;
+    // The (ascending) numbers and the contents of the pages written to since
+    // the previous checkpoint.
+    uint32_t num_pages;
+    uint32_t* page_nums;
+    uint8_t* page_data;
+} Checkpoint;
+
+// The first checkpoint is the oldest one, whose memory is in `base_mem`.
+static Checkpoint ckpts[MAX_CKPTS];
+static int num_ckpts = 0;
+static uint8_t* base_mem = NULL;
+
+static uint64_t ckpt_interval = 0;
+static size_t ckpt_budget = 0;
+static size_t ckpt_bytes = 0;
+
+static void SaveRegs(Checkpoint* restrict ckpt) {
+    CuError nerr;
+    for (int i = 0; i < CU_NUM_IREGS; i++) {
+        CuGetIntReg((uint8_t)i, &ckpt->iregs[i], &nerr);
+    }
+    ckpt->pc = CuGetProgCtr();
+    ckpt->psr = CuGetProcStatReg();
+    ckpt->epr = CuGetExtPrecReg();
+    ckpt->insns = CuGetCpuInsnCount();
+    // Checkpoints are only supported with a single core.
+    const CuCore* core = CuGetCore(0);
+    ckpt->resv_valid = core->resv_valid;
+    ckpt->resv_addr = core->resv_addr;
+    ckpt->resv_val = core->resv_val;
+    ckpt->tim = core->tim;
+    CuGetPointHits(&ckpt->hits);
+}
+
+static bool RestoreRegs(const Checkpoint* restrict ckpt,
+  CuError* restrict err) {
+    for (int i = 0; i < CU_NUM_IREGS; i++) {
+        RET_ON_ERR(CuSetIntReg((uint8_t)i, ckpt->iregs[i], err));
+    }
+    RET_ON_ERR(CuSetProgCtr(ckpt->pc, err));
+    CuSetProcStatReg(ckpt->psr);
+    CuSetExtPrecReg(ckpt->epr);
+    CuSetCpuInsnCount(ckpt->insns);
+    CuCore* core = CuGetCore(0);
+    core->resv_valid = ckpt->resv_valid;
+    core->resv_addr = ckpt->resv_addr;
+    core->resv_val = ckpt->resv_val;
+    core->tim = ckpt->tim;
+    // Memory has already been restored, for the values at watch-points.
+    CuSetPointHits(&ckpt->hits);
+    return true;
+}
+
+static void FreePages(Checkpoint* restrict ckpt) {
+    ckpt_bytes -= (size_t)ckpt->num_pages * (CU_MEM_PAGE_SIZE + 4U);
+    free(ckpt->page_nums);
+    free(ckpt->page_data);
+    ckpt->num_pages = 0;
+    ckpt->page_nums = NULL;
+    ckpt->page_data = NULL;
+}
+
+// Merge the oldest checkpoint into the one after it.
+static void DropOldest(void) {
+    Checkpoint* next = &ckpts[1];
+    for (uint32_t i = 0; i < next->num_pages; i++) {
+        memcpy(base_mem + ((size_t)next->page_nums[i] << CU_MEM_PAGE_SHIFT),
+          next->page_data + (size_t)i * CU_MEM_PAGE_SIZE, CU_MEM_PAGE_SIZE);
+    }
+    FreePages(next);
+    memmove(&ckpts[0], &ckpts[1], (num_ckpts - 1) * sizeof ckpts[0]);
+    num_ckpts--;
+}
+
+// Drop the checkpoints after the `k`th one.
+static void DropAfter(int k) {
+    while (num_ckpts > k + 1) {
+        FreePages(&ckpts[--num_ckpts]);
+    }
+}
+
+// Find the contents of `page` as of the `k`th checkpoint.
+static const uint8_t* FindPage(int k, uint32_t page) {
+    for (int j = k; j > 0; j--) {
+        const Checkpoint* ckpt = &ckpts[j];
+        uint32_t lo = 0;
+        uint32_t hi = ckpt->num_pages;
+        while (lo < hi) {
+            const uint32_t mid = lo + (hi - lo) / 2;
+            if (ckpt->page_nums[mid] < page) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo < ckpt->num_pages && ckpt->page_nums[lo] == page) {
+            return ckpt->page_data + (size_t)lo * CU_MEM_PAGE_SIZE;
+        }
+    }
+    return base_mem + ((size_t)page << CU_MEM_PAGE_SHIFT);
+}
+
+// Restore the state as of the `k`th checkpoint, dropping the later ones.
+static bool Restore(int k, CuError* restrict err) {
+    DropAfter(k);
+    Checkpoint* ckpt = &ckpts[k];
+    const uint32_t num_pages = CuGetMemSize() >> CU_MEM_PAGE_SHIFT;
+    for (uint32_t p = 0; p < num_pages; p++) {
+        if (CuGetPageWriteGen(p) >= ckpt->gen) {
+            RET_ON_ERR(CuWriteMemRange(p << CU_MEM_PAGE_SHIFT,
+              CU_MEM_PAGE_SIZE, FindPage(k, p), err));
+        }
+    }
+    RET_ON_ERR(RestoreRegs(ckpt, err));
+
+    // The restored pages are now as of this checkpoint.
+    ckpt->gen = CuNextMemWriteGen();
+    CuSetCpuNextCkpt(ckpt->insns + ckpt_interval);
+    return true;
+}
+
+// Find the latest checkpoint at or before `insns` instructions.
+static int FindCkpt(uint64_t insns) {
+    int k = num_ckpts - 1;
+    while (k >= 0 && ckpts[k].insns > insns) {
+        k--;
+    }
+    return k;
+}
+
+bool CuCkptSetUp(uint64_t interval, size_t budget, CuError* restrict err) {
+    if (interval == 0) {
+        return CuErrMsg(err, "Zero checkpoint-interval.");
+    }
+    if (CuGetNumCores() > 1) {
+        return CuErrMsg(err, "Checkpoints need a single core.");
+    }
+    const uint32_t mem_size = CuGetMemSize();
+    if (budget < mem_size) {
+        return CuErrMsg(err, "Checkpoint-budget less than memory-size.");
+    }
+    base_mem = malloc(mem_size);
+    if (base_mem == NULL) {
+        return CuErrMsg(err, "Could not allocate memory for checkpoints.");
+    }
+    RET_ON_ERR(CuReadMemRange(0, mem_size, base_mem, err));
+    ckpt_interval = interval;
+    ckpt_budget = budget;
+    ckpt_bytes = mem_size;
+
+    Checkpoint* ckpt = &ckpts[0];
+    memset(ckpt, 0, sizeof *ckpt);
+    SaveRegs(ckpt);
+    ckpt->gen = CuNextMemWriteGen();
+    num_ckpts = 1;
+    CuSetCpuNextCkpt(ckpt->insns + ckpt_interval);
+    return true;
+}
+
+bool CuCkptIsEnabled(void) {
+    return num_ckpts > 0;
+}
+
+bool CuCkptTake(CuError* restrict err) {
+    if (num_ckpts == 0) {
+        return CuErrMsg(err, "Checkpoints not set up.");
+    }
+    if (num_ckpts == MAX_CKPTS) {
+        DropOldest();
+    }
+    const uint32_t gen = ckpts[num_ckpts - 1].gen;
+    const uint32_t num_mem_pages = CuGetMemSize() >> CU_MEM_PAGE_SHIFT;
+    uint32_t num_pages = 0;
+    for (uint32_t p = 0; p < num_mem_pages; p++) {
+        if (CuGetPageWriteGen(p) >= gen) {
+            num_pages++;
+        }
+    }
+
+    Checkpoint* ckpt = &ckpts[num_ckpts];
+    memset(ckpt, 0, sizeof *ckpt);
+    if (num_pages > 0) {
+        ckpt->page_nums = malloc(num_pages * sizeof ckpt->page_nums[0]);
+        ckpt->page_data = malloc((size_t)num_pages * CU_MEM_PAGE_SIZE);
+        if (ckpt->page_nums == NULL || ckpt->page_data == NULL) {
+            free(ckpt->page_nums);
+            free(ckpt->page_data);
+            memset(ckpt, 0, sizeof *ckpt);
+            return CuErrMsg(err, "Could not allocate memory for checkpoint.");
+        }
+        for (uint32_t p = 0; p < num_mem_pages; p++) {
+            if (CuGetPageWriteGen(p) < gen) {
+                continue;
+            }
+            if (!CuReadMemRange(p << CU_MEM_PAGE_SHIFT, CU_MEM_PAGE_SIZE,
+              ckpt->page_data + (size_t)ckpt->num_pages * CU_MEM_PAGE_SIZE,
+              err)) {
+                free(ckpt->page_nums);
+                free(ckpt->page_data);
+                memset(ckpt, 0, sizeof *ckpt);
+                return false;
+            }
+            ckpt->page_nums[ckpt->num_pages++] = p;
+        }
+    }
+    SaveRegs(ckpt);
+    ckpt->gen = CuNextMemWriteGen();
+    num_ckpts++;
+    ckpt_bytes += (size_t)num_pages * (CU_MEM_PAGE_SIZE + 4U);
+    while (ckpt_bytes > ckpt_budget && num_ckpts > 1) {
+        DropOldest();
+    }
+    CuSetCpuNextCkpt(ckpt->insns + ckpt_interval);
+    return true;
+}
+
+bool CuReverseStep(uint64_t n, CuError* restrict err) {
+    if (num_ckpts == 0) {
+        return CuErrMsg(err, "Checkpoints not enabled.");
+    }
+    const uint64_t insns = CuGetCpuInsnCount();
+    if (n > insns - ckpts[0].insns) {
+        return CuErrMsg(err, "Cannot go back beyond the oldest checkpoint "
+          "(at %" PRIu64 " instructions).", ckpts[0].insns);
+    }
+    const uint64_t target = insns - n;
+    RET_ON_ERR(Restore(FindCkpt(target), err));
+    uint64_t last_stop;
+    return CuReplayCpu(target, &last_stop, err);
+}
+
+bool CuReverseContinue(bool* restrict found, CuError* restrict err) {
+    if (num_ckpts == 0) {
+        return CuErrMsg(err, "Checkpoints not enabled.");
+    }
+    const uint64_t insns = CuGetCpuInsnCount();
+    *found = false;
+    if (insns == ckpts[0].insns) {
+        return true;
+    }
+
+    // Search backwards one interval between checkpoints at a time, for the
+    // latest stop before the current point.
+    uint64_t end = insns - 1;
+    for (int k = FindCkpt(end); k >= 0; k--) {
+        uint64_t last_stop;
+        RET_ON_ERR(Restore(k, err));
+        RET_ON_ERR(CuReplayCpu(end, &last_stop, err));
+        if (last_stop != CU_CPU_NO_STOP) {
+            *found = true;
+            RET_ON_ERR(Restore(k, err));
+            return CuReplayCpu(last_stop, &last_stop, err);
+        }
+        end = ckpts[k].insns;
+    }
+    return Restore(0, err);
+}
+
+void CuCkptGetStats(CuCkptStats* restrict stats) {
+    stats->num_ckpts = num_ckpts;
+    stats->num_bytes = ckpt_bytes;
+    stats->oldest_insns = (num_ckpts == 0) ? 0 : ckpts[0].insns;
+    stats->latest_insns = (num_ckpts == 0) ? 0 : ckpts[num_ckpts - 1].insns;
+}
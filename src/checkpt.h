@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_CHECKPT_INCLUDED
+#define CUSS_CHECKPT_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errors.h"
+
+// Checkpoints of the state of CUP taken periodically while executing, so that
+// the execution can be reversed by restoring an earlier checkpoint and then
+// deterministically re-executing instructions up to the desired point.
+//
+// The oldest checkpoint holds a copy of the whole of memory. Every later
+// checkpoint only holds the pages of memory written to since the checkpoint
+// before it. When the checkpoints need more memory than their budget, the
+// oldest checkpoint is merged into the one after it.
+//
+// NOTE: Changes to registers or memory made from the Monitor or from GDB are
+// not part of the re-executed history.
+
+typedef struct CuCkptStats {
+    int num_ckpts;
+    size_t num_bytes;
+    // The instruction-counts of the oldest and the latest checkpoints.
+    uint64_t oldest_insns;
+    uint64_t latest_insns;
+} CuCkptStats;
+
+// Start taking a checkpoint every `interval` instructions, using up to
+// `budget` bytes of memory, with the current state as the first checkpoint.
+extern bool CuCkptSetUp(uint64_t interval, size_t budget,
+  CuError* restrict err);
+extern bool CuCkptIsEnabled(void);
+
+// Take a checkpoint of the current state (called by the executor).
+extern bool CuCkptTake(CuError* restrict err);
+
+// Reverse the execution by `n` instructions.
+extern bool CuReverseStep(uint64_t n, CuError* restrict err);
+
+// Reverse the execution to the latest point at which a break-point or a
+// watch-point stopped (or would have stopped) the executor, or to the oldest
+// checkpoint if there is none, setting `found` accordingly.
+extern bool CuReverseContinue(bool* restrict found, CuError* restrict err);
+
+extern void CuCkptGetStats(CuCkptStats* restrict stats);
+
+#endif  // CUSS_CHECKPT_INCLUDED
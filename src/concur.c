@@ -1,12 +1,25 @@
 // SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
 // SPDX-License-Identifier: BSD-3-Clause
+// Needed for `sched_setaffinity()` and friends.
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "concur.h"
 
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
 #include "SDL_error.h"
 #include "SDL_mutex.h"
 #include "SDL_thread.h"
+#include <errno.h>
+#include <limits.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 struct CuThread {
     SDL_Thread* sdl_thr;
@@ -20,6 +33,60 @@ struct CuCondVar {
     SDL_cond* sdl_cond;
 };
 
+struct CuAtomic {
+    SDL_atomic_t sdl_atomic;
+};
+
+struct CuSemaphore {
+    SDL_sem* sdl_sem;
+};
+
+// The maximum number of workers in a pool.
+#define POOL_MAX_THREADS 64
+
+// The number of tasks that can be queued for a worker of a pool. A task
+// submitted to a full queue is run by the submitting thread.
+#define POOL_QUEUE_SIZE 256
+
+typedef struct PoolTask {
+    CuTaskFn fn;
+    void* data;
+    struct CuFuture* fut;
+} PoolTask;
+
+typedef struct PoolWorker {
+    struct CuPool* pool;
+    SDL_Thread* sdl_thr;
+    // The queue of tasks of the worker, in a ring-buffer from `head` (the
+    // oldest task) up to `tail`, which only grow.
+    CuSpinLock lock;
+    uint32_t head;
+    uint32_t tail;
+    PoolTask tasks[POOL_QUEUE_SIZE];
+} PoolWorker;
+
+struct CuPool {
+    int num_threads;
+    // Posted once for every queued task, to unpark an idle worker.
+    SDL_sem* work_sem;
+    SDL_atomic_t quit;
+    // The worker whose queue gets the next task submitted to the pool.
+    SDL_atomic_t next_worker;
+    PoolWorker workers[];
+};
+
+struct CuFuture {
+    struct CuPool* pool;
+    int result;
+    SDL_sem* done_sem;
+};
+
+static CuPool host_pool = NULL;
+
+// Only used for the side-effect of its read-modify-write operations, which
+// SDL implements as full memory-barriers.
+static SDL_atomic_t fence_atomic;
+
 bool CuThrCreate(CuThreadFn fn, const char* restrict name,
   void* restrict data, CuThread* restrict thr, CuError* restrict err) {
     if (thr == NULL) {
@@ -47,6 +114,39 @@ bool CuThrWait(CuThread* restrict thr, int* restrict status,
     return true;
 }
 
+bool CuThrPinToCpu(int cpu, int* restrict pinned, CuError* restrict err) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof allowed, &allowed) != 0) {
+        return CuErrMsg(err, "Unable to get CPU-affinity: %s",
+          strerror(errno));
+    }
+    if (cpu < 0) {
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &allowed)) {
+                cpu = i;
+            }
+        }
+    }
+    if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) {
+        return CuErrMsg(err, "CPU %d is not available.", cpu);
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (sched_setaffinity(0, sizeof cpus, &cpus) != 0) {
+        return CuErrMsg(err, "Unable to set CPU-affinity: %s",
+          strerror(errno));
+    }
+    *pinned = cpu;
+    return true;
+#else
+    (void)cpu;  // Suppress unused parameter warning.
+    (void)pinned;  // Suppress unused parameter warning.
+    return CuErrMsg(err, "Pinning threads is not supported on this host.");
+#endif
+}
+
 bool CuMutCreate(CuMutex* restrict mut, CuError* restrict err) {
     if (mut == NULL) {
         return CuErrMsg(err, "NULL `mut` argument.");
@@ -143,3 +243,411 @@ bool CuCondVarSignal(CuCondVar* restrict cv, CuError* restrict err) {
     }
     return true;
 }
+
+bool CuAtomicCreate(CuAtomic* restrict a, int val, CuError* restrict err) {
+    if (a == NULL) {
+        return CuErrMsg(err, "NULL `a` argument.");
+    }
+    *a = malloc(sizeof (struct CuAtomic));
+    if (*a == NULL) {
+        return CuErrMsg(err, "Unable to allocate atomic.");
+    }
+    SDL_AtomicSet(&(*a)->sdl_atomic, val);
+    return true;
+}
+
+bool CuAtomicDestroy(CuAtomic* restrict a, CuError* restrict err) {
+    if (a == NULL || *a == NULL) {
+        return CuErrMsg(err, "Bad `a` argument.");
+    }
+    free(*a);
+    *a = NULL;
+    return true;
+}
+
+int CuAtomicGet(CuAtomic* restrict a) {
+    return SDL_AtomicGet(&(*a)->sdl_atomic);
+}
+
+void CuAtomicSet(CuAtomic* restrict a, int val) {
+    SDL_AtomicSet(&(*a)->sdl_atomic, val);
+}
+
+bool CuAtomicCas(CuAtomic* restrict a, int old_val, int new_val) {
+    return SDL_AtomicCAS(&(*a)->sdl_atomic, old_val, new_val) == SDL_TRUE;
+}
+
+bool CuSemCreate(CuSemaphore* restrict sem, uint32_t val,
+  CuError* restrict err) {
+    if (sem == NULL) {
+        return CuErrMsg(err, "NULL `sem` argument.");
+    }
+    *sem = malloc(sizeof (struct CuSemaphore));
+    if (*sem == NULL) {
+        return CuErrMsg(err, "Unable to allocate semaphore.");
+    }
+    (*sem)->sdl_sem = SDL_CreateSemaphore(val);
+    if ((*sem)->sdl_sem == NULL) {
+        return CuErrMsg(err, "Unable to create semaphore: %s", SDL_GetError());
+    }
+    return true;
+}
+
+bool CuSemDestroy(CuSemaphore* restrict sem, CuError* restrict err) {
+    if (sem == NULL || *sem == NULL || (*sem)->sdl_sem == NULL) {
+        return CuErrMsg(err, "Bad `sem` argument.");
+    }
+    SDL_DestroySemaphore((*sem)->sdl_sem);
+    free(*sem);
+    *sem = NULL;
+    return true;
+}
+
+bool CuSemWait(CuSemaphore* restrict sem, CuError* restrict err) {
+    if (sem == NULL || *sem == NULL || (*sem)->sdl_sem == NULL) {
+        return CuErrMsg(err, "Bad `sem` argument.");
+    }
+    if (SDL_SemWait((*sem)->sdl_sem) != 0) {
+        return CuErrMsg(err, "Failed to wait on semaphore: %s",
+          SDL_GetError());
+    }
+    return true;
+}
+
+bool CuSemPost(CuSemaphore* restrict sem, CuError* restrict err) {
+    if (sem == NULL || *sem == NULL || (*sem)->sdl_sem == NULL) {
+        return CuErrMsg(err, "Bad `sem` argument.");
+    }
+    if (SDL_SemPost((*sem)->sdl_sem) != 0) {
+        return CuErrMsg(err, "Failed to post semaphore: %s", SDL_GetError());
+    }
+    return true;
+}
+
+void CuSpinLockAcquire(CuSpinLock* restrict lock) {
+    SDL_AtomicLock(&lock->lock);
+}
+
+void CuSpinLockRelease(CuSpinLock* restrict lock) {
+    SDL_AtomicUnlock(&lock->lock);
+}
+
+void CuAtomicFlagRaise(CuAtomicFlag* restrict flag) {
+    // This must not be skipped when the flag is already raised: the data just
+    // written could otherwise still be invisible when the flag is taken.
+    SDL_AtomicSetPtr(&flag->raised, flag);
+}
+
+bool CuAtomicFlagTake(CuAtomicFlag* restrict flag) {
+    return SDL_AtomicSetPtr(&flag->raised, NULL) != NULL;
+}
+
+void CuMemFence(void) {
+    SDL_AtomicAdd(&fence_atomic, 0);
+}
+
+static void RunTask(const PoolTask* restrict task) {
+    struct CuFuture* fut = task->fut;
+    fut->result = task->fn(task->data);
+    // The waiter always takes this post before it frees the future, so this
+    // is the last access of the future by this thread.
+    SDL_SemPost(fut->done_sem);
+}
+
+// Take a task for the worker `self` (or for a thread outside the pool with
+// a negative `self`): the newest task from its own queue, else the oldest
+// task from the queue of another worker.
+static bool TakeTask(CuPool pool, int self, PoolTask* restrict task) {
+    if (self >= 0) {
+        PoolWorker* w = &pool->workers[self];
+        CuSpinLockAcquire(&w->lock);
+        const bool found = w->tail != w->head;
+        if (found) {
+            w->tail--;
+            *task = w->tasks[w->tail % POOL_QUEUE_SIZE];
+        }
+        CuSpinLockRelease(&w->lock);
+        if (found) {
+            return true;
+        }
+    }
+    const int n = pool->num_threads;
+    for (int i = 1; i <= n; i++) {
+        PoolWorker* w = &pool->workers[(self + i + n) % n];
+        CuSpinLockAcquire(&w->lock);
+        const bool found = w->tail != w->head;
+        if (found) {
+            *task = w->tasks[w->head % POOL_QUEUE_SIZE];
+            w->head++;
+        }
+        CuSpinLockRelease(&w->lock);
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int PoolWorkerThread(void* data) {
+    PoolWorker* w = data;
+    CuPool pool = w->pool;
+    const int self = (int)(w - pool->workers);
+    for (;;) {
+        SDL_SemWait(pool->work_sem);
+        if (SDL_AtomicGet(&pool->quit) != 0) {
+            break;
+        }
+        PoolTask task;
+        while (TakeTask(pool, self, &task)) {
+            RunTask(&task);
+        }
+    }
+    return 0;
+}
+
+bool CuPoolCreate(CuPool* restrict pool, int num_threads,
+  CuError* restrict err) {
+    if (pool == NULL) {
+        return CuErrMsg(err, "NULL `pool` argument.");
+    }
+    if (num_threads < 0) {
+        num_threads = SDL_GetCPUCount() - 1;
+    }
+    if (num_threads < 0) {
+        num_threads = 0;
+    } else if (num_threads > POOL_MAX_THREADS) {
+        num_threads = POOL_MAX_THREADS;
+    }
+    *pool = malloc(sizeof (struct CuPool) +
+      (size_t)num_threads * sizeof (PoolWorker));
+    if (*pool == NULL) {
+        return CuErrMsg(err, "Unable to allocate thread-pool.");
+    }
+    CuPool p = *pool;
+    p->num_threads = 0;
+    SDL_AtomicSet(&p->quit, 0);
+    SDL_AtomicSet(&p->next_worker, 0);
+    p->work_sem = SDL_CreateSemaphore(0);
+    if (p->work_sem == NULL) {
+        free(p);
+        *pool = NULL;
+        return CuErrMsg(err, "Unable to create semaphore: %s", SDL_GetError());
+    }
+    for (int i = 0; i < num_threads; i++) {
+        PoolWorker* w = &p->workers[i];
+        w->pool = p;
+        w->lock.lock = 0;
+        w->head = 0;
+        w->tail = 0;
+        w->sdl_thr = SDL_CreateThread(PoolWorkerThread, "CuPoolWorker", w);
+        if (w->sdl_thr == NULL) {
+            CuErrMsg(err, "Unable to create thread: %s", SDL_GetError());
+            CuError nerr;
+            CuPoolDestroy(pool, &nerr);
+            return false;
+        }
+        p->num_threads++;
+    }
+    return true;
+}
+
+bool CuPoolDestroy(CuPool* restrict pool, CuError* restrict err) {
+    if (pool == NULL || *pool == NULL) {
+        return CuErrMsg(err, "Bad `pool` argument.");
+    }
+    CuPool p = *pool;
+    SDL_AtomicSet(&p->quit, 1);
+    for (int i = 0; i < p->num_threads; i++) {
+        SDL_SemPost(p->work_sem);
+    }
+    for (int i = 0; i < p->num_threads; i++) {
+        SDL_WaitThread(p->workers[i].sdl_thr, NULL);
+    }
+    SDL_DestroySemaphore(p->work_sem);
+    free(p);
+    *pool = NULL;
+    return true;
+}
+
+int CuPoolGetNumThreads(CuPool pool) {
+    return pool != NULL ? pool->num_threads : 0;
+}
+
+bool CuPoolSubmit(CuPool pool, CuTaskFn fn, void* data,
+  CuFuture* restrict fut, CuError* restrict err) {
+    if (pool == NULL || fn == NULL || fut == NULL) {
+        return CuErrMsg(err, "NULL `pool`, `fn`, or `fut` argument.");
+    }
+    *fut = malloc(sizeof (struct CuFuture));
+    if (*fut == NULL) {
+        return CuErrMsg(err, "Unable to allocate future.");
+    }
+    struct CuFuture* f = *fut;
+    f->pool = pool;
+    f->result = 0;
+    f->done_sem = SDL_CreateSemaphore(0);
+    if (f->done_sem == NULL) {
+        free(f);
+        *fut = NULL;
+        return CuErrMsg(err, "Unable to create semaphore: %s", SDL_GetError());
+    }
+
+    const PoolTask task = { .fn = fn, .data = data, .fut = f, };
+    bool queued = false;
+    if (pool->num_threads > 0) {
+        const int i = (int)((unsigned)SDL_AtomicAdd(&pool->next_worker, 1) %
+          (unsigned)pool->num_threads);
+        PoolWorker* w = &pool->workers[i];
+        CuSpinLockAcquire(&w->lock);
+        if (w->tail - w->head < POOL_QUEUE_SIZE) {
+            w->tasks[w->tail % POOL_QUEUE_SIZE] = task;
+            w->tail++;
+            queued = true;
+        }
+        CuSpinLockRelease(&w->lock);
+    }
+    if (queued) {
+        SDL_SemPost(pool->work_sem);
+    } else {
+        RunTask(&task);
+    }
+    return true;
+}
+
+bool CuFutureWait(CuFuture* restrict fut, int* restrict result,
+  CuError* restrict err) {
+    if (fut == NULL || *fut == NULL) {
+        return CuErrMsg(err, "Bad `fut` argument.");
+    }
+    struct CuFuture* f = *fut;
+    // Take the post of the task even when it has already finished, as the
+    // thread that ran it may not yet be done with the future.
+    PoolTask task;
+    while (SDL_SemTryWait(f->done_sem) != 0) {
+        if (!TakeTask(f->pool, -1, &task)) {
+            if (SDL_SemWait(f->done_sem) != 0) {
+                return CuErrMsg(err, "Failed to wait on semaphore: %s",
+                  SDL_GetError());
+            }
+            break;
+        }
+        RunTask(&task);
+    }
+    if (result != NULL) {
+        *result = f->result;
+    }
+    SDL_DestroySemaphore(f->done_sem);
+    free(f);
+    *fut = NULL;
+    return true;
+}
+
+typedef struct ParallelFor {
+    size_t begin;
+    size_t end;
+    size_t grain;
+    int num_chunks;
+    CuRangeFn fn;
+    void* data;
+    SDL_atomic_t next_chunk;
+    SDL_atomic_t failed;
+    CuSpinLock err_lock;
+    CuError err;
+} ParallelFor;
+
+static int RunChunks(void* data) {
+    ParallelFor* pf = data;
+    for (;;) {
+        const int c = SDL_AtomicAdd(&pf->next_chunk, 1);
+        if (c >= pf->num_chunks || SDL_AtomicGet(&pf->failed) != 0) {
+            break;
+        }
+        const size_t begin = pf->begin + (size_t)c * pf->grain;
+        const size_t end = (pf->end - begin > pf->grain) ?
+          begin + pf->grain : pf->end;
+        CuError err;
+        if (!pf->fn(pf->data, begin, end, &err)) {
+            CuSpinLockAcquire(&pf->err_lock);
+            if (SDL_AtomicGet(&pf->failed) == 0) {
+                pf->err = err;
+                SDL_AtomicSet(&pf->failed, 1);
+            }
+            CuSpinLockRelease(&pf->err_lock);
+        }
+    }
+    return 0;
+}
+
+bool CuPoolParallelFor(CuPool pool, size_t begin, size_t end,
+  size_t grain, CuRangeFn fn, void* data, CuError* restrict err) {
+    if (fn == NULL) {
+        return CuErrMsg(err, "NULL `fn` argument.");
+    }
+    if (begin >= end) {
+        return true;
+    }
+    const size_t count = end - begin;
+    const int num_threads = CuPoolGetNumThreads(pool);
+    if (grain == 0) {
+        // A few chunks for every thread, to even out chunks of uneven cost.
+        grain = count / (4U * ((size_t)num_threads + 1U));
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    if ((count - 1U) / grain >= (size_t)INT_MAX) {
+        grain = (count - 1U) / (size_t)INT_MAX + 1U;
+    }
+
+    ParallelFor pf = {
+        .begin = begin, .end = end, .grain = grain,
+        .num_chunks = (int)((count - 1U) / grain + 1U),
+        .fn = fn, .data = data, .err_lock = { 0 },
+    };
+    SDL_AtomicSet(&pf.next_chunk, 0);
+    SDL_AtomicSet(&pf.failed, 0);
+
+    // The calling thread runs chunks as well, so one helper less than the
+    // number of chunks is enough. If a helper cannot be submitted, the
+    // remaining threads simply run more chunks.
+    int num_helpers = pf.num_chunks - 1;
+    if (num_helpers > num_threads) {
+        num_helpers = num_threads;
+    }
+    CuFuture helpers[POOL_MAX_THREADS];
+    int num_submitted = 0;
+    CuError nerr;
+    while (num_submitted < num_helpers &&
+      CuPoolSubmit(pool, RunChunks, &pf, &helpers[num_submitted], &nerr)) {
+        num_submitted++;
+    }
+    RunChunks(&pf);
+    for (int i = 0; i < num_submitted; i++) {
+        CuFutureWait(&helpers[i], NULL, &nerr);
+    }
+    if (SDL_AtomicGet(&pf.failed) != 0) {
+        *err = pf.err;
+        return false;
+    }
+    return true;
+}
+
+bool CuSetUpHostPool(int num_threads, CuError* restrict err) {
+    if (host_pool != NULL) {
+        return CuErrMsg(err, "Host thread-pool is already set up.");
+    }
+    RET_ON_ERR(CuPoolCreate(&host_pool, num_threads, err));
+    return true;
+}
+
+CuPool CuGetHostPool(void) {
+    return host_pool;
+}
+
+bool CuTearDownHostPool(CuError* restrict err) {
+    if (host_pool == NULL) {
+        return true;
+    }
+    RET_ON_ERR(CuPoolDestroy(&host_pool, err));
+    return true;
+}
@@ -4,12 +4,16 @@
 #define CUSS_CONCUR_INCLUDED
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "errors.h"
 
 typedef struct CuThread* CuThread;
 typedef struct CuMutex* CuMutex;
 typedef struct CuCondVar* CuCondVar;
+typedef struct CuAtomic* CuAtomic;
+typedef struct CuSemaphore* CuSemaphore;
 
 typedef int (*CuThreadFn)(void* data);
 
@@ -18,6 +22,11 @@ extern bool CuThrCreate(CuThreadFn fn, const char* restrict name,
 extern bool CuThrWait(CuThread* restrict thr, int* restrict status,
   CuError* restrict err);
 
+// Pin the calling thread to the host CPU `cpu`, or to the last host CPU it is
+// allowed to run on with a negative `cpu`, setting `pinned` to the CPU used.
+// Threads it creates later inherit this. Only supported on Linux.
+extern bool CuThrPinToCpu(int cpu, int* restrict pinned, CuError* restrict err);
+
 extern bool CuMutCreate(CuMutex* restrict mut, CuError* restrict err);
 extern bool CuMutDestroy(CuMutex* restrict mut, CuError* restrict err);
 extern bool CuMutLock(CuMutex* restrict mut, CuError* restrict err);
@@ -29,4 +38,97 @@ extern bool CuCondVarWait(CuCondVar* restrict cv, CuMutex* restrict mut,
   CuError* restrict err);
 extern bool CuCondVarSignal(CuCondVar* restrict cv, CuError* restrict err);
 
+// An integer that can be read and written by several threads at once. Every
+// operation on it is sequentially-consistent (a full memory-barrier). Since
+// these are meant to be polled on hot paths, they do not check `a`.
+extern bool CuAtomicCreate(CuAtomic* restrict a, int val,
+  CuError* restrict err);
+extern bool CuAtomicDestroy(CuAtomic* restrict a, CuError* restrict err);
+extern int CuAtomicGet(CuAtomic* restrict a);
+extern void CuAtomicSet(CuAtomic* restrict a, int val);
+// Set `a` to `new_val` only if it is `old_val`, returning whether it was set.
+extern bool CuAtomicCas(CuAtomic* restrict a, int old_val, int new_val);
+
+// A counting semaphore, to park a thread (`CuSemWait()`) until another thread
+// unparks it (`CuSemPost()`), without a lost wake-up if the latter comes first.
+extern bool CuSemCreate(CuSemaphore* restrict sem, uint32_t val,
+  CuError* restrict err);
+extern bool CuSemDestroy(CuSemaphore* restrict sem, CuError* restrict err);
+extern bool CuSemWait(CuSemaphore* restrict sem, CuError* restrict err);
+extern bool CuSemPost(CuSemaphore* restrict sem, CuError* restrict err);
+
+// A lock for very short critical-sections, which spins instead of parking the
+// waiting thread. Unlike the other primitives, it is a plain value that needs
+// no creation, and is unlocked when zero-initialized.
+typedef struct CuSpinLock {
+    int lock;
+} CuSpinLock;
+
+extern void CuSpinLockAcquire(CuSpinLock* restrict lock);
+extern void CuSpinLockRelease(CuSpinLock* restrict lock);
+
+// A flag raised by one thread after it writes some data, and taken (read and
+// lowered at once) by another thread before it reads that data, so that the
+// latter sees the data if it sees the flag raised. Like a spin-lock, it is a
+// plain value that needs no creation, and is lowered when zero-initialized.
+typedef struct CuAtomicFlag {
+    void* raised;
+} CuAtomicFlag;
+
+extern void CuAtomicFlagRaise(CuAtomicFlag* restrict flag);
+// Lower the flag, returning whether it was raised.
+extern bool CuAtomicFlagTake(CuAtomicFlag* restrict flag);
+
+// A full memory-barrier: no load or store by this thread is reordered across
+// it, as seen by other threads.
+extern void CuMemFence(void);
+
+// A fixed-size pool of worker threads for host-side work, such as loading
+// a memory-image or disassembling a large range of memory. Every worker has
+// its own queue of tasks, taking the most recently queued task from it and
+// stealing the oldest task from the queue of another worker when it is empty.
+typedef struct CuPool* CuPool;
+
+// The pending result of a task submitted to a pool.
+typedef struct CuFuture* CuFuture;
+
+typedef int (*CuTaskFn)(void* data);
+
+// Create a pool with `num_threads` workers, or with one worker less than the
+// number of host CPUs with a negative `num_threads`. A pool without workers
+// runs every task in the submitting thread.
+extern bool CuPoolCreate(CuPool* restrict pool, int num_threads,
+  CuError* restrict err);
+// Every future of the pool must have been waited on before this.
+extern bool CuPoolDestroy(CuPool* restrict pool, CuError* restrict err);
+extern int CuPoolGetNumThreads(CuPool pool);
+
+// Run `fn(data)` on a worker of the pool, setting `fut` to its pending result.
+extern bool CuPoolSubmit(CuPool pool, CuTaskFn fn, void* data,
+  CuFuture* restrict fut, CuError* restrict err);
+// Wait for the task of `fut` to finish, running other tasks of its pool in
+// the meantime, and set `result` to its return-value. This frees `fut`.
+extern bool CuFutureWait(CuFuture* restrict fut, int* restrict result,
+  CuError* restrict err);
+
+// The type of a function called by `CuPoolParallelFor()` for the indices
+// from `begin` up to (but not including) `end`.
+typedef bool (*CuRangeFn)(void* data, size_t begin, size_t end,
+  CuError* restrict err);
+
+// Call `fn` for the indices from `begin` up to (but not including) `end` in
+// chunks of `grain` indices (or a chunk-size based on the number of workers
+// if `grain` is zero), spread over the calling thread and the workers of
+// `pool`. The chunks are run serially if `pool` is NULL. Stops handing out
+// chunks after the first failure, which sets `err`.
+extern bool CuPoolParallelFor(CuPool pool, size_t begin, size_t end,
+  size_t grain, CuRangeFn fn, void* data, CuError* restrict err);
+
+// The pool shared by the host-side work of the whole program, with
+// `num_threads` workers as for `CuPoolCreate()`. `CuGetHostPool()` returns
+// NULL before it is set up, so that its callers run their work serially.
+extern bool CuSetUpHostPool(int num_threads, CuError* restrict err);
+extern CuPool CuGetHostPool(void);
+extern bool CuTearDownHostPool(CuError* restrict err);
+
 #endif  // CUSS_CONCUR_INCLUDED
@@ -4,10 +4,15 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include <string.h>
 
+#include "checkpt.h"
 #include "concur.h"
 #include "memory.h"
 #include "ops.h"
+#include "pipeline.h"
+#include "stbuf.h"
+#include "timing.h"
 
 // The default values in the integer registers (except for `r0`).
 #define DEF_REG_VAL 0xC0DEF00DU
@@ -15,77 +20,334 @@
 // What to reset the program-counter to, upon receiving a hard reset signal.
 #define RESET_VECTOR 0x00000000U
 
-// How many break-points to support at a time.
-#define MAX_BREAK_POINTS 16
 // Sentinel-value for an invalid break-point.
 #define INVALID_BREAK_POINT 0xFFFFFFFFU
 
-// The general-purpose integer registers in a CUP core.
-static uint32_t cup_iregs[CU_NUM_IREGS];
+// The CUP cores, sharing the same memory. While running, the first core runs
+// on the thread of the executor and each of the rest on a host-thread of its
+// own.
+static CuCore cup_cores[CU_MAX_CORES];
+static int num_cores = 1;
 
-// An additional register to provide extended precision during multiply/divide.
-static uint32_t cup_epr;
+// The core read and written by the accessors below, and therefore by the
+// Monitor and the GDB-server.
+static CuCore* cup_sel = &cup_cores[0];
 
-// The program-counter of a CUP core.
-static uint32_t cup_pc;
+// The current state of CUP. Only the executor moves it out of
+// `CU_CPU_RUNNING`, doing so while holding `cup_stop_mut`.
+static CuAtomic cup_state = NULL;
 
-// The processor state register of a CUP core.
-static uint32_t cup_psr;
+// Why the executor last stopped, signalled via `cup_stop_cv`. Guarded by
+// `cup_stop_mut`.
+static CuCpuStopInfo cup_stop_info;
+static CuMutex cup_stop_mut = NULL;
+static CuCondVar cup_stop_cv = NULL;
 
-// The current (or intended) state of a CUP core. Guarded by `cup_state_mut`.
-static CuCpuState cup_state = CU_CPU_ERROR;
-static CuMutex cup_state_mut = NULL;
-static CuCondVar cup_state_cv = NULL;
+// Called every time the executor stops, so that the stop can be reported as
+// soon as it happens.
+static CuCpuStopHookFn cup_stop_hook = NULL;
 
-static uint32_t cup_break_points[MAX_BREAK_POINTS];
+// Requests to the executor go through a single-producer, single-consumer
+// queue, with the Monitor and the GDB-server taking turns as the producer via
+// `cup_ctl_mut`. The executor parks on `cmd_sem` (posted once per request)
+// when stopped, and only polls the queue every `CMD_POLL_INSNS` instructions
+// when running.
+#define CMD_QUEUE_SIZE 16
+#define CMD_POLL_INSNS 1024
+
+typedef enum {
+    CPU_CMD_RUN,
+    CPU_CMD_STEP,
+    CPU_CMD_PAUSE,
+    CPU_CMD_QUIT,
+} CpuCmdKind;
+
+typedef struct CpuCmd {
+    CpuCmdKind kind;
+    uint64_t max_insns;
+    uint32_t until_addr;
+} CpuCmd;
+
+// The indices of the queue run modulo twice its size, so that a full queue
+// can be told apart from an empty one.
+static CpuCmd cmd_queue[CMD_QUEUE_SIZE];
+static CuAtomic cmd_head = NULL;
+static CuAtomic cmd_tail = NULL;
+static CuSemaphore cmd_sem = NULL;
+static CuMutex cup_ctl_mut = NULL;
+
+// The outcome of the last single-step by the executor, signalled via
+// `step_sem`.
+static bool step_ok = true;
+static CuError step_err;
+static CuSemaphore step_sem = NULL;
+
+// Limits on the current run of instructions by the executor, applying to
+// each core. Only changed while stopped.
+static uint64_t cup_run_limit = CU_CPU_RUN_NO_LIMIT;
+static uint32_t cup_until_addr = CU_CPU_RUN_NO_UNTIL;
+
+// The outcome of the current run of instructions on a core.
+typedef struct CoreRun {
+    CuCore* core;
+    CuThread thr;
+    uint64_t insns;
+    CuCpuStopReason reason;
+    CuError err;
+    // Whether the core ended its quantum at an instruction that the
+    // deterministic scheduler executes between quanta.
+    bool sync_pending;
+    // Whether the core ended its quantum at a break-point, whose hit the
+    // deterministic scheduler counts between quanta.
+    bool bp_pending;
+} CoreRun;
+
+static CoreRun core_runs[CU_MAX_CORES];
+
+// While running on several cores, the reason given by the first core to stop
+// (`CU_CPU_STOP_NONE` until then), which every other core polls along with
+// the queue of requests, and the index of that core.
+static CuAtomic cores_stop = NULL;
+static int stop_core = 0;
+
+// The number of cores that have started running, so that none of them races
+// ahead while the threads of the others are still being created.
+static CuAtomic cores_ready = NULL;
+
+// With a non-zero quantum and several cores, the deterministic scheduler runs
+// every core for `cup_quantum` instructions at a time, with its plain stores
+// going to a store-buffer of its own. The cores then meet at a barrier, where
+// the executor commits the store-buffers in the order of the cores and
+// executes any pending LDLW, STCW, and FENC one core at a time, starting
+// from a different core every quantum so that no core is favoured. Each
+// worker core waits on its `quantum_go` to run a quantum (or, once
+// `quantum_end` is set, to finish) and posts `quantum_done` after it.
+static uint64_t cup_quantum = 0;
+static CuStoreBuf* core_sbufs[CU_MAX_CORES];
+static CuSemaphore quantum_go[CU_MAX_CORES];
+static CuSemaphore quantum_done = NULL;
+static bool quantum_end = false;
+
+// The addresses of break-points, compacted for faster searches.
+static uint32_t cup_break_points[CU_MAX_BREAK_POINTS];
 static int num_break_points = 0;
 
-bool CuInitCpu(CuError* restrict err) {
-    cup_pc = RESET_VECTOR;
-    cup_iregs[0] = 0x00000000U;
+// The condition and the hit-count of a break-point or a watch-point.
+typedef struct PointCond {
+    uint64_t hits;
+    CuBpCond cond;
+    char src[CU_BP_COND_MAX_SRC];
+} PointCond;
+
+// The conditions of the break-points in `cup_break_points`.
+static PointCond cup_bp_conds[CU_MAX_BREAK_POINTS];
+
+typedef struct WatchPoint {
+    uint32_t addr;
+    uint32_t size;
+    // The value at the watched location as of the last store to it.
+    uint32_t val;
+    PointCond cond;
+} WatchPoint;
+
+static WatchPoint cup_watch_points[CU_MAX_WATCH_POINTS];
+static int num_watch_points = 0;
+
+// Serializes the cores updating the hit-counts of break-points and
+// watch-points.
+static CuSpinLock points_lock;
+
+// Whether to feed instructions executed by the first core to the
+// pipeline-model.
+static bool pipe_model_enabled = false;
+
+// When the instruction-count of the first core should reach to take the next
+// checkpoint (see "checkpt.h"), which is only supported with a single core.
+static uint64_t cup_next_ckpt = CU_CPU_NO_CKPT;
+
+static void ResetCore(CuCore* restrict core, int id) {
+    core->pc = RESET_VECTOR;
+    core->iregs[0] = 0x00000000U;
     for (int i = 1; i < CU_NUM_IREGS; i++) {
-        cup_iregs[i] = DEF_REG_VAL;
+        core->iregs[i] = DEF_REG_VAL;
     }
-    cup_psr = 0x00000000U;
-    cup_epr = 0x00000000U;
+    core->psr = 0x00000000U;
+    core->epr = 0x00000000U;
+    core->id = (uint32_t)id;
+    core->resv_valid = false;
+    core->resv_addr = 0x00000000U;
+    core->resv_val = 0x00000000U;
+    core->watch_hit = false;
+    core->sbuf = NULL;
+    core->sbuf_full = false;
+    core->insns = 0;
+    core->tim.insns = 0;
+    core->tim.cycles = 0;
+}
 
-    for (int i = 0; i < MAX_BREAK_POINTS; i++) {
+bool CuInitCpu(CuError* restrict err) {
+    for (int i = 0; i < CU_MAX_CORES; i++) {
+        ResetCore(&cup_cores[i], i);
+    }
+    cup_sel = &cup_cores[0];
+
+    for (int i = 0; i < CU_MAX_BREAK_POINTS; i++) {
         cup_break_points[i] = INVALID_BREAK_POINT;
     }
     num_break_points = 0;
 
     CuInitOps();
-    cup_state = CU_CPU_PAUSED;
+    CuTimInit(CU_DEF_CLOCK_HZ);
+    CuPipeInit();
+
+    cup_stop_info.seq = 0;
+    cup_stop_info.reason = CU_CPU_STOP_NONE;
+    cup_stop_info.insns = 0;
+    cup_stop_info.host_ns = 0;
+    cup_stop_info.pc = cup_sel->pc;
+    cup_stop_info.core = 0;
+    cup_run_limit = CU_CPU_RUN_NO_LIMIT;
+    cup_until_addr = CU_CPU_RUN_NO_UNTIL;
 
-    RET_ON_ERR(CuMutCreate(&cup_state_mut, err));
-    RET_ON_ERR(CuCondVarCreate(&cup_state_cv, err));
+    if (cup_state == NULL) {
+        RET_ON_ERR(CuAtomicCreate(&cup_state, CU_CPU_PAUSED, err));
+        RET_ON_ERR(CuMutCreate(&cup_stop_mut, err));
+        RET_ON_ERR(CuCondVarCreate(&cup_stop_cv, err));
+        RET_ON_ERR(CuAtomicCreate(&cmd_head, 0, err));
+        RET_ON_ERR(CuAtomicCreate(&cmd_tail, 0, err));
+        RET_ON_ERR(CuSemCreate(&cmd_sem, 0, err));
+        RET_ON_ERR(CuMutCreate(&cup_ctl_mut, err));
+        RET_ON_ERR(CuSemCreate(&step_sem, 0, err));
+        RET_ON_ERR(CuAtomicCreate(&cores_stop, CU_CPU_STOP_NONE, err));
+        RET_ON_ERR(CuAtomicCreate(&cores_ready, 0, err));
+        for (int i = 0; i < CU_MAX_CORES; i++) {
+            RET_ON_ERR(CuSemCreate(&quantum_go[i], 0, err));
+        }
+        RET_ON_ERR(CuSemCreate(&quantum_done, 0, err));
+    }
+    CuAtomicSet(&cup_state, CU_CPU_PAUSED);
     return true;
 }
 
 CuCpuState CuGetCpuState(void) {
-    return cup_state;
+    return (CuCpuState)CuAtomicGet(&cup_state);
 }
 
-bool CuSetCpuState(CuCpuState new_state, CuError* restrict err) {
-    if (new_state == CU_CPU_ERROR || new_state == CU_CPU_BREAK_POINT) {
-        return CuErrMsg(err, "Invalid new state.");
+static inline bool IsStopped(CuCpuState state) {
+    return state == CU_CPU_PAUSED || state == CU_CPU_BREAK_POINT;
+}
+
+bool CuSetNumCores(int num, CuError* restrict err) {
+    if (num < 1 || num > CU_MAX_CORES) {
+        return CuErrMsg(err, "Bad number of cores (%d), must be 1 to %d.", num,
+          CU_MAX_CORES);
+    }
+    if (!IsStopped(CuGetCpuState())) {
+        return CuErrMsg(err, "Incorrect state for changing the cores.");
+    }
+    if (num > 1 && CuCkptIsEnabled()) {
+        return CuErrMsg(err, "Checkpoints need a single core.");
+    }
+    for (int i = 0; i < CU_MAX_CORES; i++) {
+        ResetCore(&cup_cores[i], i);
+    }
+    num_cores = num;
+    cup_sel = &cup_cores[0];
+    return true;
+}
+
+int CuGetNumCores(void) {
+    return num_cores;
+}
+
+bool CuSetQuantum(uint64_t quantum, CuError* restrict err) {
+    if (!IsStopped(CuGetCpuState())) {
+        return CuErrMsg(err, "Incorrect state for changing the quantum.");
     }
-    const bool must_unblock = (cup_state == CU_CPU_PAUSED) ||
-      (cup_state == CU_CPU_BREAK_POINT);
-    const bool can_unblock = (new_state == CU_CPU_RUNNING) ||
-      (new_state == CU_CPU_QUITTING);
-    if (must_unblock && can_unblock) {
-        RET_ON_ERR(CuCondVarSignal(&cup_state_cv, err));
+    for (int i = 0; quantum != 0 && i < CU_MAX_CORES; i++) {
+        if (core_sbufs[i] == NULL) {
+            RET_ON_ERR(CuSbufCreate(&core_sbufs[i], err));
+        }
+    }
+    cup_quantum = quantum;
+    return true;
+}
+
+uint64_t CuGetQuantum(void) {
+    return cup_quantum;
+}
+
+CuCore* CuGetCore(int n) {
+    return (n >= 0 && n < num_cores) ? &cup_cores[n] : NULL;
+}
+
+bool CuSelectCore(int n, CuError* restrict err) {
+    if (n < 0 || n >= num_cores) {
+        return CuErrMsg(err, "Bad core (%d), must be 0 to %d.", n,
+          num_cores - 1);
+    }
+    if (!IsStopped(CuGetCpuState())) {
+        return CuErrMsg(err, "Incorrect state for selecting a core.");
+    }
+    cup_sel = &cup_cores[n];
+    return true;
+}
+
+int CuGetSelectedCore(void) {
+    return (int)cup_sel->id;
+}
+
+// Queue `cmd` for the executor and unpark it, with `cup_ctl_mut` held.
+static bool PushCmd(const CpuCmd* restrict cmd, CuError* restrict err) {
+    const int tail = CuAtomicGet(&cmd_tail);
+    const int head = CuAtomicGet(&cmd_head);
+    if (((tail - head) & (2 * CMD_QUEUE_SIZE - 1)) == CMD_QUEUE_SIZE) {
+        return CuErrMsg(err, "Too many pending requests for the executor.");
     }
-    cup_state = new_state;
+    cmd_queue[tail & (CMD_QUEUE_SIZE - 1)] = *cmd;
+    CuAtomicSet(&cmd_tail, (tail + 1) & (2 * CMD_QUEUE_SIZE - 1));
+    return CuSemPost(&cmd_sem, err);
+}
+
+// Take the next request off the queue, parking the executor until there is
+// one.
+static bool PopCmd(CpuCmd* restrict cmd, CuError* restrict err) {
+    RET_ON_ERR(CuSemWait(&cmd_sem, err));
+    const int head = CuAtomicGet(&cmd_head);
+    *cmd = cmd_queue[head & (CMD_QUEUE_SIZE - 1)];
+    CuAtomicSet(&cmd_head, (head + 1) & (2 * CMD_QUEUE_SIZE - 1));
     return true;
 }
 
+static inline bool IsCmdPending(void) {
+    return CuAtomicGet(&cmd_tail) != CuAtomicGet(&cmd_head);
+}
+
+bool CuSetCpuState(CuCpuState new_state, CuError* restrict err) {
+    switch (new_state) {
+      case CU_CPU_RUNNING:
+        return CuRunCpu(CU_CPU_RUN_NO_LIMIT, CU_CPU_RUN_NO_UNTIL, err);
+      case CU_CPU_PAUSED:
+        return CuPauseCpu(err);
+      case CU_CPU_QUITTING:
+        break;
+      default:
+        return CuErrMsg(err, "Invalid new state.");
+    }
+    const CpuCmd cmd = {.kind = CPU_CMD_QUIT};
+    RET_ON_ERR(CuMutLock(&cup_ctl_mut, err));
+    CuAtomicSet(&cup_state, CU_CPU_QUITTING);
+    const bool sent = PushCmd(&cmd, err);
+    CuError nerr;
+    RET_ON_ERR(CuMutUnlock(&cup_ctl_mut, sent ? err : &nerr));
+    return sent;
+}
+
 bool CuGetIntReg(uint8_t r_n, uint32_t* restrict r_val, CuError* restrict err) {
     if (r_n >= CU_NUM_IREGS) {
         return CuErrMsg(err, "Bad register (r_n=%02" PRIx8 ").");
     }
-    *r_val = cup_iregs[r_n];
+    *r_val = cup_sel->iregs[r_n];
     return true;
 }
 
@@ -94,21 +356,21 @@ bool CuSetIntReg(uint8_t r_n, uint32_t r_val, CuError* restrict err) {
         return CuErrMsg(err, "Bad register (r_n=%02" PRIx8 ").");
     }
     if (r_n != 0x00) {
-        cup_iregs[r_n] = r_val;
+        cup_sel->iregs[r_n] = r_val;
     }
     return true;
 }
 
 uint32_t CuGetExtPrecReg() {
-    return cup_epr;
+    return cup_sel->epr;
 }
 
 void CuSetExtPrecReg(uint32_t r_val) {
-    cup_epr = r_val;
+    cup_sel->epr = r_val;
 }
 
 uint32_t CuGetProgCtr(void) {
-    return cup_pc;
+    return cup_sel->pc;
 }
 
 bool CuSetProgCtr(uint32_t pc, CuError* restrict err) {
@@ -116,58 +378,114 @@ bool CuSetProgCtr(uint32_t pc, CuError* restrict err) {
     if (pc & 0x00000003U) {
         return CuErrMsg(err, "Unaligned instruction (PC=%08" PRIx32 ").", pc);
     }
-    cup_pc = pc;
+    cup_sel->pc = pc;
     return true;
 }
 
+uint32_t CuGetProcStatReg(void) {
+    return cup_sel->psr;
+}
+
+void CuSetProcStatReg(uint32_t r_val) {
+    cup_sel->psr = r_val;
+}
+
 bool CuIsNegFlagSet(void) {
-    return (cup_psr & 0x00000008U) > 0;
+    return (cup_sel->psr & CU_PSR_NEG) > 0;
 }
 
 bool CuIsOvfFlagSet(void) {
-    return (cup_psr & 0x00000004U) > 0;
+    return (cup_sel->psr & CU_PSR_OVF) > 0;
 }
 
 bool CuIsCarFlagSet(void) {
-    return (cup_psr & 0x00000002U) > 0;
+    return (cup_sel->psr & CU_PSR_CAR) > 0;
 }
 
 bool CuIsZerFlagSet(void) {
-    return (cup_psr & 0x00000001U) > 0;
+    return (cup_sel->psr & CU_PSR_ZER) > 0;
 }
 
 void CuSetIntFlags(bool neg, bool ovf, bool car, bool zer) {
     if (neg) {
-        cup_psr |= 0x00000008U;
+        cup_sel->psr |= CU_PSR_NEG;
     }
     if (ovf) {
-        cup_psr |= 0x00000004U;
+        cup_sel->psr |= CU_PSR_OVF;
     }
     if (car) {
-        cup_psr |= 0x00000002U;
+        cup_sel->psr |= CU_PSR_CAR;
     }
     if (zer) {
-        cup_psr |= 0x00000001U;
+        cup_sel->psr |= CU_PSR_ZER;
     }
 }
 
-static inline bool GetNextInsn(uint32_t* restrict insn, CuError* restrict err) {
+static inline bool GetNextInsn(const CuCore* restrict core,
+  uint32_t* restrict insn, CuError* restrict err) {
     CuError nerr;
-    if (!CuGetWordAt(cup_pc, insn, &nerr)) {
+    const bool fetched = core->sbuf == NULL ?
+      CuGetWordAt(core->pc, insn, &nerr) :
+      CuSbufGetWordAt(core->sbuf, core->pc, insn, &nerr);
+    if (!fetched) {
         return CuErrMsg(err, "Error reading next instruction: %s",
           nerr.err_msg);
     }
     return true;
 }
 
-static inline bool ExecOneInsn(CuError* restrict err) {
+void CuEnablePipelineModel(bool enable) {
+    pipe_model_enabled = enable;
+}
+
+bool CuIsPipelineModelEnabled(void) {
+    return pipe_model_enabled;
+}
+
+static inline bool ExecInsn(CuCore* restrict core, uint32_t insn,
+  CuError* restrict err) {
+    const uint32_t pc = core->pc;
+    RET_ON_ERR(CuExecOp(core, insn, err));
+    CuTimCountOp(&core->tim, insn);
+    if (pipe_model_enabled && core == &cup_cores[0]) {
+        CuPipeIssue(pc, insn, core->pc);
+    }
+    if (++core->insns == cup_next_ckpt) {
+        RET_ON_ERR(CuCkptTake(err));
+    }
+    return true;
+}
+
+static inline bool ExecOneInsn(CuCore* restrict core, CuError* restrict err) {
     uint32_t insn;
-    RET_ON_ERR(GetNextInsn(&insn, err));
-    RET_ON_ERR(CuExecOp(cup_pc, insn, err));
+    RET_ON_ERR(GetNextInsn(core, &insn, err));
+    RET_ON_ERR(ExecInsn(core, insn, err));
     return true;
 }
 
-static inline bool IsBreakPoint(uint32_t addr) {
+void CuGetCpuTimingStats(CuTimingStats* restrict stats) {
+    CuTimCounters total = {.insns = 0, .cycles = 0};
+    for (int i = 0; i < num_cores; i++) {
+        total.insns += cup_cores[i].tim.insns;
+        total.cycles += cup_cores[i].tim.cycles;
+    }
+    CuTimGetStats(&total, stats);
+}
+
+uint64_t CuGetCpuInsnCount(void) {
+    return cup_sel->insns;
+}
+
+void CuSetCpuInsnCount(uint64_t count) {
+    cup_sel->insns = count;
+}
+
+void CuSetCpuNextCkpt(uint64_t count) {
+    cup_next_ckpt = count;
+}
+
+// Whether there is a break-point at `addr`, regardless of its condition.
+static inline bool HasBreakPoint(uint32_t addr) {
     for (int i = 0; i < num_break_points; i++) {
         if (cup_break_points[i] == addr) {
             return true;
@@ -176,47 +494,591 @@ static inline bool IsBreakPoint(uint32_t addr) {
     return false;
 }
 
-bool CuRunExecution(CuError* restrict err) {
-    cup_state = CU_CPU_RUNNING;
+// Check whether there is a break-point at the program-counter of `core` whose
+// condition holds.
+static inline bool IsBreakPoint(const CuCore* restrict core) {
+    for (int i = 0; i < num_break_points; i++) {
+        if (cup_break_points[i] == core->pc) {
+            PointCond* pc = &cup_bp_conds[i];
+            CuSpinLockAcquire(&points_lock);
+            pc->hits++;
+            const CuBpCondCtx ctx = {
+                .core = core, .hits = pc->hits, .val = 0, .old = 0,
+            };
+            const bool holds = CuEvalBpCond(&pc->cond, &ctx);
+            CuSpinLockRelease(&points_lock);
+            return holds;
+        }
+    }
+    return false;
+}
+
+static uint32_t GetWatchedVal(const WatchPoint* restrict wp) {
+    CuError nerr;
+    uint8_t b = 0;
+    uint16_t h = 0;
+    uint32_t w = 0;
+    switch (wp->size) {
+      case 1:
+        CuGetByteAt(wp->addr, &b, &nerr);
+        return b;
+
+      case 2:
+        CuGetHalfWordAt(wp->addr, &h, &nerr);
+        return h;
+    }
+    CuGetWordAt(wp->addr, &w, &nerr);
+    return w;
+}
+
+// Called after every store to memory while there are watch-points.
+static void CheckWatchPoints(CuCore* restrict core, uint32_t addr,
+  uint32_t nbytes) {
+    CuSpinLockAcquire(&points_lock);
+    for (int i = 0; i < num_watch_points; i++) {
+        WatchPoint* wp = &cup_watch_points[i];
+        if (addr + nbytes <= wp->addr || addr >= wp->addr + wp->size) {
+            continue;
+        }
+        const uint32_t old = wp->val;
+        wp->val = GetWatchedVal(wp);
+        wp->cond.hits++;
+        const CuBpCondCtx ctx = {
+            .core = core, .hits = wp->cond.hits, .val = wp->val, .old = old,
+        };
+        if (CuEvalBpCond(&wp->cond.cond, &ctx)) {
+            core->watch_hit = true;
+        }
+    }
+    CuSpinLockRelease(&points_lock);
+}
+
+static bool RecordStop(CuCpuStopReason reason, uint64_t insns,
+  uint64_t host_ns, CuError* restrict err) {
+    RET_ON_ERR(CuMutLock(&cup_stop_mut, err));
+    cup_stop_info.seq++;
+    cup_stop_info.reason = reason;
+    cup_stop_info.insns = insns;
+    cup_stop_info.host_ns = host_ns;
+    cup_stop_info.pc = cup_sel->pc;
+    cup_stop_info.core = (int)cup_sel->id;
+    CuCpuState new_state = CU_CPU_PAUSED;
+    if (reason == CU_CPU_STOP_ERROR) {
+        new_state = CU_CPU_ERROR;
+    } else if (reason == CU_CPU_STOP_BREAK_POINT ||
+      reason == CU_CPU_STOP_WATCH_POINT) {
+        new_state = CU_CPU_BREAK_POINT;
+    }
+    // Do not override a request to quit made in the meanwhile.
+    CuAtomicCas(&cup_state, CU_CPU_RUNNING, new_state);
+    RET_ON_ERR(CuCondVarSignal(&cup_stop_cv, err));
+    RET_ON_ERR(CuMutUnlock(&cup_stop_mut, err));
+    if (cup_stop_hook != NULL) {
+        cup_stop_hook();
+    }
+    return true;
+}
+
+// Whether `core` should stop running instructions, because of a request to
+// the executor (only polled by the first core) or because another core has
+// stopped. With pacing, this first waits for host-time to catch up with the
+// simulated time of `core`, polling all the while.
+static inline bool IsRunInterrupted(const CuCore* restrict core,
+  CuTimPacer* restrict pacer) {
     do {
-        if (IsBreakPoint(cup_pc)) {
-            cup_state = CU_CPU_BREAK_POINT;
+        if (core == &cup_cores[0] && IsCmdPending()) {
+            return true;
+        }
+        if (num_cores > 1 && CuAtomicGet(&cores_stop) != CU_CPU_STOP_NONE) {
+            return true;
+        }
+    } while (CuTimIsPaced() && !CuTimPace(pacer, &core->tim));
+    return false;
+}
+
+// Why `core` should stop after executing the `n`-th instruction of the current
+// run, if it should.
+static inline CuCpuStopReason GetStopReason(CuCore* restrict core,
+  uint64_t n) {
+    if (core->watch_hit) {
+        core->watch_hit = false;
+        return CU_CPU_STOP_WATCH_POINT;
+    }
+    if (IsBreakPoint(core)) {
+        return CU_CPU_STOP_BREAK_POINT;
+    }
+    if (core->pc == cup_until_addr) {
+        return CU_CPU_STOP_UNTIL;
+    }
+    if (n == cup_run_limit) {
+        return CU_CPU_STOP_RUN_DONE;
+    }
+    return CU_CPU_STOP_NONE;
+}
+
+// Execute instructions on the core of `run` at full speed until a break-point,
+// a limit set by `CuRunCpu()`, an error, another request (to pause or to
+// quit), or another core stopping.
+static void RunCore(CoreRun* restrict run) {
+    CuCore* core = run->core;
+    CuCpuStopReason reason = CU_CPU_STOP_PAUSED;
+    uint64_t n = 0;
+    if (num_cores > 1) {
+        int ready;
+        do {
+            ready = CuAtomicGet(&cores_ready);
+        } while (!CuAtomicCas(&cores_ready, ready, ready + 1));
+        while (CuAtomicGet(&cores_ready) < num_cores &&
+          CuAtomicGet(&cores_stop) == CU_CPU_STOP_NONE) {
+            // Wait for the other cores to start.
+        }
+    }
+    CuTimPacer pacer;
+    CuTimStartPacer(&pacer, &core->tim);
+    while ((n & (CMD_POLL_INSNS - 1)) != 0 ||
+      !IsRunInterrupted(core, &pacer)) {
+        if (!ExecOneInsn(core, &run->err)) {
+            reason = CU_CPU_STOP_ERROR;
+            break;
+        }
+        n++;
+        const CuCpuStopReason why = GetStopReason(core, n);
+        if (why != CU_CPU_STOP_NONE) {
+            reason = why;
+            break;
+        }
+    }
+    run->insns = n;
+    run->reason = reason;
+    if (num_cores > 1 && CuAtomicCas(&cores_stop, CU_CPU_STOP_NONE, reason)) {
+        stop_core = (int)core->id;
+    }
+}
+
+// Select the core `n` that stopped the run that started at `start_ns` after
+// executing `insns` instructions over all of the cores, and report the stop.
+static bool FinishRun(int n, uint64_t insns, uint64_t start_ns,
+  CuError* restrict err) {
+    const CoreRun* stopped = &core_runs[n];
+    cup_sel = stopped->core;
+    if (stopped->reason == CU_CPU_STOP_ERROR) {
+        *err = stopped->err;
+    }
+    CuError nerr;
+    RET_ON_ERR(RecordStop(stopped->reason, insns, CuTimGetHostNs() - start_ns,
+      (stopped->reason == CU_CPU_STOP_ERROR) ? &nerr : err));
+    return stopped->reason != CU_CPU_STOP_ERROR;
+}
+
+static int RunCoreThread(void* data) {
+    RunCore(data);
+    return 0;
+}
+
+// Run every core until one of them stops, with the first core on this thread
+// and the rest on threads of their own, then select the core that stopped.
+static bool RunUntilStopped(CuError* restrict err) {
+    const uint64_t start_ns = CuTimGetHostNs();
+    CuTimStartHostClock();
+    CuAtomicSet(&cores_stop, CU_CPU_STOP_NONE);
+    CuAtomicSet(&cores_ready, 0);
+    stop_core = 0;
+    int num_started = 1;
+    for (; num_started < num_cores; num_started++) {
+        CoreRun* run = &core_runs[num_started];
+        run->core = &cup_cores[num_started];
+        if (!CuThrCreate(RunCoreThread, "CUP Core", run, &run->thr, err)) {
+            break;
+        }
+    }
+    CoreRun* first = &core_runs[0];
+    first->core = &cup_cores[0];
+    if (num_started == num_cores) {
+        RunCore(first);
+    } else {
+        // Stop the cores already started.
+        first->insns = 0;
+        first->reason = CU_CPU_STOP_ERROR;
+        first->err = *err;
+        if (CuAtomicCas(&cores_stop, CU_CPU_STOP_NONE, CU_CPU_STOP_ERROR)) {
+            stop_core = 0;
+        }
+    }
+    uint64_t insns = first->insns;
+    for (int i = 1; i < num_started; i++) {
+        int status;
+        CuError nerr;
+        CuThrWait(&core_runs[i].thr, &status, &nerr);
+        insns += core_runs[i].insns;
+    }
+    CuTimStopHostClock();
+    return FinishRun(stop_core, insns, start_ns, err);
+}
+
+// Run a quantum of instructions on the core of `run` for the deterministic
+// scheduler, ending it early at an instruction that synchronizes with other
+// cores, at a break-point, or once the store-buffer of the core fills up. The
+// run itself stops for the same reasons as with `RunCore()`, except for
+// another request. Since the hit-count of a break-point is shared by the
+// cores, its hits are only counted between quanta, in the order of the cores.
+static void RunQuantum(CoreRun* restrict run) {
+    CuCore* core = run->core;
+    for (uint64_t n = 0; n < cup_quantum && !core->sbuf_full; n++) {
+        uint32_t insn;
+        if (!GetNextInsn(core, &insn, &run->err)) {
+            run->reason = CU_CPU_STOP_ERROR;
+            return;
+        }
+        if (CuIsSyncOp(insn)) {
+            run->sync_pending = true;
+            return;
+        }
+        if (!ExecInsn(core, insn, &run->err)) {
+            run->reason = CU_CPU_STOP_ERROR;
+            return;
+        }
+        run->insns++;
+        if (HasBreakPoint(core->pc)) {
+            run->bp_pending = true;
+            return;
+        }
+        run->reason = GetStopReason(core, run->insns);
+        if (run->reason != CU_CPU_STOP_NONE) {
+            return;
+        }
+    }
+}
+
+static int QuantumWorkerThread(void* data) {
+    CoreRun* run = data;
+    const int id = (int)run->core->id;
+    CuError nerr;
+    for (;;) {
+        CuSemWait(&quantum_go[id], &nerr);
+        if (quantum_end) {
+            break;
+        }
+        RunQuantum(run);
+        CuSemPost(&quantum_done, &nerr);
+    }
+    return 0;
+}
+
+// Called for every run of bytes committed from the store-buffer of a core.
+static void CommitHook(void* data, uint32_t addr, uint32_t nbytes) {
+    if (num_watch_points > 0) {
+        CheckWatchPoints(data, addr, nbytes);
+    }
+}
+
+// Bring the cores together after the quantum `epoch`, committing their
+// store-buffers and then executing their pending synchronizing instructions.
+// Returns whether any of them has stopped.
+static bool EndQuantum(uint64_t epoch) {
+    for (int i = 0; i < num_cores; i++) {
+        CoreRun* run = &core_runs[i];
+        CuCore* core = run->core;
+        if (!CuSbufCommit(core->sbuf, CommitHook, core, &run->err)) {
+            run->reason = CU_CPU_STOP_ERROR;
+        }
+        core->sbuf_full = false;
+        if (core->watch_hit && run->reason == CU_CPU_STOP_NONE) {
+            run->reason = CU_CPU_STOP_WATCH_POINT;
+        }
+        core->watch_hit = false;
+    }
+    for (int i = 0; i < num_cores; i++) {
+        CoreRun* run = &core_runs[i];
+        if (run->bp_pending) {
+            run->bp_pending = false;
+            if (run->reason == CU_CPU_STOP_NONE) {
+                run->reason = GetStopReason(run->core, run->insns);
+            }
+        }
+    }
+    for (int i = 0; i < num_cores; i++) {
+        CoreRun* run = &core_runs[(epoch + (uint64_t)i) % (uint64_t)num_cores];
+        if (!run->sync_pending) {
+            continue;
+        }
+        run->sync_pending = false;
+        if (!ExecOneInsn(run->core, &run->err)) {
+            run->reason = CU_CPU_STOP_ERROR;
+            continue;
         }
-        if (cup_state == CU_CPU_BREAK_POINT || cup_state == CU_CPU_PAUSED) {
-            RET_ON_ERR(CuMutLock(&cup_state_mut, err));
-            RET_ON_ERR(CuCondVarWait(&cup_state_cv, &cup_state_mut, err));
-            RET_ON_ERR(CuMutUnlock(&cup_state_mut, err));
+        run->insns++;
+        run->reason = GetStopReason(run->core, run->insns);
+    }
+    bool stopped = false;
+    for (int i = 0; i < num_cores; i++) {
+        stopped = stopped || core_runs[i].reason != CU_CPU_STOP_NONE;
+    }
+    return stopped;
+}
+
+// Run every core in quanta until one of them stops (see `cup_quantum`), with
+// the first core on this thread and the rest on threads of their own, then
+// select the first core that stopped.
+static bool RunQuanta(CuError* restrict err) {
+    const uint64_t start_ns = CuTimGetHostNs();
+    CuTimStartHostClock();
+    CuAtomicSet(&cores_stop, CU_CPU_STOP_NONE);
+    quantum_end = false;
+    for (int i = 0; i < num_cores; i++) {
+        CoreRun* run = &core_runs[i];
+        run->core = &cup_cores[i];
+        run->core->sbuf = core_sbufs[i];
+        run->core->sbuf_full = false;
+        run->insns = 0;
+        run->reason = CU_CPU_STOP_NONE;
+        run->sync_pending = false;
+        run->bp_pending = false;
+    }
+    CoreRun* first = &core_runs[0];
+    int num_started = 1;
+    for (; num_started < num_cores; num_started++) {
+        CoreRun* run = &core_runs[num_started];
+        if (!CuThrCreate(QuantumWorkerThread, "CUP Core", run, &run->thr,
+          &first->err)) {
+            first->reason = CU_CPU_STOP_ERROR;
+            break;
+        }
+    }
+    CuError nerr;
+    CuTimPacer pacer;
+    CuTimStartPacer(&pacer, &first->core->tim);
+    bool stopped = num_started < num_cores;
+    for (uint64_t epoch = 0; !stopped; epoch++) {
+        for (int i = 1; i < num_cores; i++) {
+            CuSemPost(&quantum_go[i], &nerr);
         }
-        if (!ExecOneInsn(err)) {
-            cup_state = CU_CPU_ERROR;
-            return false;
+        RunQuantum(first);
+        for (int i = 1; i < num_cores; i++) {
+            CuSemWait(&quantum_done, &nerr);
         }
-    } while (cup_state != CU_CPU_QUITTING);
+        stopped = EndQuantum(epoch);
+        if (!stopped && IsRunInterrupted(first->core, &pacer)) {
+            first->reason = CU_CPU_STOP_PAUSED;
+            stopped = true;
+        }
+    }
+    quantum_end = true;
+    for (int i = 1; i < num_started; i++) {
+        int status;
+        CuSemPost(&quantum_go[i], &nerr);
+        CuThrWait(&core_runs[i].thr, &status, &nerr);
+    }
+    CuTimStopHostClock();
+
+    uint64_t insns = 0;
+    int stopped_core = -1;
+    for (int i = 0; i < num_cores; i++) {
+        insns += core_runs[i].insns;
+        cup_cores[i].sbuf = NULL;
+        if (stopped_core < 0 && core_runs[i].reason != CU_CPU_STOP_NONE) {
+            stopped_core = i;
+        }
+    }
+    return FinishRun(stopped_core, insns, start_ns, err);
+}
+
+// Execute a single instruction on the selected core on behalf of
+// `CuExecSingleStep()`.
+static bool StepOneInsn(CuError* restrict err) {
+    CuTimStartHostClock();
+    const bool exec_ok = ExecOneInsn(cup_sel, err);
+    CuTimStopHostClock();
+    cup_sel->watch_hit = false;
+    if (!exec_ok) {
+        CuAtomicSet(&cup_state, CU_CPU_ERROR);
+        return false;
+    }
+    CuAtomicSet(&cup_state, IsBreakPoint(cup_sel) ? CU_CPU_BREAK_POINT :
+      CU_CPU_PAUSED);
     return true;
 }
 
+bool CuRunExecution(CuError* restrict err) {
+    for (;;) {
+        CpuCmd cmd;
+        RET_ON_ERR(PopCmd(&cmd, err));
+        switch (cmd.kind) {
+          case CPU_CMD_RUN:
+            cup_run_limit = cmd.max_insns;
+            cup_until_addr = cmd.until_addr;
+            if (cup_quantum != 0 && num_cores > 1) {
+                RET_ON_ERR(RunQuanta(err));
+            } else {
+                RET_ON_ERR(RunUntilStopped(err));
+            }
+            break;
+          case CPU_CMD_STEP:
+            step_ok = StepOneInsn(&step_err);
+            RET_ON_ERR(CuSemPost(&step_sem, err));
+            break;
+          case CPU_CMD_PAUSE:
+            // Already stopped, by this or by something else in the meanwhile.
+            break;
+          case CPU_CMD_QUIT:
+            return true;
+        }
+    }
+}
+
 bool CuExecSingleStep(CuError* restrict err) {
-    if (cup_state != CU_CPU_PAUSED && cup_state != CU_CPU_BREAK_POINT) {
-        return CuErrMsg(err, "Incorrect state for single-stepping.");
+    const CpuCmd cmd = {.kind = CPU_CMD_STEP};
+    RET_ON_ERR(CuMutLock(&cup_ctl_mut, err));
+    const bool sent = IsStopped(CuGetCpuState()) ?
+      PushCmd(&cmd, err) && CuSemWait(&step_sem, err) :
+      CuErrMsg(err, "Incorrect state for single-stepping.");
+    CuError nerr;
+    RET_ON_ERR(CuMutUnlock(&cup_ctl_mut, sent ? err : &nerr));
+    RET_ON_ERR(sent);
+    if (!step_ok) {
+        *err = step_err;
     }
-    if (!ExecOneInsn(err)) {
-        cup_state = CU_CPU_ERROR;
-        return false;
+    return step_ok;
+}
+
+bool CuReplayCpu(uint64_t target, uint64_t* restrict last_stop,
+  CuError* restrict err) {
+    if (!IsStopped(CuGetCpuState())) {
+        return CuErrMsg(err, "Incorrect state for replaying.");
+    }
+    // Checkpoints are only supported with a single core.
+    CuCore* core = &cup_cores[0];
+    *last_stop = CU_CPU_NO_STOP;
+    core->watch_hit = false;
+    while (core->insns < target) {
+        uint32_t insn;
+        RET_ON_ERR(GetNextInsn(core, &insn, err));
+        RET_ON_ERR(CuExecOp(core, insn, err));
+        CuTimCountOp(&core->tim, insn);
+        if (++core->insns == cup_next_ckpt) {
+            RET_ON_ERR(CuCkptTake(err));
+        }
+        if (core->watch_hit) {
+            core->watch_hit = false;
+            *last_stop = core->insns;
+        } else if (IsBreakPoint(core)) {
+            *last_stop = core->insns;
+        }
     }
-    if (IsBreakPoint(cup_pc)) {
-        cup_state = CU_CPU_BREAK_POINT;
+    return true;
+}
+
+bool CuRunCpu(uint64_t max_insns, uint32_t until_addr,
+  CuError* restrict err) {
+    const CpuCmd cmd = {
+        .kind = CPU_CMD_RUN, .max_insns = max_insns, .until_addr = until_addr,
+    };
+    RET_ON_ERR(CuMutLock(&cup_ctl_mut, err));
+    // The executor does not change the state while stopped, except for a
+    // single-step, which is excluded by `cup_ctl_mut`.
+    const CuCpuState state = CuGetCpuState();
+    bool sent = false;
+    if (IsStopped(state)) {
+        CuAtomicSet(&cup_state, CU_CPU_RUNNING);
+        sent = PushCmd(&cmd, err);
+        if (!sent) {
+            CuAtomicSet(&cup_state, state);
+        }
     } else {
-        cup_state = CU_CPU_PAUSED;
+        CuErrMsg(err, "Incorrect state for running.");
+    }
+    CuError nerr;
+    RET_ON_ERR(CuMutUnlock(&cup_ctl_mut, sent ? err : &nerr));
+    return sent;
+}
+
+bool CuPauseCpu(CuError* restrict err) {
+    if (CuGetCpuState() != CU_CPU_RUNNING) {
+        return true;
+    }
+    const CpuCmd cmd = {.kind = CPU_CMD_PAUSE};
+    RET_ON_ERR(CuMutLock(&cup_ctl_mut, err));
+    const bool sent = PushCmd(&cmd, err);
+    CuError nerr;
+    RET_ON_ERR(CuMutUnlock(&cup_ctl_mut, sent ? err : &nerr));
+    RET_ON_ERR(sent);
+    return CuWaitCpuStopped(err);
+}
+
+// Block the caller until the executor stops running instructions.
+bool CuWaitCpuStopped(CuError* restrict err) {
+    RET_ON_ERR(CuMutLock(&cup_stop_mut, err));
+    while (CuGetCpuState() == CU_CPU_RUNNING) {
+        RET_ON_ERR(CuCondVarWait(&cup_stop_cv, &cup_stop_mut, err));
+    }
+    RET_ON_ERR(CuMutUnlock(&cup_stop_mut, err));
+    return true;
+}
+
+void CuGetCpuStopInfo(CuCpuStopInfo* restrict info) {
+    if (info == NULL) {
+        return;
     }
+    CuError err;
+    if (!CuMutLock(&cup_stop_mut, &err)) {
+        return;
+    }
+    *info = cup_stop_info;
+    CuMutUnlock(&cup_stop_mut, &err);
+}
+
+void CuSetCpuStopHook(CuCpuStopHookFn hook) {
+    cup_stop_hook = hook;
+}
+
+const char* CuCpuStopReasonName(CuCpuStopReason reason) {
+    switch (reason) {
+      case CU_CPU_STOP_NONE:
+        return "not stopped";
+      case CU_CPU_STOP_PAUSED:
+        return "paused";
+      case CU_CPU_STOP_BREAK_POINT:
+        return "break-point";
+      case CU_CPU_STOP_RUN_DONE:
+        return "run completed";
+      case CU_CPU_STOP_UNTIL:
+        return "reached address";
+      case CU_CPU_STOP_WATCH_POINT:
+        return "watch-point";
+      case CU_CPU_STOP_ERROR:
+        return "error";
+    }
+    return "unknown";
+}
+
+// Compile `src` into `pc`, resetting its hit-count.
+static bool SetPointCond(PointCond* restrict pc, const char* restrict src,
+  CuError* restrict err) {
+    if (src != NULL && strlen(src) >= CU_BP_COND_MAX_SRC) {
+        return CuErrMsg(err, "Condition too long.");
+    }
+    RET_ON_ERR(CuCompileBpCond(src, &pc->cond, err));
+    pc->hits = 0;
+    strcpy(pc->src, (src == NULL) ? "" : src);
     return true;
 }
 
 bool CuAddBreakPoint(uint32_t addr, CuError* restrict err) {
+    return CuAddCondBreakPoint(addr, NULL, err);
+}
+
+bool CuAddCondBreakPoint(uint32_t addr, const char* restrict cond,
+  CuError* restrict err) {
     RET_ON_ERR(CuIsValidPhyMemAddr(addr, err));
-    for (int i = 0; i < MAX_BREAK_POINTS; i++) {
-        if (cup_break_points[i] == INVALID_BREAK_POINT) {
+    PointCond pc;
+    RET_ON_ERR(SetPointCond(&pc, cond, err));
+    for (int i = 0; i < CU_MAX_BREAK_POINTS; i++) {
+        if (cup_break_points[i] == addr ||
+          cup_break_points[i] == INVALID_BREAK_POINT) {
+            if (cup_break_points[i] == INVALID_BREAK_POINT) {
+                num_break_points++;
+            }
             cup_break_points[i] = addr;
-            num_break_points++;
+            cup_bp_conds[i] = pc;
             return true;
         }
     }
@@ -225,22 +1087,134 @@ bool CuAddBreakPoint(uint32_t addr, CuError* restrict err) {
 
 bool CuRemoveBreakPoint(uint32_t addr, CuError* restrict err) {
     int i = 0;
-    for (i = 0; i < MAX_BREAK_POINTS; i++) {
+    for (i = 0; i < CU_MAX_BREAK_POINTS; i++) {
         if (cup_break_points[i] == addr) {
             break;
         }
     }
-    if (i == MAX_BREAK_POINTS) {
-        return CuErrMsg(err, "Could not find break-point '" PRIx32 "'.", addr);
+    if (i == CU_MAX_BREAK_POINTS) {
+        return CuErrMsg(err, "Could not find break-point '%08" PRIx32 "'.",
+          addr);
     }
     // Compact the table of break-points for faster searches.
-    for (; i < (MAX_BREAK_POINTS - 1); i++) {
+    for (; i < (CU_MAX_BREAK_POINTS - 1); i++) {
         if (cup_break_points[i + 1] == INVALID_BREAK_POINT) {
             break;
         }
         cup_break_points[i] = cup_break_points[i + 1];
+        cup_bp_conds[i] = cup_bp_conds[i + 1];
     }
     cup_break_points[i] = INVALID_BREAK_POINT;
     num_break_points--;
     return true;
 }
+
+bool CuAddWatchPoint(uint32_t addr, uint32_t size, const char* restrict cond,
+  CuError* restrict err) {
+    if (size != 1 && size != 2 && size != 4) {
+        return CuErrMsg(err, "Bad watch-point size (%" PRIu32 ").", size);
+    }
+    if ((addr & (size - 1)) != 0) {
+        return CuErrMsg(err, "Unaligned watch-point (%08" PRIx32 ").", addr);
+    }
+    RET_ON_ERR(CuIsValidPhyMemAddr(addr + size - 1, err));
+    int i;
+    for (i = 0; i < num_watch_points; i++) {
+        if (cup_watch_points[i].addr == addr) {
+            break;
+        }
+    }
+    if (i == CU_MAX_WATCH_POINTS) {
+        return CuErrMsg(err, "Cannot add any more watch-points.");
+    }
+    WatchPoint wp = {.addr = addr, .size = size, .val = 0};
+    RET_ON_ERR(SetPointCond(&wp.cond, cond, err));
+    wp.val = GetWatchedVal(&wp);
+    cup_watch_points[i] = wp;
+    if (i == num_watch_points) {
+        num_watch_points++;
+    }
+    // Only check stores while there are watch-points.
+    CuSetStoreHook(CheckWatchPoints);
+    return true;
+}
+
+bool CuRemoveWatchPoint(uint32_t addr, CuError* restrict err) {
+    int i;
+    for (i = 0; i < num_watch_points; i++) {
+        if (cup_watch_points[i].addr == addr) {
+            break;
+        }
+    }
+    if (i == num_watch_points) {
+        return CuErrMsg(err, "Could not find watch-point '%08" PRIx32 "'.",
+          addr);
+    }
+    for (; i < num_watch_points - 1; i++) {
+        cup_watch_points[i] = cup_watch_points[i + 1];
+    }
+    num_watch_points--;
+    if (num_watch_points == 0) {
+        CuSetStoreHook(NULL);
+    }
+    return true;
+}
+
+static void FillPointInfo(uint32_t addr, uint32_t size,
+  const PointCond* restrict pc, CuPointInfo* restrict info) {
+    info->addr = addr;
+    info->size = size;
+    info->hits = pc->hits;
+    strcpy(info->cond, pc->src);
+}
+
+int CuListBreakPoints(CuPointInfo* restrict infos) {
+    for (int i = 0; i < num_break_points; i++) {
+        FillPointInfo(cup_break_points[i], 0, &cup_bp_conds[i], &infos[i]);
+    }
+    return num_break_points;
+}
+
+int CuListWatchPoints(CuPointInfo* restrict infos) {
+    for (int i = 0; i < num_watch_points; i++) {
+        const WatchPoint* wp = &cup_watch_points[i];
+        FillPointInfo(wp->addr, wp->size, &wp->cond, &infos[i]);
+    }
+    return num_watch_points;
+}
+
+void CuGetPointHits(CuPointHits* restrict hits) {
+    hits->num_bps = num_break_points;
+    for (int i = 0; i < num_break_points; i++) {
+        hits->bp_addrs[i] = cup_break_points[i];
+        hits->bp_hits[i] = cup_bp_conds[i].hits;
+    }
+    hits->num_wps = num_watch_points;
+    for (int i = 0; i < num_watch_points; i++) {
+        hits->wp_addrs[i] = cup_watch_points[i].addr;
+        hits->wp_hits[i] = cup_watch_points[i].cond.hits;
+    }
+}
+
+void CuSetPointHits(const CuPointHits* restrict hits) {
+    for (int i = 0; i < num_break_points; i++) {
+        cup_bp_conds[i].hits = 0;
+        for (int j = 0; j < hits->num_bps; j++) {
+            if (hits->bp_addrs[j] == cup_break_points[i]) {
+                cup_bp_conds[i].hits = hits->bp_hits[j];
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < num_watch_points; i++) {
+        WatchPoint* wp = &cup_watch_points[i];
+        wp->cond.hits = 0;
+        for (int j = 0; j < hits->num_wps; j++) {
+            if (hits->wp_addrs[j] == wp->addr) {
+                wp->cond.hits = hits->wp_hits[j];
+                break;
+            }
+        }
+        wp->val = GetWatchedVal(wp);
+    }
+}
@@ -6,11 +6,58 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "bpcond.h"
 #include "errors.h"
+#include "timing.h"
 
 // Number of integer registers.
 #define CU_NUM_IREGS (1 << 5)
 
+// The integer condition-flags in the processor status register.
+#define CU_PSR_NEG 0x00000008U
+#define CU_PSR_OVF 0x00000004U
+#define CU_PSR_CAR 0x00000002U
+#define CU_PSR_ZER 0x00000001U
+
+// How many CUP cores to support, all sharing the same memory.
+#define CU_MAX_CORES 16
+
+struct CuStoreBuf;
+
+// The state of a single CUP core.
+typedef struct CuCore {
+    uint32_t iregs[CU_NUM_IREGS];
+    uint32_t pc;
+    uint32_t psr;
+    // An additional register to provide extended precision during
+    // multiply/divide.
+    uint32_t epr;
+    // The index of the core, from zero onwards, as read by RDCI.
+    uint32_t id;
+    // The word reserved by the last LDLW, along with the value it loaded, for
+    // a later STCW.
+    bool resv_valid;
+    uint32_t resv_addr;
+    uint32_t resv_val;
+    // Set by a store that triggers a watch-point.
+    bool watch_hit;
+    // While running a quantum of the deterministic scheduler, plain loads and
+    // stores go through this store-buffer (see "stbuf.h"), and `sbuf_full` is
+    // set once it needs to be committed.
+    struct CuStoreBuf* sbuf;
+    bool sbuf_full;
+    // The number of instructions executed so far.
+    uint64_t insns;
+    CuTimCounters tim;
+    // Keeps the cores on separate cache-lines, as they run on separate host
+    // threads.
+    uint8_t pad[64];
+} CuCore;
+
+// How many break-points and watch-points to support at a time.
+#define CU_MAX_BREAK_POINTS 16
+#define CU_MAX_WATCH_POINTS 8
+
 typedef enum {
     CU_CPU_ERROR = 0,
     CU_CPU_PAUSED,
@@ -19,10 +66,55 @@ typedef enum {
     CU_CPU_QUITTING,
 } CuCpuState;
 
+// Why the executor last stopped running instructions.
+typedef enum {
+    CU_CPU_STOP_NONE = 0,
+    CU_CPU_STOP_PAUSED,
+    CU_CPU_STOP_BREAK_POINT,
+    CU_CPU_STOP_RUN_DONE,
+    CU_CPU_STOP_UNTIL,
+    CU_CPU_STOP_WATCH_POINT,
+    CU_CPU_STOP_ERROR,
+} CuCpuStopReason;
+
+// What happened during the last run of instructions by the executor.
+typedef struct CuCpuStopInfo {
+    // Incremented every time the executor stops.
+    uint32_t seq;
+    CuCpuStopReason reason;
+    uint64_t insns;
+    uint64_t host_ns;
+    uint32_t pc;
+    // The core that stopped the run, whose program-counter is `pc`.
+    int core;
+} CuCpuStopInfo;
+
+// Arguments to `CuRunCpu()` to run instructions without a limit on their
+// number, or without stopping at a particular address.
+#define CU_CPU_RUN_NO_LIMIT 0U
+#define CU_CPU_RUN_NO_UNTIL 0xFFFFFFFFU
+
 extern bool CuInitCpu(CuError* restrict err);
 extern CuCpuState CuGetCpuState(void);
 extern bool CuSetCpuState(CuCpuState new_state, CuError* restrict err);
 
+// Set the number of cores (one by default), resetting all of them. Only
+// allowed while stopped.
+extern bool CuSetNumCores(int num, CuError* restrict err);
+extern int CuGetNumCores(void);
+extern CuCore* CuGetCore(int n);
+
+// Run several cores deterministically, in quanta of `quantum` instructions
+// (see "doc/cup.md"), or let them run freely with a zero `quantum` (the
+// default). Only allowed while stopped.
+extern bool CuSetQuantum(uint64_t quantum, CuError* restrict err);
+extern uint64_t CuGetQuantum(void);
+
+// Select the core whose state is read and written by the functions below (the
+// first core by default). The executor selects the core that stopped a run.
+extern bool CuSelectCore(int n, CuError* restrict err);
+extern int CuGetSelectedCore(void);
+
 extern bool CuGetIntReg(uint8_t r_n, uint32_t* restrict r_val,
   CuError* restrict err);
 extern bool CuSetIntReg(uint8_t r_n, uint32_t r_val, CuError* restrict err);
@@ -33,16 +125,104 @@ extern void CuSetExtPrecReg(uint32_t r_val);
 extern uint32_t CuGetProgCtr(void);
 extern bool CuSetProgCtr(uint32_t pc, CuError* restrict err);
 
+extern uint32_t CuGetProcStatReg(void);
+extern void CuSetProcStatReg(uint32_t r_val);
+
 extern bool CuIsNegFlagSet(void);
 extern bool CuIsOvfFlagSet(void);
 extern bool CuIsCarFlagSet(void);
 extern bool CuIsZerFlagSet(void);
 extern void CuSetIntFlags(bool neg, bool ovf, bool car, bool zer);
 
+extern void CuEnablePipelineModel(bool enable);
+extern bool CuIsPipelineModelEnabled(void);
+
 extern bool CuRunExecution(CuError* restrict err);
 extern bool CuExecSingleStep(CuError* restrict err);
 
+// The cycle-accounting of the timing-model, summed over all of the cores.
+extern void CuGetCpuTimingStats(CuTimingStats* restrict stats);
+
+// The number of instructions executed so far.
+extern uint64_t CuGetCpuInsnCount(void);
+extern void CuSetCpuInsnCount(uint64_t count);
+
+// Take a checkpoint (see "checkpt.h") when the instruction-count reaches
+// `count`, or never if it is `CU_CPU_NO_CKPT`.
+#define CU_CPU_NO_CKPT UINT64_MAX
+extern void CuSetCpuNextCkpt(uint64_t count);
+
+// Deterministically re-execute instructions while paused, counting their
+// cycles and the hits of break-points and watch-points as when they were first
+// executed, until the instruction-count reaches `target`. Set `last_stop` to
+// the instruction-count at the last point at which a break-point or a
+// watch-point would have stopped the executor, or to `CU_CPU_NO_STOP` if there
+// is none.
+#define CU_CPU_NO_STOP UINT64_MAX
+extern bool CuReplayCpu(uint64_t target, uint64_t* restrict last_stop,
+  CuError* restrict err);
+
+extern bool CuRunCpu(uint64_t max_insns, uint32_t until_addr,
+  CuError* restrict err);
+extern bool CuPauseCpu(CuError* restrict err);
+extern bool CuWaitCpuStopped(CuError* restrict err);
+extern void CuGetCpuStopInfo(CuCpuStopInfo* restrict info);
+extern const char* CuCpuStopReasonName(CuCpuStopReason reason);
+
+// The type of a function called on the executor's thread every time it stops
+// running instructions, once `CuGetCpuStopInfo()` describes the stop.
+typedef void (*CuCpuStopHookFn)(void);
+
+// Set (or clear, with NULL) the function called every time the executor stops.
+// This must be done before the executor starts.
+extern void CuSetCpuStopHook(CuCpuStopHookFn hook);
+
+// A break-point or a watch-point.
+typedef struct CuPointInfo {
+    uint32_t addr;
+    // How many bytes are watched (zero for a break-point).
+    uint32_t size;
+    // How many times the break-point or the watch-point has been hit,
+    // regardless of its condition.
+    uint64_t hits;
+    // The source-text of the condition, if any.
+    char cond[CU_BP_COND_MAX_SRC];
+} CuPointInfo;
+
 extern bool CuAddBreakPoint(uint32_t addr, CuError* restrict err);
 extern bool CuRemoveBreakPoint(uint32_t addr, CuError* restrict err);
 
+// Add a break-point at `addr` that only stops the executor if `cond` (see
+// "bpcond.h") holds, replacing any existing break-point at `addr`.
+extern bool CuAddCondBreakPoint(uint32_t addr, const char* restrict cond,
+  CuError* restrict err);
+
+// Add a watch-point on the `size` (1, 2, or 4) bytes at `addr` that stops the
+// executor after a store to them if `cond` (see "bpcond.h") holds.
+extern bool CuAddWatchPoint(uint32_t addr, uint32_t size,
+  const char* restrict cond, CuError* restrict err);
+extern bool CuRemoveWatchPoint(uint32_t addr, CuError* restrict err);
+
+// Fill `infos` (with room for `CU_MAX_BREAK_POINTS` or `CU_MAX_WATCH_POINTS`)
+// and return the number of break-points or watch-points.
+extern int CuListBreakPoints(CuPointInfo* restrict infos);
+extern int CuListWatchPoints(CuPointInfo* restrict infos);
+
+// The hit-counts of the break-points and the watch-points, by their addresses,
+// as saved and restored by checkpoints (see "checkpt.h").
+typedef struct CuPointHits {
+    int num_bps;
+    uint32_t bp_addrs[CU_MAX_BREAK_POINTS];
+    uint64_t bp_hits[CU_MAX_BREAK_POINTS];
+    int num_wps;
+    uint32_t wp_addrs[CU_MAX_WATCH_POINTS];
+    uint64_t wp_hits[CU_MAX_WATCH_POINTS];
+} CuPointHits;
+
+extern void CuGetPointHits(CuPointHits* restrict hits);
+// Set the hit-count of every break-point and watch-point to the one for its
+// address in `hits`, or to zero if there is none (as it was added later), and
+// re-read the values at the watch-points from memory.
+extern void CuSetPointHits(const CuPointHits* restrict hits);
+
 #endif  // CUSS_CPU_INCLUDED
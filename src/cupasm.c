@@ -0,0 +1,603 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+#include "logger.h"
+#include "openc.h"
+#include "timing.h"
+
+// An assembler turning CUP assembly-language into a memory-image for CUSS.
+//
+// Every line holds any number of "<label>:" definitions, followed by an
+// instruction (see "openc.h") or a directive, with '#' starting a comment.
+// The directives are:
+//
+//   .org <addr>: Start a new section of the memory-image at <addr>.
+//   .word <val>[, <val>...]: Emit 32-bit words (numbers or labels).
+//   .space <n>: Emit <n> zero-bytes.
+//   .align <n>: Emit zero-bytes up to the next multiple of <n> bytes.
+//
+// The source is read into memory at once and assembled in two passes: the
+// first finds the address of every label and the second encodes everything.
+
+#define MAX_ARG_VAL_SIZE 256
+
+#define RET_FAIL_ON_ERR(e) \
+  do { \
+      if (!(e)) { \
+          return EXIT_FAILURE; \
+      } \
+  } while (false)
+
+typedef struct AsmOptions {
+    bool info_req;
+    char src_file[MAX_ARG_VAL_SIZE];
+    char out_file[MAX_ARG_VAL_SIZE];
+    char map_file[MAX_ARG_VAL_SIZE];
+} AsmOptions;
+
+typedef struct Label {
+    const char* name;
+    uint32_t len;
+    uint32_t hash;
+    uint32_t addr;
+} Label;
+
+typedef struct Section {
+    uint32_t base;
+    size_t off;
+    uint32_t nbytes;
+} Section;
+
+// A slot in the hash-table of labels, holding the hash of the name of a label
+// so that most mismatches are found without touching the label itself.
+typedef struct LabelSlot {
+    uint32_t hash;
+    uint32_t idx;
+} LabelSlot;
+
+// Labels in the order of their definitions, and an open-addressed hash-table
+// of their indices (plus one) keyed by their names.
+static Label* labels = NULL;
+static uint32_t num_labels = 0;
+static uint32_t labels_cap = 0;
+static LabelSlot* label_tab = NULL;
+static uint32_t label_tab_size = 0;
+
+// The sections of the memory-image, with their contents in `data`.
+static Section* sections = NULL;
+static uint32_t num_sections = 0;
+static uint32_t sections_cap = 0;
+static uint8_t* data = NULL;
+static size_t data_len = 0;
+static size_t data_cap = 0;
+
+static uint64_t num_insns = 0;
+
+static void PrintUsage(const char* restrict prg) {
+    CuLogInfo("Assembler for CUP, producing memory-images for CUSS.");
+    CuLogInfo("Usage: %s [options] <file>", prg);
+    CuLogInfo("Options:");
+    CuLogInfo("  -h, --help: Show this help-message.");
+    CuLogInfo("  -o=<file>, --output=<file>: Write the memory-image to "
+      "<file>.");
+    CuLogInfo("  -y=<file>, --symbols=<file>: Write the labels to the map-file "
+      "<file>.");
+}
+
+static const char* OptVal(const char* restrict arg, const char* restrict sopt,
+  const char* restrict lopt) {
+    const size_t slen = strlen(sopt);
+    const size_t llen = strlen(lopt);
+    if (strncmp(arg, sopt, slen) == 0) {
+        return arg + slen;
+    }
+    if (strncmp(arg, lopt, llen) == 0) {
+        return arg + llen;
+    }
+    return NULL;
+}
+
+static bool ParseCommandLine(int argc, char *argv[],
+  AsmOptions* restrict opts) {
+    opts->info_req = false;
+    opts->src_file[0] = '\0';
+    opts->out_file[0] = '\0';
+    opts->map_file[0] = '\0';
+
+    for (int i = 1; i < argc; i++) {
+        const char* restrict arg = argv[i];
+        const char* val = NULL;
+
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            opts->info_req = true;
+            PrintUsage(argv[0]);
+            return true;
+        }
+        if ((val = OptVal(arg, "-o=", "--output=")) != NULL) {
+            strncpy(opts->out_file, val, MAX_ARG_VAL_SIZE - 1);
+            opts->out_file[MAX_ARG_VAL_SIZE - 1] = '\0';
+            continue;
+        }
+        if ((val = OptVal(arg, "-y=", "--symbols=")) != NULL) {
+            strncpy(opts->map_file, val, MAX_ARG_VAL_SIZE - 1);
+            opts->map_file[MAX_ARG_VAL_SIZE - 1] = '\0';
+            continue;
+        }
+        if (arg[0] != '-' && opts->src_file[0] == '\0') {
+            strncpy(opts->src_file, arg, MAX_ARG_VAL_SIZE - 1);
+            opts->src_file[MAX_ARG_VAL_SIZE - 1] = '\0';
+            continue;
+        }
+
+        CuLogError("Invalid argument '%s'.", arg);
+        PrintUsage(argv[0]);
+        return false;
+    }
+    if (opts->src_file[0] == '\0' || opts->out_file[0] == '\0') {
+        CuLogError("Missing source-file or output-file.");
+        PrintUsage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+// Read all of `file` into a NUL-terminated `buf`.
+static bool ReadSource(const char* restrict file, char** restrict buf,
+  size_t* restrict len, CuError* restrict err) {
+    FILE* f = fopen(file, "rb");
+    if (f == NULL) {
+        return CuErrMsg(err, "Could not open file (%s).", strerror(errno));
+    }
+    size_t cap = 1 << 16;
+    *len = 0;
+    *buf = malloc(cap);
+    while (*buf != NULL) {
+        *len += fread(*buf + *len, 1, cap - *len - 1, f);
+        if (*len < cap - 1) {
+            break;
+        }
+        cap *= 2;
+        char* new_buf = realloc(*buf, cap);
+        if (new_buf == NULL) {
+            free(*buf);
+        }
+        *buf = new_buf;
+    }
+    const bool read_ok = !ferror(f);
+    fclose(f);
+    if (*buf == NULL) {
+        return CuErrMsg(err, "Could not allocate memory for the source.");
+    }
+    if (!read_ok) {
+        return CuErrMsg(err, "Error reading file.");
+    }
+    (*buf)[*len] = '\0';
+    return true;
+}
+
+static inline uint32_t HashName(const char* restrict name, size_t len) {
+    // FNV-1a.
+    uint32_t h = 0x811C9DC5U;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)name[i]) * 0x01000193U;
+    }
+    return h;
+}
+
+// Return the slot for `name` in `label_tab`, which is either empty or holds
+// the label with that name.
+static uint32_t FindSlot(const char* restrict name, size_t len, uint32_t hash) {
+    uint32_t s = hash & (label_tab_size - 1);
+    while (label_tab[s].idx != 0) {
+        if (label_tab[s].hash == hash) {
+            const Label* l = &labels[label_tab[s].idx - 1];
+            if (l->len == len && memcmp(l->name, name, len) == 0) {
+                break;
+            }
+        }
+        s = (s + 1) & (label_tab_size - 1);
+    }
+    return s;
+}
+
+static bool GrowLabelTab(CuError* restrict err) {
+    const uint32_t new_size = (label_tab_size == 0) ? 1024 : 2 * label_tab_size;
+    LabelSlot* new_tab = calloc(new_size, sizeof new_tab[0]);
+    if (new_tab == NULL) {
+        return CuErrMsg(err, "Could not allocate memory for labels.");
+    }
+    free(label_tab);
+    label_tab = new_tab;
+    label_tab_size = new_size;
+    for (uint32_t i = 0; i < num_labels; i++) {
+        const Label* l = &labels[i];
+        label_tab[FindSlot(l->name, l->len, l->hash)] = (LabelSlot){
+            .hash = l->hash, .idx = i + 1,
+        };
+    }
+    return true;
+}
+
+static bool AddLabel(const char* restrict name, size_t len, uint32_t addr,
+  CuError* restrict err) {
+    if (2 * (num_labels + 1) > label_tab_size) {
+        RET_ON_ERR(GrowLabelTab(err));
+    }
+    const uint32_t hash = HashName(name, len);
+    const uint32_t s = FindSlot(name, len, hash);
+    if (label_tab[s].idx != 0) {
+        return CuErrMsg(err, "Duplicate label '%.*s'.", (int)len, name);
+    }
+    if (num_labels == labels_cap) {
+        labels_cap = (labels_cap == 0) ? 512 : 2 * labels_cap;
+        Label* new_labels = realloc(labels, labels_cap * sizeof labels[0]);
+        if (new_labels == NULL) {
+            return CuErrMsg(err, "Could not allocate memory for labels.");
+        }
+        labels = new_labels;
+    }
+    labels[num_labels] = (Label){
+        .name = name, .len = (uint32_t)len, .hash = hash, .addr = addr,
+    };
+    label_tab[s] = (LabelSlot){.hash = hash, .idx = ++num_labels};
+    return true;
+}
+
+static bool LookUpLabel(const char* restrict name, size_t len,
+  uint32_t* restrict addr, void* ctx) {
+    (void)ctx;
+    if (label_tab_size == 0) {
+        return false;
+    }
+    const uint32_t s = FindSlot(name, len, HashName(name, len));
+    if (label_tab[s].idx == 0) {
+        return false;
+    }
+    *addr = labels[label_tab[s].idx - 1].addr;
+    return true;
+}
+
+static bool StartSection(uint32_t base, CuError* restrict err) {
+    if (num_sections > 0 && sections[num_sections - 1].nbytes == 0) {
+        num_sections--;
+    }
+    if (num_sections == sections_cap) {
+        sections_cap = (sections_cap == 0) ? 16 : 2 * sections_cap;
+        Section* new_sections = realloc(sections,
+          sections_cap * sizeof sections[0]);
+        if (new_sections == NULL) {
+            return CuErrMsg(err, "Could not allocate memory for sections.");
+        }
+        sections = new_sections;
+    }
+    sections[num_sections++] = (Section){
+        .base = base, .off = data_len, .nbytes = 0,
+    };
+    return true;
+}
+
+// Return the address of the next byte to be emitted.
+static inline uint32_t CurAddr(void) {
+    const Section* sec = &sections[num_sections - 1];
+    return sec->base + sec->nbytes;
+}
+
+// Emit `nbytes` bytes of `bytes` (or zero-bytes if it is NULL), or only
+// account for them if not `emit`.
+static bool EmitBytes(const uint8_t* restrict bytes, uint32_t nbytes,
+  bool emit, CuError* restrict err) {
+    Section* sec = &sections[num_sections - 1];
+    if (nbytes > UINT32_MAX - sec->base - sec->nbytes) {
+        return CuErrMsg(err, "Section beyond the address-space.");
+    }
+    if (emit) {
+        if (data_len + nbytes > data_cap) {
+            size_t new_cap = (data_cap == 0) ? (1 << 16) : data_cap;
+            while (data_len + nbytes > new_cap) {
+                new_cap *= 2;
+            }
+            uint8_t* new_data = realloc(data, new_cap);
+            if (new_data == NULL) {
+                return CuErrMsg(err, "Could not allocate memory for data.");
+            }
+            data = new_data;
+            data_cap = new_cap;
+        }
+        if (bytes == NULL) {
+            memset(data + data_len, 0, nbytes);
+        } else {
+            memcpy(data + data_len, bytes, nbytes);
+        }
+        data_len += nbytes;
+    }
+    sec->nbytes += nbytes;
+    return true;
+}
+
+static bool EmitWord(uint32_t word, bool emit, CuError* restrict err) {
+    const uint8_t bytes[4] = {
+        (uint8_t)word, (uint8_t)(word >> 8), (uint8_t)(word >> 16),
+        (uint8_t)(word >> 24),
+    };
+    return EmitBytes(bytes, 4, emit, err);
+}
+
+static inline const char* SkipSpace(const char* p, const char* end) {
+    while (p < end && isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+static inline bool IsNameChar(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.';
+}
+
+// Parse a number, or (if `label_ok`) the name of a label, at `*p` into `val`.
+static bool ParseVal(const char** p, const char* end, bool label_ok,
+  int64_t* restrict val, CuError* restrict err) {
+    const char* s = *p;
+    if (s < end && (isalpha((unsigned char)*s) || *s == '_')) {
+        while (s < end && IsNameChar(*s)) {
+            s++;
+        }
+        uint32_t addr;
+        if (!label_ok) {
+            return CuErrMsg(err, "Expected a number.");
+        }
+        if (!LookUpLabel(*p, (size_t)(s - *p), &addr, NULL)) {
+            return CuErrMsg(err, "Unknown label '%.*s'.", (int)(s - *p), *p);
+        }
+        *p = s;
+        *val = addr;
+        return true;
+    }
+    const char* digits = (s < end && *s == '-') ? s + 1 : s;
+    const bool hex = end - digits > 2 && digits[0] == '0' &&
+      (digits[1] == 'x' || digits[1] == 'X');
+    char* num_end = NULL;
+    errno = 0;
+    *val = strtoll(s, &num_end, hex ? 16 : 10);
+    if (num_end == s || num_end > end || errno != 0 ||
+      (num_end < end && IsNameChar(*num_end)) || *val < INT32_MIN ||
+      *val > UINT32_MAX) {
+        return CuErrMsg(err, "Bad number.");
+    }
+    *p = num_end;
+    return true;
+}
+
+// Assemble the directive at `p` (after the '.'), emitting its bytes if `emit`.
+static bool AssembleDirective(const char* p, const char* end, bool emit,
+  CuError* restrict err) {
+    const char* name = p;
+    while (p < end && isalpha((unsigned char)*p)) {
+        p++;
+    }
+    const size_t len = (size_t)(p - name);
+    p = SkipSpace(p, end);
+    int64_t val = 0;
+    if (len == 4 && memcmp(name, "word", 4) == 0) {
+        for (;;) {
+            // Labels might not be defined yet in the first pass.
+            if (emit) {
+                RET_ON_ERR(ParseVal(&p, end, true, &val, err));
+            } else {
+                while (p < end && *p != ',' && !isspace((unsigned char)*p)) {
+                    p++;
+                }
+            }
+            RET_ON_ERR(EmitWord((uint32_t)val, emit, err));
+            p = SkipSpace(p, end);
+            if (p == end) {
+                return true;
+            }
+            if (*p != ',') {
+                return CuErrMsg(err, "Expected ','.");
+            }
+            p = SkipSpace(p + 1, end);
+        }
+    }
+
+    RET_ON_ERR(ParseVal(&p, end, false, &val, err));
+    if (SkipSpace(p, end) != end) {
+        return CuErrMsg(err, "Unexpected text after the directive.");
+    }
+    if (len == 3 && memcmp(name, "org", 3) == 0) {
+        if (val < 0) {
+            return CuErrMsg(err, "Bad address.");
+        }
+        return StartSection((uint32_t)val, err);
+    }
+    if (len == 5 && memcmp(name, "space", 5) == 0) {
+        if (val < 0) {
+            return CuErrMsg(err, "Bad size.");
+        }
+        return EmitBytes(NULL, (uint32_t)val, emit, err);
+    }
+    if (len == 5 && memcmp(name, "align", 5) == 0) {
+        if (val <= 0 || (val & (val - 1)) != 0) {
+            return CuErrMsg(err, "Alignment not a power of two.");
+        }
+        const uint32_t pad = (uint32_t)(-CurAddr() & (uint32_t)(val - 1));
+        return EmitBytes(NULL, pad, emit, err);
+    }
+    return CuErrMsg(err, "Unknown directive '.%.*s'.", (int)len, name);
+}
+
+// Assemble the line from `p` to `end`, only defining labels and accounting
+// for the sizes of instructions and data unless `emit`.
+static bool AssembleLine(const char* p, const char* end, bool emit,
+  CuError* restrict err) {
+    const char* hash = memchr(p, '#', (size_t)(end - p));
+    if (hash != NULL) {
+        end = hash;
+    }
+    for (;;) {
+        p = SkipSpace(p, end);
+        const char* name = p;
+        while (p < end && IsNameChar(*p)) {
+            p++;
+        }
+        if (p == name || p == end || *p != ':') {
+            p = name;
+            break;
+        }
+        if (!isalpha((unsigned char)*name) && *name != '_') {
+            return CuErrMsg(err, "Bad label '%.*s'.", (int)(p - name), name);
+        }
+        if (!emit) {
+            RET_ON_ERR(AddLabel(name, (size_t)(p - name), CurAddr(), err));
+        }
+        p++;
+    }
+    while (end > p && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    if (p == end) {
+        return true;
+    }
+    if (*p == '.') {
+        return AssembleDirective(p + 1, end, emit, err);
+    }
+
+    const uint32_t pc = CurAddr();
+    if ((pc & 0x3U) != 0) {
+        return CuErrMsg(err, "Misaligned instruction at %08" PRIx32 ".", pc);
+    }
+    if (!emit) {
+        const char* mnem = p;
+        while (p < end && !isspace((unsigned char)*p)) {
+            p++;
+        }
+        const size_t n = CuGetOpEncSize(mnem, (size_t)(p - mnem));
+        if (n == 0) {
+            return CuErrMsg(err, "Unknown mnemonic '%.*s'.",
+              (int)(p - mnem), mnem);
+        }
+        return EmitBytes(NULL, 4U * (uint32_t)n, false, err);
+    }
+    uint32_t insns[CU_OPENC_MAX_INSNS];
+    size_t n;
+    RET_ON_ERR(CuEncodeOps(p, (size_t)(end - p), pc, LookUpLabel, NULL, insns,
+      &n, err));
+    for (size_t i = 0; i < n; i++) {
+        RET_ON_ERR(EmitWord(insns[i], true, err));
+    }
+    num_insns += n;
+    return true;
+}
+
+static bool AssemblePass(const char* restrict file, const char* src,
+  size_t len, bool emit) {
+    CuError err;
+    num_sections = 0;
+    data_len = 0;
+    if (!StartSection(0, &err)) {
+        CuLogError("%s", err.err_msg);
+        return false;
+    }
+    const char* end = src + len;
+    uint32_t line_num = 0;
+    for (const char* p = src; p < end; line_num++) {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        if (eol == NULL) {
+            eol = end;
+        }
+        if (!AssembleLine(p, eol, emit, &err)) {
+            CuLogError("%s:%" PRIu32 ": %s", file, line_num + 1, err.err_msg);
+            return false;
+        }
+        p = eol + 1;
+    }
+    return true;
+}
+
+static bool WriteImage(const char* restrict file, CuError* restrict err) {
+    FILE* f = fopen(file, "wb");
+    if (f == NULL) {
+        return CuErrMsg(err, "Could not open file (%s).", strerror(errno));
+    }
+    bool ok = true;
+    for (uint32_t i = 0; i < num_sections && ok; i++) {
+        const Section* sec = &sections[i];
+        if (sec->nbytes == 0) {
+            continue;
+        }
+        const uint8_t header[8] = {
+            (uint8_t)sec->base, (uint8_t)(sec->base >> 8),
+            (uint8_t)(sec->base >> 16), (uint8_t)(sec->base >> 24),
+            (uint8_t)sec->nbytes, (uint8_t)(sec->nbytes >> 8),
+            (uint8_t)(sec->nbytes >> 16), (uint8_t)(sec->nbytes >> 24),
+        };
+        ok = fwrite(header, 1, sizeof header, f) == sizeof header &&
+          fwrite(data + sec->off, 1, sec->nbytes, f) == sec->nbytes;
+    }
+    if (fclose(f) != 0 || !ok) {
+        return CuErrMsg(err, "Error writing file.");
+    }
+    return true;
+}
+
+static bool WriteMap(const char* restrict file, CuError* restrict err) {
+    FILE* f = fopen(file, "w");
+    if (f == NULL) {
+        return CuErrMsg(err, "Could not open file (%s).", strerror(errno));
+    }
+    bool ok = true;
+    for (uint32_t i = 0; i < num_labels && ok; i++) {
+        const Label* l = &labels[i];
+        ok = fprintf(f, "%08" PRIx32 " %.*s\n", l->addr, (int)l->len,
+          l->name) > 0;
+    }
+    if (fclose(f) != 0 || !ok) {
+        return CuErrMsg(err, "Error writing file.");
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    AsmOptions opts;
+    RET_FAIL_ON_ERR(ParseCommandLine(argc, argv, &opts));
+    if (opts.info_req) {
+        return EXIT_SUCCESS;
+    }
+
+    CuError err;
+    char* src = NULL;
+    size_t len = 0;
+    if (!ReadSource(opts.src_file, &src, &len, &err)) {
+        CuLogError("Could not read file '%s': %s", opts.src_file, err.err_msg);
+        return EXIT_FAILURE;
+    }
+    const uint64_t t0 = CuTimGetHostNs();
+    RET_FAIL_ON_ERR(AssemblePass(opts.src_file, src, len, false));
+    RET_FAIL_ON_ERR(AssemblePass(opts.src_file, src, len, true));
+    const uint64_t t1 = CuTimGetHostNs();
+
+    if (!WriteImage(opts.out_file, &err)) {
+        CuLogError("Could not write file '%s': %s", opts.out_file,
+          err.err_msg);
+        return EXIT_FAILURE;
+    }
+    if (opts.map_file[0] != '\0' && !WriteMap(opts.map_file, &err)) {
+        CuLogError("Could not write file '%s': %s", opts.map_file,
+          err.err_msg);
+        return EXIT_FAILURE;
+    }
+    CuLogInfo("Assembled %" PRIu64 " instructions and %zu bytes with %" PRIu32
+      " labels in %0.3f ms.", num_insns, data_len, num_labels,
+      (double)(t1 - t0) / 1e6);
+    free(src);
+    return EXIT_SUCCESS;
+}
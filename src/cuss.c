@@ -1,24 +1,35 @@
 // SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
 // SPDX-License-Identifier: BSD-3-Clause
+// Needed for `isatty()`.
+#define _POSIX_C_SOURCE 200809L
+
 #include <inttypes.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "checkpt.h"
 #include "concur.h"
 #include "cpu.h"
 #include "errors.h"
+#include "gdbstub.h"
 #include "logger.h"
 #include "memory.h"
 #include "monitor.h"
+#include "pipeline.h"
 #include "sdlmonio.h"
 #include "sdlui.h"
+#include "symtab.h"
+#include "timing.h"
 
 #define INVALID_ADDR 0xFFFFFFFFU
 #define MAX_ARG_VAL_SIZE 256
+#define DEF_CKPT_BUDGET_MIB 64U
 
 #define RET_FAIL_ON_ERR(e) \
   do { \
@@ -30,20 +41,64 @@
 typedef struct CuOptions {
     bool info_req;
     bool sdl_ui;
+    bool pipeline;
     char mem_img[MAX_ARG_VAL_SIZE];
     uint32_t break_point;
+    char load_file[MAX_ARG_VAL_SIZE];
+    uint32_t load_addr;
+    char save_file[MAX_ARG_VAL_SIZE];
+    uint32_t save_addr;
+    uint32_t save_len;
+    char mon_script[MAX_ARG_VAL_SIZE];
+    char sym_file[MAX_ARG_VAL_SIZE];
+    uint16_t gdb_port;
+    uint64_t ckpt_interval;
+    uint64_t ckpt_budget_mib;
+    uint64_t num_cores;
+    uint64_t quantum;
+    uint64_t cpu_hz;
+    bool pin_exec;
+    int exec_cpu;
+    uint64_t host_threads;
 } CuOptions;
 
+// Where the CLI Monitor reads its commands from.
+static FILE* cli_inp = NULL;
+
 static void PrintUsage(const char* restrict prg) {
     CuLogInfo("The Completely Useless System Simulator (CUSS).");
     CuLogInfo("Usage: %s [options]", prg);
     CuLogInfo("Options:");
     CuLogInfo("  -h, --help: Show this help-message.");
+    CuLogInfo("  -e[=<cpu>], --pin-executor[=<cpu>]: Pin the Executor to host "
+      "CPU <cpu> (or the last one).");
+    CuLogInfo("  -f=<hz>, --cpu-hz=<hz>: Pace CUP to a clock-rate of <hz> "
+      "(default unpaced).");
+    CuLogInfo("  -g=<port>, --gdb-port=<port>: Serve GDB on local TCP <port>.");
     CuLogInfo("  -b=<addr>, --break-point=<addr>: Break-point at <addr>.");
+    CuLogInfo("  -c=<n>, --checkpoint-interval=<n>: Checkpoint every <n> "
+      "instructions for reverse-execution.");
+    CuLogInfo("  -C=<MiB>, --checkpoint-budget=<MiB>: Limit checkpoints to "
+      "<MiB> MiB (default %u).", DEF_CKPT_BUDGET_MIB);
+    CuLogInfo("  -j=<n>, --host-threads=<n>: Use <n> host threads for bulk "
+      "host-side work (default all).");
+    CuLogInfo("  -l=<file>@<addr>, --load=<file>@<addr>: Load the contents of "
+      "<file> at <addr>.");
     CuLogInfo("  -m=<file>, --memory-image=<file>: Load memory-image from "
       "<file>.");
+    CuLogInfo("  -n=<n>, --cores=<n>: Simulate <n> CUP cores (default 1, at "
+      "most %d).", CU_MAX_CORES);
+    CuLogInfo("  -p, --pipeline: Run the pipeline timing-model alongside.");
+    CuLogInfo("  -q=<n>, --quantum=<n>: Run the cores deterministically, in "
+      "quanta of <n> instructions.");
+    CuLogInfo("  -s=<file>@<addr>:<len>, --save=<file>@<addr>:<len>: Save "
+      "<len> bytes at <addr> to <file> on exit.");
     CuLogInfo("  -u=<ui>, --user-interface=<ui>: Use the <ui> user-interface.");
     CuLogInfo("    (<ui> must be 'sdl' or 'cli' - the default is 'cli'.)");
+    CuLogInfo("  -x=<file>, --monitor-script=<file>: Run Monitor-commands from "
+      "<file>.");
+    CuLogInfo("  -y=<file>, --symbols=<file>: Load symbols from the map-file "
+      "<file>.");
 }
 
 static bool ParseUiArg(const char* restrict prg, const char* restrict arg,
@@ -60,11 +115,93 @@ static bool ParseUiArg(const char* restrict prg, const char* restrict arg,
     return true;
 }
 
+// Split `arg` of the form "<file>@<addr>[:<len>]" into its parts.
+static bool ParseFileArg(const char* restrict prg, const char* restrict arg,
+  bool with_len, char* restrict file, uint32_t* restrict addr,
+  uint32_t* restrict len) {
+    const char* at = strrchr(arg, '@');
+    bool valid = at != NULL && at != arg && at - arg < MAX_ARG_VAL_SIZE;
+    char* end = NULL;
+    if (valid) {
+        *addr = (uint32_t)strtoul(at + 1, &end, 0);
+        valid = end != at + 1;
+    }
+    if (valid && with_len) {
+        const char* len_str = end + 1;
+        valid = *end == ':';
+        if (valid) {
+            *len = (uint32_t)strtoul(len_str, &end, 0);
+            valid = end != len_str;
+        }
+    }
+    if (!valid || *end != '\0') {
+        CuLogError("Invalid file-argument '%s'.", arg);
+        PrintUsage(prg);
+        return false;
+    }
+    memcpy(file, arg, at - arg);
+    file[at - arg] = '\0';
+    return true;
+}
+
+static bool ParseGdbPortArg(const char* restrict prg, const char* restrict arg,
+  CuOptions* restrict opts) {
+    char* end = NULL;
+    const unsigned long port = strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || port == 0 || port > UINT16_MAX) {
+        CuLogError("Invalid GDB-port '%s'.", arg);
+        PrintUsage(prg);
+        return false;
+    }
+    opts->gdb_port = (uint16_t)port;
+    return true;
+}
+
+static bool ParsePinArg(const char* restrict prg, const char* restrict arg,
+  CuOptions* restrict opts) {
+    char* end = NULL;
+    const unsigned long cpu = strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || cpu > INT_MAX) {
+        CuLogError("Invalid host CPU '%s'.", arg);
+        PrintUsage(prg);
+        return false;
+    }
+    opts->pin_exec = true;
+    opts->exec_cpu = (int)cpu;
+    return true;
+}
+
+static bool ParseCountArg(const char* restrict prg, const char* restrict arg,
+  const char* restrict what, uint64_t* restrict val) {
+    char* end = NULL;
+    *val = strtoull(arg, &end, 0);
+    if (end == arg || *end != '\0' || *val == 0) {
+        CuLogError("Invalid %s '%s'.", what, arg);
+        PrintUsage(prg);
+        return false;
+    }
+    return true;
+}
+
 static bool ParseCommandLine(int argc, char *argv[], CuOptions* restrict opts) {
     opts->info_req = false;
     opts->sdl_ui = false;
+    opts->pipeline = false;
     opts->mem_img[0] = '\0';
     opts->break_point = INVALID_ADDR;
+    opts->load_file[0] = '\0';
+    opts->save_file[0] = '\0';
+    opts->mon_script[0] = '\0';
+    opts->sym_file[0] = '\0';
+    opts->gdb_port = 0;
+    opts->ckpt_interval = 0;
+    opts->ckpt_budget_mib = DEF_CKPT_BUDGET_MIB;
+    opts->num_cores = 1;
+    opts->quantum = 0;
+    opts->cpu_hz = 0;
+    opts->pin_exec = false;
+    opts->exec_cpu = -1;
+    opts->host_threads = 0;
     if (argc < 2) {
         return true;
     }
@@ -85,6 +222,73 @@ static bool ParseCommandLine(int argc, char *argv[], CuOptions* restrict opts) {
             opts->break_point = (uint32_t)strtoul(arg + 14, NULL, 0);
             continue;
         }
+        if (strncmp(arg, "-c=", 3) == 0 ||
+          strncmp(arg, "--checkpoint-interval=", 22) == 0) {
+            if (!ParseCountArg(argv[0], strchr(arg, '=') + 1,
+              "checkpoint-interval", &opts->ckpt_interval)) {
+                return false;
+            }
+            continue;
+        }
+        if (strncmp(arg, "-C=", 3) == 0 ||
+          strncmp(arg, "--checkpoint-budget=", 20) == 0) {
+            if (!ParseCountArg(argv[0], strchr(arg, '=') + 1,
+              "checkpoint-budget", &opts->ckpt_budget_mib)) {
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "-e") == 0 || strcmp(arg, "--pin-executor") == 0) {
+            opts->pin_exec = true;
+            continue;
+        }
+        if (strncmp(arg, "-e=", 3) == 0 ||
+          strncmp(arg, "--pin-executor=", 15) == 0) {
+            if (!ParsePinArg(argv[0], strchr(arg, '=') + 1, opts)) {
+                return false;
+            }
+            continue;
+        }
+        if (strncmp(arg, "-f=", 3) == 0 || strncmp(arg, "--cpu-hz=", 9) == 0) {
+            if (!ParseCountArg(argv[0], strchr(arg, '=') + 1, "clock-rate",
+              &opts->cpu_hz)) {
+                return false;
+            }
+            if (opts->cpu_hz > UINT32_MAX) {
+                CuLogError("Clock-rate '%s' is too high.", arg);
+                PrintUsage(argv[0]);
+                return false;
+            }
+            continue;
+        }
+        if (strncmp(arg, "-g=", 3) == 0) {
+            if (!ParseGdbPortArg(argv[0], arg + 3, opts)) {
+                return false;
+            }
+            continue;
+        }
+        if (strncmp(arg, "--gdb-port=", 11) == 0) {
+            if (!ParseGdbPortArg(argv[0], arg + 11, opts)) {
+                return false;
+            }
+            continue;
+        }
+        if (strncmp(arg, "-l=", 3) == 0 || strncmp(arg, "--load=", 7) == 0) {
+            const char* val = strchr(arg, '=') + 1;
+            if (!ParseFileArg(argv[0], val, false, opts->load_file,
+              &opts->load_addr, NULL)) {
+                return false;
+            }
+            continue;
+        }
+        if (strncmp(arg, "-j=", 3) == 0 ||
+          strncmp(arg, "--host-threads=", 15) == 0) {
+            if (!ParseCountArg(argv[0], strchr(arg, '=') + 1,
+              "host-thread count", &opts->host_threads)) {
+                return false;
+            }
+            continue;
+        }
         if (strncmp(arg, "-m=", 3) == 0) {
             strncpy(opts->mem_img, arg + 3, MAX_ARG_VAL_SIZE - 1);
             continue;
@@ -93,6 +297,33 @@ static bool ParseCommandLine(int argc, char *argv[], CuOptions* restrict opts) {
             strncpy(opts->mem_img, arg + 15, MAX_ARG_VAL_SIZE - 1);
             continue;
         }
+        if (strncmp(arg, "-n=", 3) == 0 || strncmp(arg, "--cores=", 8) == 0) {
+            if (!ParseCountArg(argv[0], strchr(arg, '=') + 1, "core-count",
+              &opts->num_cores)) {
+                return false;
+            }
+            continue;
+        }
+        if (strncmp(arg, "-q=", 3) == 0 ||
+          strncmp(arg, "--quantum=", 10) == 0) {
+            if (!ParseCountArg(argv[0], strchr(arg, '=') + 1, "quantum",
+              &opts->quantum)) {
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "-p") == 0 || strcmp(arg, "--pipeline") == 0) {
+            opts->pipeline = true;
+            continue;
+        }
+        if (strncmp(arg, "-s=", 3) == 0 || strncmp(arg, "--save=", 7) == 0) {
+            const char* val = strchr(arg, '=') + 1;
+            if (!ParseFileArg(argv[0], val, true, opts->save_file,
+              &opts->save_addr, &opts->save_len)) {
+                return false;
+            }
+            continue;
+        }
         if (strncmp(arg, "-u=", 3) == 0) {
           if (!ParseUiArg(argv[0], arg + 3, opts)) {
               return false;
@@ -105,6 +336,22 @@ static bool ParseCommandLine(int argc, char *argv[], CuOptions* restrict opts) {
           }
           continue;
         }
+        if (strncmp(arg, "-x=", 3) == 0) {
+            strncpy(opts->mon_script, arg + 3, MAX_ARG_VAL_SIZE - 1);
+            continue;
+        }
+        if (strncmp(arg, "--monitor-script=", 17) == 0) {
+            strncpy(opts->mon_script, arg + 17, MAX_ARG_VAL_SIZE - 1);
+            continue;
+        }
+        if (strncmp(arg, "-y=", 3) == 0) {
+            strncpy(opts->sym_file, arg + 3, MAX_ARG_VAL_SIZE - 1);
+            continue;
+        }
+        if (strncmp(arg, "--symbols=", 10) == 0) {
+            strncpy(opts->sym_file, arg + 10, MAX_ARG_VAL_SIZE - 1);
+            continue;
+        }
 
         CuLogError("Invalid argument '%s'.", arg);
         PrintUsage(argv[0]);
@@ -113,6 +360,28 @@ static bool ParseCommandLine(int argc, char *argv[], CuOptions* restrict opts) {
     return true;
 }
 
+static bool HostPoolSetUp(const CuOptions* restrict opts) {
+    // The thread running the bulk work is one of the host threads.
+    int num_threads = -1;
+    if (opts->host_threads != 0) {
+        num_threads = (opts->host_threads > INT_MAX) ? INT_MAX - 1 :
+          (int)opts->host_threads - 1;
+    }
+    CuError err;
+    if (!CuSetUpHostPool(num_threads, &err)) {
+        CuLogError("Could not set up host thread-pool: %s", err.err_msg);
+        return false;
+    }
+    CuLogInfo("Using %d host thread(s) for bulk work.",
+      CuPoolGetNumThreads(CuGetHostPool()) + 1);
+    return true;
+}
+
+static bool HostPoolTearDown(CuError* restrict err) {
+    RET_ON_ERR(CuTearDownHostPool(err));
+    return true;
+}
+
 static bool MemorySetUp(const CuOptions* restrict opts,
   const char* restrict prg) {
     CuError err;
@@ -127,6 +396,43 @@ static bool MemorySetUp(const CuOptions* restrict opts,
           err.err_msg);
         return false;
     }
+    if (opts->load_file[0] != '\0') {
+        uint32_t nbytes;
+        if (!CuLoadMemFromFile(opts->load_file, opts->load_addr, &nbytes,
+          &err)) {
+            CuLogError("Could not load file '%s': %s", opts->load_file,
+              err.err_msg);
+            return false;
+        }
+        CuLogInfo("Loaded %" PRIu32 " bytes from file '%s' at '%08" PRIx32
+          "'.", nbytes, opts->load_file, opts->load_addr);
+    }
+    if (opts->sym_file[0] != '\0') {
+        uint32_t num_syms;
+        if (!CuLoadSymbols(opts->sym_file, &num_syms, &err)) {
+            CuLogError("Could not load symbols from file '%s': %s",
+              opts->sym_file, err.err_msg);
+            return false;
+        }
+        CuLogInfo("Loaded %" PRIu32 " symbols from file '%s'.", num_syms,
+          opts->sym_file);
+    }
+    return true;
+}
+
+static bool MemoryTearDown(const CuOptions* restrict opts) {
+    if (opts->save_file[0] == '\0') {
+        return true;
+    }
+    CuError err;
+    if (!CuSaveMemToFile(opts->save_file, opts->save_addr, opts->save_len,
+      &err)) {
+        CuLogError("Could not save file '%s': %s", opts->save_file,
+          err.err_msg);
+        return false;
+    }
+    CuLogInfo("Saved %" PRIu32 " bytes at '%08" PRIx32 "' to file '%s'.",
+      opts->save_len, opts->save_addr, opts->save_file);
     return true;
 }
 
@@ -136,6 +442,33 @@ static bool CpuSetUp(const CuOptions* restrict opts) {
         CuLogError("Could not initialize the CPU: %s", err.err_msg);
         return false;
     }
+    if (opts->num_cores > 1) {
+        CuLogInfo("Running %" PRIu64 " cores.", opts->num_cores);
+    }
+    const int num_cores = (opts->num_cores > CU_MAX_CORES) ? CU_MAX_CORES + 1 :
+      (int)opts->num_cores;
+    if (!CuSetNumCores(num_cores, &err)) {
+        CuLogError("Unable to set up the cores: %s", err.err_msg);
+        return false;
+    }
+    if (opts->pin_exec && num_cores > 1) {
+        CuLogError("Pinning the Executor needs a single core.");
+        return false;
+    }
+    if (opts->cpu_hz != 0) {
+        CuLogInfo("Pacing CUP to a clock-rate of %" PRIu64 " Hz.",
+          opts->cpu_hz);
+        CuTimSetClock((uint32_t)opts->cpu_hz, true);
+    }
+    if (opts->quantum != 0) {
+        CuLogInfo("Running the cores in quanta of %" PRIu64 " instructions.",
+          opts->quantum);
+        if (!CuSetQuantum(opts->quantum, &err)) {
+            CuLogError("Unable to set the quantum: %s", err.err_msg);
+            return false;
+        }
+    }
+    CuEnablePipelineModel(opts->pipeline);
     if (opts->break_point != INVALID_ADDR) {
         CuLogInfo("Adding a break-point at '%08" PRIx32 "'.",
           opts->break_point);
@@ -144,6 +477,15 @@ static bool CpuSetUp(const CuOptions* restrict opts) {
             return false;
         }
     }
+    if (opts->ckpt_interval != 0) {
+        CuLogInfo("Checkpointing every %" PRIu64 " instructions.",
+          opts->ckpt_interval);
+        const size_t budget = (size_t)opts->ckpt_budget_mib * 1024U * 1024U;
+        if (!CuCkptSetUp(opts->ckpt_interval, budget, &err)) {
+            CuLogError("Unable to set up checkpoints: %s", err.err_msg);
+            return false;
+        }
+    }
     return true;
 }
 
@@ -152,7 +494,7 @@ static bool CliGetInp(char* restrict buf, size_t buf_size, bool* restrict eof,
     if (buf == NULL) {
         return CuErrMsg(err, "NULL `buf` argument.");
     }
-    if (fgets(buf, buf_size, stdin) == NULL) {
+    if (fgets(buf, buf_size, cli_inp) == NULL) {
         *eof = true;
     } else {
         *eof = false;
@@ -169,7 +511,8 @@ static bool CliPutMsg(const char* restrict msg, CuError* restrict err) {
     if (msg == NULL) {
         return CuErrMsg(err, "NULL `msg` argument.");
     }
-    if (fputs(msg, stdout) == EOF) {
+    // The Monitor hands over the output of a command in one go.
+    if (fputs(msg, stdout) == EOF || fflush(stdout) == EOF) {
         return CuErrMsg(err, "Error writing to `stdout`.");
     }
     return true;
@@ -188,9 +531,23 @@ static int RunMonitor(void* data) {
 
 static bool MonitorSetUp(const CuOptions* restrict opts,
   CuThread* restrict mon_thr) {
-    CuMonGetInpFn inp_fn = opts->sdl_ui ? CuSdlMonIoGetInp : CliGetInp;
+    const bool use_script = opts->mon_script[0] != '\0';
+    CuMonGetInpFn inp_fn = (opts->sdl_ui && !use_script) ? CuSdlMonIoGetInp :
+      CliGetInp;
     CuMonPutMsgFn out_fn = opts->sdl_ui ? CuSdlMonIoPutMsg : CliPutMsg;
 
+    // Commands from a script or a pipe are run without prompting.
+    cli_inp = stdin;
+    if (use_script) {
+        cli_inp = fopen(opts->mon_script, "r");
+        if (cli_inp == NULL) {
+            CuLogError("Could not open Monitor-script '%s'.", opts->mon_script);
+            return false;
+        }
+    }
+    CuMonSetInteractive(!use_script && (opts->sdl_ui ||
+      isatty(STDIN_FILENO)));
+
     CuError err;
     if (!CuMonSetUp(inp_fn, out_fn, &err)) {
         CuLogError("Could not initialize the Monitor: %s", err.err_msg);
@@ -208,6 +565,9 @@ static bool MonitorSetUp(const CuOptions* restrict opts,
 static bool MonitorTearDown(CuThread* restrict mon_thr, CuError* restrict err) {
     int mon_status;
     RET_ON_ERR(CuThrWait(mon_thr, &mon_status, err));
+    if (cli_inp != NULL && cli_inp != stdin) {
+        fclose(cli_inp);
+    }
     const bool mon_succ = (mon_status == EXIT_SUCCESS);
     CuLogInfo("Monitor thread finished execution (%s).", mon_succ ? "SUCCESS" :
       "FAILURE");
@@ -215,8 +575,16 @@ static bool MonitorTearDown(CuThread* restrict mon_thr, CuError* restrict err) {
 }
 
 static int RunExecutor(void* data) {
-    (void)data;  // Suppress unused parameter warning.
+    const CuOptions* opts = data;
     CuError err;
+    int cpu;
+    if (opts->pin_exec) {
+        if (CuThrPinToCpu(opts->exec_cpu, &cpu, &err)) {
+            CuLogInfo("Pinned the Executor to host CPU %d.", cpu);
+        } else {
+            CuLogWarn("Could not pin the Executor: %s", err.err_msg);
+        }
+    }
     if (!CuRunExecution(&err)) {
         CuLogError("Could not run the Simulator: %s", err.err_msg);
         return EXIT_FAILURE;
@@ -224,10 +592,11 @@ static int RunExecutor(void* data) {
     return EXIT_SUCCESS;
 }
 
-static bool ExecutorSetUp(CuThread* restrict exe_thr) {
+static bool ExecutorSetUp(const CuOptions* restrict opts,
+  CuThread* restrict exe_thr) {
     CuError err;
     CuLogInfo("Spawning the Executor in a separate thread.");
-    if (!CuThrCreate(RunExecutor, "CUSS Executor", /*data=*/NULL, exe_thr,
+    if (!CuThrCreate(RunExecutor, "CUSS Executor", (void*)opts, exe_thr,
         &err)) {
         CuLogError("Could not spawn an Executor thread: %s", err.err_msg);
         return false;
@@ -235,6 +604,75 @@ static bool ExecutorSetUp(CuThread* restrict exe_thr) {
     return true;
 }
 
+static int RunGdbStub(void* data) {
+    (void)data;  // Suppress unused parameter warning.
+    CuError err;
+    if (!CuGdbServe(&err)) {
+        CuLogError("Could not run the GDB-server: %s", err.err_msg);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static bool GdbStubSetUp(const CuOptions* restrict opts,
+  CuThread* restrict gdb_thr) {
+    if (opts->gdb_port == 0) {
+        return true;
+    }
+    CuError err;
+    if (!CuGdbSetUp(opts->gdb_port, &err)) {
+        CuLogError("Could not set up the GDB-server: %s", err.err_msg);
+        return false;
+    }
+    CuLogInfo("Spawning the GDB-server on port %u in a separate thread.",
+      (unsigned)opts->gdb_port);
+    if (!CuThrCreate(RunGdbStub, "CUSS GDB-server", /*data=*/NULL, gdb_thr,
+        &err)) {
+        CuLogError("Could not spawn a GDB-server thread: %s", err.err_msg);
+        return false;
+    }
+    return true;
+}
+
+static bool GdbStubTearDown(const CuOptions* restrict opts,
+  CuThread* restrict gdb_thr, CuError* restrict err) {
+    if (opts->gdb_port == 0) {
+        return true;
+    }
+    int gdb_status;
+    RET_ON_ERR(CuThrWait(gdb_thr, &gdb_status, err));
+    CuGdbTearDown();
+    return gdb_status == EXIT_SUCCESS;
+}
+
+static void PrintTimingStats(void) {
+    CuTimingStats stats;
+    CuGetCpuTimingStats(&stats);
+    if (stats.insns == 0) {
+        return;
+    }
+    const double sim_us = (double)stats.cycles * 1000000.0 /
+      (double)stats.clock_hz;
+    const double host_us = (double)stats.host_ns / 1000.0;
+    CuLogInfo("Simulated %" PRIu64 " instructions in %" PRIu64 " cycles "
+      "(CPI=%0.3f).", stats.insns, stats.cycles,
+      (double)stats.cycles / (double)stats.insns);
+    CuLogInfo("  simulated=%0.3f us, host=%0.3f us (simulated/host=%0.4f)",
+      sim_us, host_us, (host_us == 0.0) ? 0.0 : sim_us / host_us);
+
+    if (!CuIsPipelineModelEnabled()) {
+        return;
+    }
+    CuPipeStats pstats;
+    CuPipeGetStats(&pstats);
+    CuLogInfo("Pipeline-model took %" PRIu64 " cycles (CPI=%0.3f).",
+      pstats.cycles, (double)pstats.cycles / (double)pstats.insns);
+    for (int i = 0; i < CU_PIPE_NUM_STALL_REASONS; i++) {
+        CuLogInfo("  %s: %" PRIu64 " stall-cycles", CuPipeStallReasonName(i),
+          pstats.stalls[i]);
+    }
+}
+
 static bool ExecutorTearDown(CuThread* restrict exe_thr,
   CuError* restrict err) {
     int exe_status;
@@ -242,6 +680,7 @@ static bool ExecutorTearDown(CuThread* restrict exe_thr,
     const bool exe_succ = (exe_status == EXIT_SUCCESS);
     CuLogInfo("Executor thread finished execution (%s).", exe_succ ?
       "SUCCESS" : "FAILURE");
+    PrintTimingStats();
     return exe_succ;
 }
 
@@ -252,6 +691,7 @@ int main(int argc, char *argv[]) {
         return EXIT_SUCCESS;
     }
 
+    RET_FAIL_ON_ERR(HostPoolSetUp(&opts));
     RET_FAIL_ON_ERR(MemorySetUp(&opts, argv[0]));
     RET_FAIL_ON_ERR(CpuSetUp(&opts));
 
@@ -266,7 +706,9 @@ int main(int argc, char *argv[]) {
     CuThread mon_thr;
     RET_FAIL_ON_ERR(MonitorSetUp(&opts, &mon_thr));
     CuThread exe_thr;
-    RET_FAIL_ON_ERR(ExecutorSetUp(&exe_thr));
+    RET_FAIL_ON_ERR(ExecutorSetUp(&opts, &exe_thr));
+    CuThread gdb_thr;
+    RET_FAIL_ON_ERR(GdbStubSetUp(&opts, &gdb_thr));
 
     CuError err;
     if (opts.sdl_ui) {
@@ -276,5 +718,8 @@ int main(int argc, char *argv[]) {
 
     RET_FAIL_ON_ERR(ExecutorTearDown(&exe_thr, &err));
     RET_FAIL_ON_ERR(MonitorTearDown(&mon_thr, &err));
+    RET_FAIL_ON_ERR(GdbStubTearDown(&opts, &gdb_thr, &err));
+    RET_FAIL_ON_ERR(MemoryTearDown(&opts));
+    RET_FAIL_ON_ERR(HostPoolTearDown(&err));
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,814 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+// Needed for sockets and `poll()`.
+#define _POSIX_C_SOURCE 200809L
+
+#include "gdbstub.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "checkpt.h"
+#include "cpu.h"
+#include "logger.h"
+#include "memory.h"
+
+// The largest payload of a packet exchanged with GDB (as advertised to GDB in
+// hexadecimal in the reply to "qSupported").
+#define MAX_PKT_SIZE 0x4000
+#define MAX_PKT_SIZE_STR "4000"
+
+// How long to wait for input before checking whether CUSS is quitting.
+#define IDLE_POLL_MS 100
+
+// How long to wait for an interrupt from GDB before checking whether the
+// executor has stopped.
+#define RUN_POLL_MS 5
+
+// The registers in the order GDB sees them.
+#define NUM_GDB_REGS (CU_NUM_IREGS + 3)
+#define GDB_REG_PC (CU_NUM_IREGS + 0)
+#define GDB_REG_PSR (CU_NUM_IREGS + 1)
+#define GDB_REG_EP (CU_NUM_IREGS + 2)
+
+// Signals reported to GDB in stop-replies.
+#define GDB_SIGINT 0x02
+#define GDB_SIGTRAP 0x05
+#define GDB_SIGSEGV 0x0b
+
+static int listen_fd = -1;
+static int conn_fd = -1;
+static const int sock_opt_on = 1;
+
+// Whether GDB has turned off acknowledgements of packets.
+static bool no_ack = false;
+
+// The signal reported for the last stop of the executor.
+static uint8_t last_signal = GDB_SIGTRAP;
+
+// Bytes received from GDB but not yet consumed.
+static uint8_t inp_buf[MAX_PKT_SIZE];
+static size_t inp_pos = 0;
+static size_t inp_len = 0;
+
+// The payload of the current packet from GDB and of the reply to it.
+static char pkt_buf[MAX_PKT_SIZE + 1];
+static char rep_buf[MAX_PKT_SIZE + 1];
+static size_t rep_len = 0;
+
+// The framed reply, with room for "$", "#", and the checksum.
+static char frame_buf[MAX_PKT_SIZE + 4];
+
+// Raw memory-contents for "m", "M", and "X" packets.
+static uint8_t mem_buf[MAX_PKT_SIZE];
+
+// The target-description served via "qXfer:features:read".
+#define TARGET_XML_SIZE 4096
+static char target_xml[TARGET_XML_SIZE];
+static size_t target_xml_len = 0;
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static bool IsQuitting(void) {
+    return CuGetCpuState() == CU_CPU_QUITTING;
+}
+
+static int HexVal(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Parse a hexadecimal number at `*p`, advancing `*p` past it.
+static bool ParseHex(const char** p, uint32_t* restrict val) {
+    const char* s = *p;
+    uint32_t v = 0;
+    int d;
+    while ((d = HexVal(**p)) >= 0) {
+        v = (v << 4) | (uint32_t)d;
+        (*p)++;
+    }
+    *val = v;
+    return *p != s;
+}
+
+// Parse a 32-bit value sent as eight hexadecimal digits of little-endian bytes.
+static bool ParseLeWord(const char* p, uint32_t* restrict val) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        const int hi = HexVal(p[2 * i]);
+        const int lo = HexVal(p[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        v |= (uint32_t)((hi << 4) | lo) << (8 * i);
+    }
+    *val = v;
+    return true;
+}
+
+static void PutRep(const char* restrict s) {
+    while (*s != '\0' && rep_len < MAX_PKT_SIZE) {
+        rep_buf[rep_len++] = *s++;
+    }
+}
+
+static void PutRepByte(uint8_t b) {
+    if (rep_len + 2 <= MAX_PKT_SIZE) {
+        rep_buf[rep_len++] = hex_digits[b >> 4];
+        rep_buf[rep_len++] = hex_digits[b & 0x0FU];
+    }
+}
+
+static void PutRepLeWord(uint32_t val) {
+    for (int i = 0; i < 4; i++) {
+        PutRepByte((uint8_t)(val >> (8 * i)));
+    }
+}
+
+static bool SendAll(const char* buf, size_t len, CuError* restrict err) {
+    while (len > 0) {
+        const ssize_t n = send(conn_fd, buf, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return CuErrMsg(err, "Could not send to GDB (%s).",
+              strerror(errno));
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Wait at most `timeout_ms` for input from GDB, setting `ready` if there is.
+static bool PollInput(int timeout_ms, bool* restrict ready,
+  CuError* restrict err) {
+    *ready = inp_pos < inp_len;
+    if (*ready) {
+        return true;
+    }
+    struct pollfd pfd = {.fd = conn_fd, .events = POLLIN, .revents = 0};
+    const int n = poll(&pfd, 1, timeout_ms);
+    if (n < 0 && errno != EINTR) {
+        return CuErrMsg(err, "Could not poll GDB connection (%s).",
+          strerror(errno));
+    }
+    *ready = n > 0;
+    return true;
+}
+
+static bool GetByte(uint8_t* restrict c, CuError* restrict err) {
+    while (inp_pos == inp_len) {
+        if (IsQuitting()) {
+            return CuErrMsg(err, "CUSS is quitting.");
+        }
+        bool ready;
+        RET_ON_ERR(PollInput(IDLE_POLL_MS, &ready, err));
+        if (!ready) {
+            continue;
+        }
+        const ssize_t n = recv(conn_fd, inp_buf, sizeof inp_buf, 0);
+        if (n == 0) {
+            return CuErrMsg(err, "GDB closed the connection.");
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return CuErrMsg(err, "Could not receive from GDB (%s).",
+              strerror(errno));
+        }
+        inp_pos = 0;
+        inp_len = (size_t)n;
+    }
+    *c = inp_buf[inp_pos++];
+    return true;
+}
+
+// Read the next packet from GDB into `pkt_buf`, acknowledging it unless GDB
+// has turned off acknowledgements.
+static bool GetPacket(size_t* restrict len, CuError* restrict err) {
+    for (;;) {
+        uint8_t c;
+        do {
+            RET_ON_ERR(GetByte(&c, err));
+        } while (c != '$');
+
+        uint8_t sum = 0;
+        *len = 0;
+        for (;;) {
+            RET_ON_ERR(GetByte(&c, err));
+            if (c == '#') {
+                break;
+            }
+            if (*len < MAX_PKT_SIZE) {
+                pkt_buf[(*len)++] = (char)c;
+            }
+            sum = (uint8_t)(sum + c);
+        }
+        pkt_buf[*len] = '\0';
+
+        uint8_t hi;
+        uint8_t lo;
+        RET_ON_ERR(GetByte(&hi, err));
+        RET_ON_ERR(GetByte(&lo, err));
+        if (no_ack) {
+            return true;
+        }
+        const bool ok = HexVal((char)hi) >= 0 && HexVal((char)lo) >= 0 &&
+          (uint8_t)((HexVal((char)hi) << 4) | HexVal((char)lo)) == sum;
+        RET_ON_ERR(SendAll(ok ? "+" : "-", 1, err));
+        if (ok) {
+            return true;
+        }
+    }
+}
+
+// Send the reply in `rep_buf` to GDB, resending it until acknowledged.
+static bool SendReply(CuError* restrict err) {
+    uint8_t sum = 0;
+    frame_buf[0] = '$';
+    for (size_t i = 0; i < rep_len; i++) {
+        frame_buf[i + 1] = rep_buf[i];
+        sum = (uint8_t)(sum + (uint8_t)rep_buf[i]);
+    }
+    frame_buf[rep_len + 1] = '#';
+    frame_buf[rep_len + 2] = hex_digits[sum >> 4];
+    frame_buf[rep_len + 3] = hex_digits[sum & 0x0FU];
+
+    for (;;) {
+        RET_ON_ERR(SendAll(frame_buf, rep_len + 4, err));
+        if (no_ack) {
+            return true;
+        }
+        uint8_t c;
+        do {
+            RET_ON_ERR(GetByte(&c, err));
+        } while (c != '+' && c != '-');
+        if (c == '+') {
+            return true;
+        }
+    }
+}
+
+static void ReplyStop(void) {
+    PutRep("S");
+    PutRepByte(last_signal);
+}
+
+static void ReplyError(void) {
+    PutRep("E01");
+}
+
+static uint32_t GetGdbReg(int r) {
+    switch (r) {
+      case GDB_REG_PC:
+        return CuGetProgCtr();
+      case GDB_REG_PSR:
+        return CuGetProcStatReg();
+      case GDB_REG_EP:
+        return CuGetExtPrecReg();
+    }
+    uint32_t val = 0;
+    CuError nerr;
+    CuGetIntReg((uint8_t)r, &val, &nerr);
+    return val;
+}
+
+static bool SetGdbReg(int r, uint32_t val, CuError* restrict err) {
+    switch (r) {
+      case GDB_REG_PC:
+        return CuSetProgCtr(val, err);
+      case GDB_REG_PSR:
+        CuSetProcStatReg(val);
+        return true;
+      case GDB_REG_EP:
+        CuSetExtPrecReg(val);
+        return true;
+    }
+    return CuSetIntReg((uint8_t)r, val, err);
+}
+
+// Registers and memory may only be modified while the executor is stopped.
+static bool IsCpuStopped(void) {
+    const CuCpuState state = CuGetCpuState();
+    return state == CU_CPU_PAUSED || state == CU_CPU_BREAK_POINT;
+}
+
+static void HandleReadRegs(void) {
+    for (int r = 0; r < NUM_GDB_REGS; r++) {
+        PutRepLeWord(GetGdbReg(r));
+    }
+}
+
+static void HandleWriteRegs(const char* args, size_t len) {
+    CuError nerr;
+    if (!IsCpuStopped() || len < 8 * NUM_GDB_REGS) {
+        ReplyError();
+        return;
+    }
+    for (int r = 0; r < NUM_GDB_REGS; r++) {
+        uint32_t val;
+        if (!ParseLeWord(args + 8 * r, &val) || !SetGdbReg(r, val, &nerr)) {
+            ReplyError();
+            return;
+        }
+    }
+    PutRep("OK");
+}
+
+static void HandleReadReg(const char* args) {
+    uint32_t r;
+    if (!ParseHex(&args, &r) || r >= NUM_GDB_REGS) {
+        ReplyError();
+        return;
+    }
+    PutRepLeWord(GetGdbReg((int)r));
+}
+
+static void HandleWriteReg(const char* args, const char* end) {
+    uint32_t r;
+    uint32_t val;
+    CuError nerr;
+    if (!IsCpuStopped() || !ParseHex(&args, &r) || r >= NUM_GDB_REGS ||
+      *args != '=' || end - args < 9 || !ParseLeWord(args + 1, &val) ||
+      !SetGdbReg((int)r, val, &nerr)) {
+        ReplyError();
+        return;
+    }
+    PutRep("OK");
+}
+
+// Parse "<addr>,<len>" and, if `sep` is not '\0', the separator following it.
+static bool ParseAddrLen(const char** p, char sep, uint32_t* restrict addr,
+  uint32_t* restrict len) {
+    if (!ParseHex(p, addr) || **p != ',') {
+        return false;
+    }
+    (*p)++;
+    if (!ParseHex(p, len)) {
+        return false;
+    }
+    if (sep != '\0') {
+        if (**p != sep) {
+            return false;
+        }
+        (*p)++;
+    }
+    return true;
+}
+
+static void HandleReadMem(const char* args) {
+    uint32_t addr;
+    uint32_t len;
+    CuError nerr;
+    if (!ParseAddrLen(&args, '\0', &addr, &len)) {
+        ReplyError();
+        return;
+    }
+    if (len > MAX_PKT_SIZE / 2) {
+        len = MAX_PKT_SIZE / 2;
+    }
+    if (!CuReadMemRange(addr, len, mem_buf, &nerr)) {
+        ReplyError();
+        return;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        PutRepByte(mem_buf[i]);
+    }
+}
+
+// Handle "M" packets with hexadecimal data, or "X" packets with binary data.
+static void HandleWriteMem(const char* args, const char* end, bool binary) {
+    uint32_t addr;
+    uint32_t len;
+    CuError nerr;
+    if (!IsCpuStopped() || !ParseAddrLen(&args, ':', &addr, &len) ||
+      len > MAX_PKT_SIZE) {
+        ReplyError();
+        return;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        if (binary) {
+            if (args >= end) {
+                ReplyError();
+                return;
+            }
+            uint8_t b = (uint8_t)*args++;
+            if (b == '}') {
+                if (args >= end) {
+                    ReplyError();
+                    return;
+                }
+                b = (uint8_t)*args++ ^ 0x20U;
+            }
+            mem_buf[i] = b;
+        } else {
+            const int hi = (end - args >= 2) ? HexVal(args[0]) : -1;
+            const int lo = (end - args >= 2) ? HexVal(args[1]) : -1;
+            if (hi < 0 || lo < 0) {
+                ReplyError();
+                return;
+            }
+            mem_buf[i] = (uint8_t)((hi << 4) | lo);
+            args += 2;
+        }
+    }
+    if (!CuWriteMemRange(addr, len, mem_buf, &nerr)) {
+        ReplyError();
+        return;
+    }
+    PutRep("OK");
+}
+
+// Handle "Z0"/"Z1" packets to add break-points and "Z2" packets to add write
+// watch-points, and the corresponding "z" packets to remove them. Read and
+// access watch-points are unsupported.
+static void HandleBreakPoint(const char* args, bool add) {
+    const char type = args[0];
+    if ((type != '0' && type != '1' && type != '2') || args[1] != ',') {
+        return;
+    }
+    args += 2;
+    uint32_t addr;
+    uint32_t kind;
+    CuError nerr;
+    if (!ParseAddrLen(&args, '\0', &addr, &kind)) {
+        ReplyError();
+        return;
+    }
+    bool ok;
+    if (type == '2') {
+        ok = add ? CuAddWatchPoint(addr, kind, NULL, &nerr) :
+          CuRemoveWatchPoint(addr, &nerr);
+    } else {
+        ok = add ? CuAddBreakPoint(addr, &nerr) :
+          CuRemoveBreakPoint(addr, &nerr);
+    }
+    if (!ok) {
+        ReplyError();
+        return;
+    }
+    PutRep("OK");
+}
+
+// Set the program-counter if the "c" or "s" packet specifies an address.
+static bool ResumeAt(const char* args) {
+    uint32_t addr;
+    CuError nerr;
+    if (*args == '\0') {
+        return true;
+    }
+    return ParseHex(&args, &addr) && CuSetProgCtr(addr, &nerr);
+}
+
+// Wait for the executor to stop, pausing it if GDB sends an interrupt.
+static bool WaitForStop(CuError* restrict err) {
+    while (CuGetCpuState() == CU_CPU_RUNNING) {
+        bool ready;
+        RET_ON_ERR(PollInput(RUN_POLL_MS, &ready, err));
+        if (!ready) {
+            continue;
+        }
+        uint8_t c;
+        RET_ON_ERR(GetByte(&c, err));
+        if (c == 0x03) {
+            RET_ON_ERR(CuPauseCpu(err));
+        }
+    }
+    return true;
+}
+
+static bool HandleContinue(const char* args, CuError* restrict err) {
+    CuError nerr;
+    if (!ResumeAt(args) || !CuRunCpu(CU_CPU_RUN_NO_LIMIT, CU_CPU_RUN_NO_UNTIL,
+      &nerr)) {
+        ReplyError();
+        return true;
+    }
+    RET_ON_ERR(WaitForStop(err));
+    if (IsQuitting()) {
+        return CuErrMsg(err, "CUSS is quitting.");
+    }
+
+    CuCpuStopInfo info;
+    CuGetCpuStopInfo(&info);
+    switch (info.reason) {
+      case CU_CPU_STOP_PAUSED:
+        last_signal = GDB_SIGINT;
+        break;
+
+      case CU_CPU_STOP_ERROR:
+        last_signal = GDB_SIGSEGV;
+        break;
+
+      default:
+        last_signal = GDB_SIGTRAP;
+        break;
+    }
+    ReplyStop();
+    return true;
+}
+
+static void HandleStep(const char* args) {
+    CuError nerr;
+    if (!IsCpuStopped() || !ResumeAt(args)) {
+        ReplyError();
+        return;
+    }
+    last_signal = CuExecSingleStep(&nerr) ? GDB_SIGTRAP : GDB_SIGSEGV;
+    ReplyStop();
+}
+
+// Handle "bs" and "bc" by reversing the execution (see "checkpt.h").
+static void HandleReverse(const char* args) {
+    CuError nerr;
+    bool found;
+    if (!IsCpuStopped() || !CuCkptIsEnabled()) {
+        ReplyError();
+        return;
+    }
+    if (strcmp(args, "s") == 0) {
+        last_signal = CuReverseStep(1, &nerr) ? GDB_SIGTRAP : GDB_SIGSEGV;
+    } else if (strcmp(args, "c") == 0) {
+        last_signal = CuReverseContinue(&found, &nerr) ? GDB_SIGTRAP :
+          GDB_SIGSEGV;
+    } else {
+        return;
+    }
+    ReplyStop();
+}
+
+// Handle "qXfer:features:read:target.xml:<offset>,<length>".
+static void HandleReadFeatures(const char* args) {
+    static const char prefix[] = "target.xml:";
+    uint32_t off;
+    uint32_t len;
+    if (strncmp(args, prefix, sizeof prefix - 1) != 0) {
+        PutRep("E00");
+        return;
+    }
+    args += sizeof prefix - 1;
+    if (!ParseAddrLen(&args, '\0', &off, &len)) {
+        ReplyError();
+        return;
+    }
+    if (off >= target_xml_len) {
+        PutRep("l");
+        return;
+    }
+    if (len > MAX_PKT_SIZE - 1) {
+        len = MAX_PKT_SIZE - 1;
+    }
+    const bool last = len >= target_xml_len - off;
+    if (last) {
+        len = (uint32_t)(target_xml_len - off);
+    }
+    rep_buf[rep_len++] = last ? 'l' : 'm';
+    memcpy(rep_buf + rep_len, target_xml + off, len);
+    rep_len += len;
+}
+
+static void HandleQuery(const char* args) {
+    if (strncmp(args, "Supported", 9) == 0) {
+        PutRep("PacketSize=" MAX_PKT_SIZE_STR ";QStartNoAckMode+;"
+          "qXfer:features:read+");
+        if (CuCkptIsEnabled()) {
+            PutRep(";ReverseStep+;ReverseContinue+");
+        }
+    } else if (strcmp(args, "Attached") == 0) {
+        PutRep("1");
+    } else if (strcmp(args, "C") == 0) {
+        PutRep("QC1");
+    } else if (strcmp(args, "fThreadInfo") == 0) {
+        PutRep("m1");
+    } else if (strcmp(args, "sThreadInfo") == 0) {
+        PutRep("l");
+    } else if (strncmp(args, "Xfer:features:read:", 19) == 0) {
+        HandleReadFeatures(args + 19);
+    }
+}
+
+// Handle a packet from GDB, setting `done` if the connection should be closed
+// after sending the reply (if any) in `rep_buf`.
+static bool HandlePacket(size_t len, bool* restrict reply,
+  bool* restrict done, CuError* restrict err) {
+    const char* args = pkt_buf + 1;
+    const char* end = pkt_buf + len;
+    rep_len = 0;
+    *reply = true;
+    *done = false;
+    if (len == 0) {
+        return true;
+    }
+    switch (pkt_buf[0]) {
+      case '?':
+        ReplyStop();
+        break;
+
+      case 'g':
+        HandleReadRegs();
+        break;
+
+      case 'G':
+        HandleWriteRegs(args, end - args);
+        break;
+
+      case 'p':
+        HandleReadReg(args);
+        break;
+
+      case 'P':
+        HandleWriteReg(args, end);
+        break;
+
+      case 'm':
+        HandleReadMem(args);
+        break;
+
+      case 'M':
+        HandleWriteMem(args, end, false);
+        break;
+
+      case 'X':
+        HandleWriteMem(args, end, true);
+        break;
+
+      case 'Z':
+        HandleBreakPoint(args, true);
+        break;
+
+      case 'z':
+        HandleBreakPoint(args, false);
+        break;
+
+      case 'c':
+        RET_ON_ERR(HandleContinue(args, err));
+        break;
+
+      case 's':
+        HandleStep(args);
+        break;
+
+      case 'b':
+        HandleReverse(args);
+        break;
+
+      case 'q':
+        HandleQuery(args);
+        break;
+
+      case 'Q':
+        if (strcmp(args, "StartNoAckMode") == 0) {
+            PutRep("OK");
+        }
+        break;
+
+      case 'H':
+      case 'T':
+        PutRep("OK");
+        break;
+
+      case 'D':
+        PutRep("OK");
+        *done = true;
+        break;
+
+      case 'k':
+        *reply = false;
+        *done = true;
+        break;
+
+      default:
+        // An empty reply tells GDB that the packet is not supported.
+        break;
+    }
+    return true;
+}
+
+// Serve the connection from GDB until it is closed or CUSS quits.
+static bool ServeConnection(CuError* restrict err) {
+    bool done = false;
+    while (!done) {
+        size_t len;
+        bool reply;
+        RET_ON_ERR(GetPacket(&len, err));
+        RET_ON_ERR(HandlePacket(len, &reply, &done, err));
+        if (reply) {
+            RET_ON_ERR(SendReply(err));
+        }
+        if (strcmp(pkt_buf, "QStartNoAckMode") == 0) {
+            no_ack = true;
+        }
+    }
+    return true;
+}
+
+static void InitTargetXml(void) {
+    int n = snprintf(target_xml, TARGET_XML_SIZE,
+      "<?xml version=\"1.0\"?>\n"
+      "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+      "<target version=\"1.0\">\n"
+      "<feature name=\"org.cuss.cup\">\n");
+    for (int r = 0; r < NUM_GDB_REGS; r++) {
+        char name[8];
+        if (r < CU_NUM_IREGS) {
+            snprintf(name, sizeof name, "r%d", r);
+        } else {
+            snprintf(name, sizeof name, "%s", (r == GDB_REG_PC) ? "pc" :
+              (r == GDB_REG_PSR) ? "psr" : "ep");
+        }
+        n += snprintf(target_xml + n, TARGET_XML_SIZE - n,
+          "<reg name=\"%s\" bitsize=\"32\" regnum=\"%d\"%s/>\n", name, r,
+          (r == GDB_REG_PC) ? " type=\"code_ptr\"" : "");
+    }
+    n += snprintf(target_xml + n, TARGET_XML_SIZE - n,
+      "</feature>\n</target>\n");
+    target_xml_len = (size_t)n;
+}
+
+bool CuGdbSetUp(uint16_t port, CuError* restrict err) {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        return CuErrMsg(err, "Could not create socket (%s).", strerror(errno));
+    }
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &sock_opt_on,
+      sizeof sock_opt_on);
+
+    // Only accept connections from the local host.
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (struct sockaddr*)&sa, sizeof sa) != 0 ||
+      listen(listen_fd, 1) != 0) {
+        const int bind_errno = errno;
+        CuGdbTearDown();
+        return CuErrMsg(err, "Could not listen on port %u (%s).",
+          (unsigned)port, strerror(bind_errno));
+    }
+    InitTargetXml();
+    return true;
+}
+
+bool CuGdbServe(CuError* restrict err) {
+    if (listen_fd < 0) {
+        return CuErrMsg(err, "GDB server not set up.");
+    }
+    while (!IsQuitting()) {
+        struct pollfd pfd = {.fd = listen_fd, .events = POLLIN, .revents = 0};
+        const int n = poll(&pfd, 1, IDLE_POLL_MS);
+        if (n < 0 && errno != EINTR) {
+            return CuErrMsg(err, "Could not poll for GDB (%s).",
+              strerror(errno));
+        }
+        if (n <= 0) {
+            continue;
+        }
+        conn_fd = accept(listen_fd, NULL, NULL);
+        if (conn_fd < 0) {
+            continue;
+        }
+        // Packets are small and latency-sensitive.
+        setsockopt(conn_fd, IPPROTO_TCP, TCP_NODELAY, &sock_opt_on,
+          sizeof sock_opt_on);
+        CuLogInfo("GDB connected.");
+        no_ack = false;
+        inp_pos = inp_len = 0;
+        CuError nerr;
+        if (!ServeConnection(&nerr)) {
+            CuLogInfo("GDB disconnected: %s", nerr.err_msg);
+        } else {
+            CuLogInfo("GDB disconnected.");
+        }
+        close(conn_fd);
+        conn_fd = -1;
+    }
+    return true;
+}
+
+void CuGdbTearDown(void) {
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+}
@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_GDBSTUB_INCLUDED
+#define CUSS_GDBSTUB_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "errors.h"
+
+// A server for the GDB Remote Serial Protocol, so that GDB (or any other
+// front-end speaking the protocol) can debug programs running on CUP.
+//
+// GDB sees the registers r0-r31, followed by pc, psr, and ep.
+
+// Listen for a connection from GDB on `port` of the local host.
+extern bool CuGdbSetUp(uint16_t port, CuError* restrict err);
+
+// Serve connections from GDB, one at a time, until CUSS quits.
+extern bool CuGdbServe(CuError* restrict err);
+
+extern void CuGdbTearDown(void);
+
+#endif  // CUSS_GDBSTUB_INCLUDED
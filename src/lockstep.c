@@ -0,0 +1,672 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "errors.h"
+#include "logger.h"
+#include "memory.h"
+#include "opdec.h"
+#include "openc.h"
+#include "ops.h"
+#include "refcup.h"
+#include "timing.h"
+
+// A harness that runs the executor in "ops.c" in lockstep with the independent
+// reference-model in "refcup.c", either on a memory-image or on streams of
+// random instructions, comparing their states every so often.
+
+#define MAX_ARG_VAL_SIZE 256
+#define MAX_DIFF_MSG_SIZE 256
+
+#define DEF_SEED 1U
+#define DEF_RUNS 16U
+#define DEF_INSNS_PER_RUN 1000000U
+#define DEF_CHECK_INTERVAL 1000U
+
+// The layout of a random program: a prologue at the reset-vector sets up the
+// reserved base-registers and jumps to a body of random instructions, which
+// loops back to its start. Loads and stores only access the data-area.
+#define BODY_BASE 0x00000100U
+#define BODY_INSNS 512U
+#define MAX_SKIP 8U
+#define DATA_BASE 0x00080000U
+#define DATA_SIZE 0x00010000U
+
+// Registers never written to by random instructions.
+#define BODY_BASE_REG 29U
+#define DATA_BASE_REG 30U
+
+// Where hand-picked cases are assembled, between the body and the data-area,
+// so that branches from it can reach as far as their offsets allow.
+#define CASE_PC 0x00040000U
+
+#define RET_FAIL_ON_ERR(e) \
+  do { \
+      if (!(e)) { \
+          return EXIT_FAILURE; \
+      } \
+  } while (false)
+
+typedef struct LckOptions {
+    bool info_req;
+    uint64_t seed;
+    uint32_t runs;
+    uint64_t insns;
+    uint64_t interval;
+    char mem_img[MAX_ARG_VAL_SIZE];
+} LckOptions;
+
+typedef enum {
+    LCK_AGREED = 0,
+    LCK_BOTH_FAILED,
+    LCK_DIVERGED,
+} LckOutcome;
+
+typedef struct LckResult {
+    LckOutcome outcome;
+    uint64_t insns;
+    uint32_t pc;
+    uint32_t insn;
+    char diff[MAX_DIFF_MSG_SIZE];
+} LckResult;
+
+// A hand-picked instruction for a corner-case that random operands rarely hit.
+// It is assembled at `CASE_PC`, with the label "target" at `target` words from
+// there, and run for one instruction with `r1` and `r2` set to `r1_val` and
+// `r2_val`. A taken branch must reach "target", as the assembler must encode
+// the label so that it does. A case that does not `encode` must instead be
+// rejected by the assembler.
+typedef struct LckCase {
+    const char* text;
+    int32_t target;
+    uint32_t r1_val;
+    uint32_t r2_val;
+    bool encodes;
+} LckCase;
+
+static const LckCase lck_cases[] = {
+    // Branches to labels at (and just beyond) the limits of their offsets.
+    { "BRNE r1, r2, target", 32767, 1U, 0U, true, },
+    { "BRNE r1, r2, target", -32768, 1U, 0U, true, },
+    { "BRGT r1, r2, target", 32767, 1U, 0U, true, },
+    { "BRNE r1, r2, target", 32768, 1U, 0U, false, },
+    { "BRGT r1, r2, target", -32769, 1U, 0U, false, },
+    { "JMPI target", 32768, 0U, 0U, true, },
+    // Arithmetic right-shifts of a negative number by the largest amount.
+    { "SRAR r3, r1, r2", 0, 0x80000000U, 31U, true, },
+    { "SRAS r3, r1, r2", 0, 0x80000001U, 31U, true, },
+    { "SRAI r3, r1, 31", 0, 0x80000000U, 0U, true, },
+    { "SRAJ r3, r1, 31", 0, 0xFFFFFFFEU, 0U, true, },
+};
+
+#define NUM_LCK_CASES (sizeof lck_cases / sizeof lck_cases[0])
+
+// The initial state of the executor, to restore before each replay.
+static uint32_t init_iregs[CU_NUM_IREGS];
+static uint32_t mem_write_gen = 0U;
+static uint64_t rng_state = 0U;
+
+// Instructions in the body targeted by jumps or branches. Since these only go
+// forwards, a pair of instructions can be kept from being split by a target.
+static bool body_targets[BODY_INSNS + 1];
+
+static void PrintUsage(const char* restrict prg) {
+    CuLogInfo("Lockstep-checker for the CUSS executor.");
+    CuLogInfo("Usage: %s [options]", prg);
+    CuLogInfo("Options:");
+    CuLogInfo("  -h, --help: Show this help-message.");
+    CuLogInfo("  -i=<n>, --interval=<n>: Compare states every <n> "
+      "instructions.");
+    CuLogInfo("  -m=<file>, --memory-image=<file>: Run the memory-image from "
+      "<file>");
+    CuLogInfo("    instead of random instruction-streams.");
+    CuLogInfo("  -n=<n>, --instructions=<n>: Execute <n> instructions per "
+      "run.");
+    CuLogInfo("  -r=<n>, --runs=<n>: Execute <n> random instruction-streams.");
+    CuLogInfo("  -s=<n>, --seed=<n>: Seed the first random instruction-stream "
+      "with <n>.");
+}
+
+static const char* OptVal(const char* restrict arg, const char* restrict sopt,
+  const char* restrict lopt) {
+    const size_t slen = strlen(sopt);
+    const size_t llen = strlen(lopt);
+    if (strncmp(arg, sopt, slen) == 0) {
+        return arg + slen;
+    }
+    if (strncmp(arg, lopt, llen) == 0) {
+        return arg + llen;
+    }
+    return NULL;
+}
+
+static bool ParseCommandLine(int argc, char *argv[],
+  LckOptions* restrict opts) {
+    opts->info_req = false;
+    opts->seed = DEF_SEED;
+    opts->runs = DEF_RUNS;
+    opts->insns = DEF_INSNS_PER_RUN;
+    opts->interval = DEF_CHECK_INTERVAL;
+    opts->mem_img[0] = '\0';
+
+    for (int i = 1; i < argc; i++) {
+        const char* restrict arg = argv[i];
+        const char* val = NULL;
+
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            opts->info_req = true;
+            PrintUsage(argv[0]);
+            return true;
+        }
+        if ((val = OptVal(arg, "-i=", "--interval=")) != NULL) {
+            opts->interval = strtoull(val, NULL, 0);
+            continue;
+        }
+        if ((val = OptVal(arg, "-m=", "--memory-image=")) != NULL) {
+            strncpy(opts->mem_img, val, MAX_ARG_VAL_SIZE - 1);
+            opts->mem_img[MAX_ARG_VAL_SIZE - 1] = '\0';
+            continue;
+        }
+        if ((val = OptVal(arg, "-n=", "--instructions=")) != NULL) {
+            opts->insns = strtoull(val, NULL, 0);
+            continue;
+        }
+        if ((val = OptVal(arg, "-r=", "--runs=")) != NULL) {
+            opts->runs = (uint32_t)strtoul(val, NULL, 0);
+            continue;
+        }
+        if ((val = OptVal(arg, "-s=", "--seed=")) != NULL) {
+            opts->seed = strtoull(val, NULL, 0);
+            continue;
+        }
+
+        CuLogError("Invalid argument '%s'.", arg);
+        PrintUsage(argv[0]);
+        return false;
+    }
+    if (opts->interval == 0) {
+        opts->interval = 1;
+    }
+    return true;
+}
+
+// A xorshift64* pseudo-random number-generator.
+static uint32_t NextRand(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1DU) >> 32);
+}
+
+static uint32_t RandReg(void) {
+    return NextRand() % CU_NUM_IREGS;
+}
+
+static uint32_t RandDstReg(void) {
+    const uint32_t r = RandReg();
+    return (r == BODY_BASE_REG || r == DATA_BASE_REG) ? r - 2U : r;
+}
+
+// The index of a random instruction in the body shortly after the one at
+// `from`. Only skipping forwards by a few instructions keeps a program from
+// getting stuck in a tight loop, so that most of the body gets executed on each
+// pass through it.
+static uint32_t RandFwdBodyIndex(uint32_t from) {
+    const uint32_t from_idx = (from - BODY_BASE) >> 2;
+    const uint32_t left = BODY_INSNS - from_idx;
+    const uint32_t to_idx = from_idx + 1U +
+      NextRand() % (left < MAX_SKIP ? left : MAX_SKIP);
+    body_targets[to_idx] = true;
+    return to_idx;
+}
+
+// Whether a jump or a branch targets the instruction at `addr` in the body.
+static bool IsBodyTarget(uint32_t addr) {
+    return body_targets[(addr - BODY_BASE) >> 2];
+}
+
+// A word-offset from `from` to a random instruction after it in the body.
+static uint32_t RandBodyOffset(uint32_t from) {
+    const uint32_t to = BODY_BASE + RandFwdBodyIndex(from) * 4U;
+    return (to - from) >> 2;
+}
+
+static uint32_t EncodeR(uint32_t op1, uint32_t rt, uint32_t ra, uint32_t rb,
+  uint32_t imm5) {
+    return (rt << 21) | (ra << 16) | (rb << 11) | ((imm5 & 0x1FU) << 6) | op1;
+}
+
+static uint32_t EncodeI(uint32_t op0, uint32_t rt, uint32_t ra,
+  uint32_t imm16) {
+    return (op0 << 26) | (rt << 21) | (ra << 16) | (imm16 & 0xFFFFU);
+}
+
+// Emit one or two random instructions exercising a randomly-chosen op-code at
+// `addr`, returning the number of instructions emitted.
+static uint32_t EmitRandInsn(uint32_t addr, uint32_t* restrict insns) {
+#define NUM_OP0_00_OPS 34U
+#define NUM_OTHER_OPS 24U
+    const uint32_t op = NextRand() % (NUM_OP0_00_OPS + NUM_OTHER_OPS);
+    if (op < NUM_OP0_00_OPS) {
+        const uint32_t rt = RandDstReg();
+        const uint32_t ra = RandReg();
+        const uint32_t rb = RandReg();
+        const uint32_t imm5 = NextRand();
+        if (op == 0x1a || op == 0x1b) {
+            // Force a non-zero divisor to avoid stopping at a division-fault.
+            const uint32_t rd = (rb == 0 || rb == BODY_BASE_REG ||
+              rb == DATA_BASE_REG) ? 1U : rb;
+            insns[0] = EncodeI(0x02, rd, rd, 0x0001U);
+            insns[1] = EncodeR(op, rt, ra, rd, imm5);
+            return IsBodyTarget(addr + 4U) ? 1 : 2;
+        }
+        if (op == 0x1e || op == 0x1f) {
+            // Jump forwards to an address loaded into a register.
+            const uint32_t rj = (rt == 0) ? 1U : rt;
+            const uint32_t to = BODY_BASE + RandFwdBodyIndex(addr + 4U) * 4U;
+            insns[0] = EncodeI(0x02, rj, 0, to);
+            insns[1] = EncodeR(op, 0, rj, 0, imm5);
+            return IsBodyTarget(addr + 4U) ? 1 : 2;
+        }
+        insns[0] = EncodeR(op, rt, ra, rb, imm5);
+        return 1;
+    }
+
+    const uint32_t op0 = op - NUM_OP0_00_OPS + 1U;
+#undef NUM_OTHER_OPS
+#undef NUM_OP0_00_OPS
+    if (op0 <= 0x04 || op0 == 0x0d) {
+        insns[0] = EncodeI(op0, RandDstReg(), RandReg(), NextRand());
+    } else if (op0 <= 0x06) {
+        insns[0] = (op0 << 26) | (RandBodyOffset(addr) & 0x03FFFFFFU);
+    } else if (op0 <= 0x0a) {
+        insns[0] = (op0 << 26) | (BODY_BASE_REG << 21) |
+          RandFwdBodyIndex(addr);
+    } else if (op0 <= 0x0c) {
+        insns[0] = EncodeI(op0, RandReg(), RandReg(), RandBodyOffset(addr));
+    } else if (op0 <= 0x12) {
+        insns[0] = EncodeI(op0, RandDstReg(), DATA_BASE_REG,
+          NextRand() & 0x7FFFU);
+    } else if (op0 <= 0x15) {
+        insns[0] = EncodeI(op0, RandReg(), DATA_BASE_REG,
+          NextRand() & 0x7FFFU);
+    } else if (op0 <= 0x17) {
+        // LDLW and STCW, which need aligned addresses.
+        insns[0] = EncodeI(op0, RandDstReg(), DATA_BASE_REG,
+          NextRand() & 0x7FFCU);
+    } else {
+        insns[0] = op0 << 26;
+    }
+    return 1;
+}
+
+static bool ClearMainMem(CuError* restrict err) {
+    const uint32_t mem_size = CuGetMemSize();
+    for (uint32_t addr = 0; addr < mem_size; addr += 4U) {
+        RET_ON_ERR(CuSetWordAt(addr, 0x00000000U, err));
+    }
+    return true;
+}
+
+static bool GenerateProgram(uint64_t seed, CuError* restrict err) {
+    rng_state = (seed == 0) ? DEF_SEED : seed;
+    for (uint32_t i = 0; i <= BODY_INSNS; i++) {
+        body_targets[i] = false;
+    }
+
+    // Prologue: r30 := DATA_BASE; r29 := BODY_BASE; jump to the body.
+    RET_ON_ERR(CuSetWordAt(0x00, EncodeI(0x02, DATA_BASE_REG, 0,
+      DATA_BASE & 0xFFFFU), err));
+    RET_ON_ERR(CuSetWordAt(0x04, EncodeI(0x0d, DATA_BASE_REG, 0,
+      DATA_BASE >> 16), err));
+    RET_ON_ERR(CuSetWordAt(0x08, EncodeI(0x02, BODY_BASE_REG, 0,
+      BODY_BASE & 0xFFFFU), err));
+    RET_ON_ERR(CuSetWordAt(0x0c, EncodeI(0x0d, BODY_BASE_REG, 0,
+      BODY_BASE >> 16), err));
+    RET_ON_ERR(CuSetWordAt(0x10, (0x05U << 26) |
+      (((BODY_BASE - 0x10U) >> 2) & 0x03FFFFFFU), err));
+
+    // Leave room for a pair of instructions before the final jump, with any
+    // gap left as a zeroed word (a no-op SLLR).
+    uint32_t addr = BODY_BASE;
+    while (addr < BODY_BASE + (BODY_INSNS - 1U) * 4U) {
+        uint32_t insns[2];
+        const uint32_t n = EmitRandInsn(addr, insns);
+        for (uint32_t i = 0; i < n; i++) {
+            RET_ON_ERR(CuSetWordAt(addr, insns[i], err));
+            addr += 4U;
+        }
+    }
+    // Loop back to the start of the body.
+    addr = BODY_BASE + BODY_INSNS * 4U;
+    RET_ON_ERR(CuSetWordAt(addr, (0x05U << 26) |
+      (((BODY_BASE - addr) >> 2) & 0x03FFFFFFU), err));
+
+    for (uint32_t i = 0; i < DATA_SIZE; i += 4U) {
+        RET_ON_ERR(CuSetWordAt(DATA_BASE + i, NextRand(), err));
+    }
+    return true;
+}
+
+// Reset the executor to its initial state and load the program to run.
+static bool ResetMain(const LckOptions* restrict opts, uint64_t seed,
+  CuError* restrict err) {
+    for (uint8_t i = 0; i < CU_NUM_IREGS; i++) {
+        RET_ON_ERR(CuSetIntReg(i, init_iregs[i], err));
+    }
+    CuSetExtPrecReg(0x00000000U);
+    CuSetProcStatReg(0x00000000U);
+    RET_ON_ERR(CuSetProgCtr(0x00000000U, err));
+    CuGetCore(0)->resv_valid = false;
+
+    RET_ON_ERR(ClearMainMem(err));
+    if (opts->mem_img[0] != '\0') {
+        RET_ON_ERR(CuInitMemFromFile(opts->mem_img, err));
+    } else {
+        RET_ON_ERR(GenerateProgram(seed, err));
+    }
+    mem_write_gen = CuNextMemWriteGen();
+    return true;
+}
+
+// Make the reference-model start from the same state as the executor.
+static bool SyncRefWithMain(CuRefCup* restrict ref, CuError* restrict err) {
+    for (uint8_t i = 0; i < CU_NUM_IREGS; i++) {
+        RET_ON_ERR(CuGetIntReg(i, &ref->iregs[i], err));
+    }
+    ref->epr = CuGetExtPrecReg();
+    ref->pc = CuGetProgCtr();
+    ref->neg = CuIsNegFlagSet();
+    ref->ovf = CuIsOvfFlagSet();
+    ref->car = CuIsCarFlagSet();
+    ref->zer = CuIsZerFlagSet();
+    ref->resv_valid = false;
+    for (uint32_t addr = 0; addr < ref->mem_size; addr += 4U) {
+        uint32_t val;
+        RET_ON_ERR(CuGetWordAt(addr, &val, err));
+        ref->mem[addr] = (uint8_t)val;
+        ref->mem[addr + 1] = (uint8_t)(val >> 8);
+        ref->mem[addr + 2] = (uint8_t)(val >> 16);
+        ref->mem[addr + 3] = (uint8_t)(val >> 24);
+    }
+    for (uint32_t p = 0; p <= (ref->mem_size >> CU_MEM_PAGE_SHIFT); p++) {
+        ref->dirty_pages[p] = false;
+    }
+    return true;
+}
+
+// The FNV-1a hash of a page of memory in the executor.
+static uint64_t HashMainPage(uint32_t page) {
+    uint64_t hash = 0xCBF29CE484222325U;
+    const uint32_t base = page << CU_MEM_PAGE_SHIFT;
+    for (uint32_t i = 0; i < CU_MEM_PAGE_SIZE; i += 4U) {
+        uint32_t val = 0;
+        CuGetWordAt(base + i, &val, /*err=*/NULL);
+        for (int j = 0; j < 4; j++) {
+            hash = (hash ^ ((val >> (8 * j)) & 0xFFU)) * 0x100000001B3U;
+        }
+    }
+    return hash;
+}
+
+// The FNV-1a hash of a page of memory in the reference-model.
+static uint64_t HashRefPage(const CuRefCup* restrict ref, uint32_t page) {
+    uint64_t hash = 0xCBF29CE484222325U;
+    const uint8_t* base = ref->mem + (page << CU_MEM_PAGE_SHIFT);
+    for (uint32_t i = 0; i < CU_MEM_PAGE_SIZE; i++) {
+        hash = (hash ^ base[i]) * 0x100000001B3U;
+    }
+    return hash;
+}
+
+// Compare the states of the executor and the reference-model, describing the
+// first difference in `diff` if they are not the same.
+static bool StatesMatch(const CuRefCup* restrict ref,
+  char diff[MAX_DIFF_MSG_SIZE]) {
+    for (uint8_t i = 0; i < CU_NUM_IREGS; i++) {
+        uint32_t val = 0;
+        CuGetIntReg(i, &val, /*err=*/NULL);
+        if (val != ref->iregs[i]) {
+            snprintf(diff, MAX_DIFF_MSG_SIZE, "r%d: executor=%08" PRIx32
+              ", reference=%08" PRIx32, i, val, ref->iregs[i]);
+            return false;
+        }
+    }
+    if (CuGetProgCtr() != ref->pc) {
+        snprintf(diff, MAX_DIFF_MSG_SIZE, "pc: executor=%08" PRIx32
+          ", reference=%08" PRIx32, CuGetProgCtr(), ref->pc);
+        return false;
+    }
+    if (CuGetExtPrecReg() != ref->epr) {
+        snprintf(diff, MAX_DIFF_MSG_SIZE, "ep: executor=%08" PRIx32
+          ", reference=%08" PRIx32, CuGetExtPrecReg(), ref->epr);
+        return false;
+    }
+    const bool main_flags[] = {CuIsNegFlagSet(), CuIsOvfFlagSet(),
+        CuIsCarFlagSet(), CuIsZerFlagSet()};
+    const bool ref_flags[] = {ref->neg, ref->ovf, ref->car, ref->zer};
+    const char flag_names[] = {'N', 'O', 'C', 'Z'};
+    for (int i = 0; i < 4; i++) {
+        if (main_flags[i] != ref_flags[i]) {
+            snprintf(diff, MAX_DIFF_MSG_SIZE, "%c-flag: executor=%d, "
+              "reference=%d", flag_names[i], main_flags[i], ref_flags[i]);
+            return false;
+        }
+    }
+
+    // Only the pages written to by either of the engines can differ.
+    uint64_t main_hash = 0;
+    uint64_t ref_hash = 0;
+    uint32_t first_diff_page = 0xFFFFFFFFU;
+    const uint32_t num_pages = ref->mem_size >> CU_MEM_PAGE_SHIFT;
+    for (uint32_t p = 0; p < num_pages; p++) {
+        if (CuGetPageWriteGen(p) < mem_write_gen && !ref->dirty_pages[p]) {
+            continue;
+        }
+        const uint64_t main_page_hash = HashMainPage(p);
+        const uint64_t ref_page_hash = HashRefPage(ref, p);
+        if (main_page_hash != ref_page_hash && first_diff_page == 0xFFFFFFFFU) {
+            first_diff_page = p;
+        }
+        main_hash = (main_hash ^ main_page_hash) * 0x100000001B3U;
+        ref_hash = (ref_hash ^ ref_page_hash) * 0x100000001B3U;
+    }
+    if (main_hash != ref_hash) {
+        snprintf(diff, MAX_DIFF_MSG_SIZE, "memory-hash: executor=%016" PRIx64
+          ", reference=%016" PRIx64 " (first differing page at %08" PRIx32
+          ")", main_hash, ref_hash, first_diff_page << CU_MEM_PAGE_SHIFT);
+        return false;
+    }
+    return true;
+}
+
+// Run the executor and the reference-model in lockstep for up to `max_insns`
+// instructions, comparing their states every `interval` instructions.
+static bool RunLockstep(const LckOptions* restrict opts, uint64_t seed,
+  uint64_t max_insns, uint64_t interval, CuRefCup* restrict ref,
+  LckResult* restrict res, CuError* restrict err) {
+    RET_ON_ERR(ResetMain(opts, seed, err));
+    RET_ON_ERR(SyncRefWithMain(ref, err));
+
+    res->outcome = LCK_AGREED;
+    res->insns = 0;
+    res->diff[0] = '\0';
+    while (res->insns < max_insns) {
+        res->pc = CuGetProgCtr();
+        res->insn = 0;
+        CuError main_err;
+        CuError ref_err;
+        const bool main_ok = CuGetWordAt(res->pc, &res->insn, &main_err) &&
+          CuExecOp(CuGetCore(0), res->insn, &main_err);
+        const bool ref_ok = CuRefStep(ref, &ref_err);
+        res->insns++;
+
+        if (!main_ok || !ref_ok) {
+            if (main_ok == ref_ok) {
+                res->outcome = LCK_BOTH_FAILED;
+                snprintf(res->diff, MAX_DIFF_MSG_SIZE, "%.200s",
+                  main_err.err_msg);
+            } else {
+                res->outcome = LCK_DIVERGED;
+                snprintf(res->diff, MAX_DIFF_MSG_SIZE,
+                  "fault: executor='%.100s', reference='%.100s'",
+                  main_ok ? "" : main_err.err_msg,
+                  ref_ok ? "" : ref_err.err_msg);
+            }
+            return true;
+        }
+        if ((res->insns % interval) == 0 || res->insns == max_insns) {
+            if (!StatesMatch(ref, res->diff)) {
+                res->outcome = LCK_DIVERGED;
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+static void ReportDivergence(uint64_t seed, const LckResult* restrict res) {
+    char insn_buf[64];
+    CuDecodeOp(res->insn, insn_buf, sizeof insn_buf);
+    CuLogError("Divergence at instruction #%" PRIu64 " (seed=%" PRIu64 "):",
+      res->insns, seed);
+    CuLogError("  %08" PRIx32 ": %08" PRIx32 "  %s", res->pc, res->insn,
+      insn_buf);
+    CuLogError("  %s", res->diff);
+}
+
+static bool LookUpCaseLabel(const char* restrict name, size_t len,
+  uint32_t* restrict addr, void* ctx) {
+    if (len != strlen("target") || strncmp(name, "target", len) != 0) {
+        return false;
+    }
+    *addr = *(const uint32_t*)ctx;
+    return true;
+}
+
+// Assemble and run the hand-picked case `lc` in lockstep.
+static bool CheckCase(const LckOptions* restrict opts,
+  const LckCase* restrict lc, CuRefCup* restrict ref, CuError* restrict err) {
+    uint32_t target = CASE_PC + (uint32_t)lc->target * 4U;
+    uint32_t insns[CU_OPENC_MAX_INSNS];
+    size_t num_insns = 0;
+    CuError enc_err;
+    const bool encoded = CuEncodeOps(lc->text, strlen(lc->text), CASE_PC,
+      LookUpCaseLabel, &target, insns, &num_insns, &enc_err);
+    if (encoded != lc->encodes) {
+        return CuErrMsg(err, "'%s' with target %+" PRId32 " was %s.", lc->text,
+          lc->target, encoded ? "encoded" : "not encoded");
+    }
+    if (!encoded) {
+        return true;
+    }
+
+    RET_ON_ERR(ResetMain(opts, opts->seed, err));
+    for (size_t i = 0; i < num_insns; i++) {
+        RET_ON_ERR(CuSetWordAt(CASE_PC + (uint32_t)i * 4U, insns[i], err));
+    }
+    RET_ON_ERR(CuSetIntReg(1, lc->r1_val, err));
+    RET_ON_ERR(CuSetIntReg(2, lc->r2_val, err));
+    RET_ON_ERR(CuSetProgCtr(CASE_PC, err));
+    RET_ON_ERR(SyncRefWithMain(ref, err));
+
+    char diff[MAX_DIFF_MSG_SIZE];
+    for (size_t i = 0; i < num_insns; i++) {
+        RET_ON_ERR(CuExecOp(CuGetCore(0), insns[i], err));
+        RET_ON_ERR(CuRefStep(ref, err));
+        if (!StatesMatch(ref, diff)) {
+            return CuErrMsg(err, "'%s' diverged: %s", lc->text, diff);
+        }
+    }
+    if (lc->target != 0 && CuGetProgCtr() != target) {
+        return CuErrMsg(err, "'%s' went to %08" PRIx32 " instead of %08"
+          PRIx32 ".", lc->text, CuGetProgCtr(), target);
+    }
+    return true;
+}
+
+// Run one instruction-stream, returning `false` on a divergence.
+static bool CheckStream(const LckOptions* restrict opts, uint64_t seed,
+  CuRefCup* restrict ref, CuError* restrict err) {
+    LckResult res;
+    RET_ON_ERR(RunLockstep(opts, seed, opts->insns, opts->interval, ref, &res,
+      err));
+    if (res.outcome == LCK_BOTH_FAILED) {
+        CuLogInfo("Seed %" PRIu64 ": both engines faulted at instruction #%"
+          PRIu64 " (%s).", seed, res.insns, res.diff);
+        return true;
+    }
+    if (res.outcome == LCK_AGREED) {
+        CuLogInfo("Seed %" PRIu64 ": %" PRIu64 " instructions in lockstep.",
+          seed, res.insns);
+        return true;
+    }
+
+    // Replay up to the failing check, this time comparing after every
+    // instruction to pin-point the first one to diverge.
+    if (opts->interval > 1) {
+        LckResult exact;
+        RET_ON_ERR(RunLockstep(opts, seed, res.insns, /*interval=*/1, ref,
+          &exact, err));
+        if (exact.outcome == LCK_DIVERGED) {
+            res = exact;
+        }
+    }
+    ReportDivergence(seed, &res);
+    return CuErrMsg(err, "Executor diverged from the reference-model.");
+}
+
+int main(int argc, char *argv[]) {
+    LckOptions opts;
+    RET_FAIL_ON_ERR(ParseCommandLine(argc, argv, &opts));
+    if (opts.info_req) {
+        return EXIT_SUCCESS;
+    }
+
+    CuError err;
+    if (!CuInitCpu(&err)) {
+        CuLogError("Could not initialize the CPU: %s", err.err_msg);
+        return EXIT_FAILURE;
+    }
+    for (uint8_t i = 0; i < CU_NUM_IREGS; i++) {
+        CuGetIntReg(i, &init_iregs[i], &err);
+    }
+    CuRefCup ref;
+    if (!CuRefInit(&ref, CuGetMemSize(), &err)) {
+        CuLogError("Could not initialize the reference-model: %s",
+          err.err_msg);
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t runs = (opts.mem_img[0] != '\0') ? 1U : opts.runs;
+    const uint64_t t0 = CuTimGetHostNs();
+    bool ok = true;
+    for (size_t i = 0; i < NUM_LCK_CASES && ok; i++) {
+        ok = CheckCase(&opts, &lck_cases[i], &ref, &err);
+        if (!ok) {
+            CuLogError("%s", err.err_msg);
+        }
+    }
+    if (ok) {
+        CuLogInfo("Checked %zu hand-picked case(s).", NUM_LCK_CASES);
+    }
+    for (uint32_t i = 0; i < runs && ok; i++) {
+        ok = CheckStream(&opts, opts.seed + i, &ref, &err);
+        if (!ok) {
+            CuLogError("%s", err.err_msg);
+        }
+    }
+    const uint64_t t1 = CuTimGetHostNs();
+    CuLogInfo("Checked %" PRIu32 " run(s) in %0.3f s.", runs,
+      (double)(t1 - t0) / 1e9);
+
+    CuRefFree(&ref);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
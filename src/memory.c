@@ -1,19 +1,92 @@
 // SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
 // SPDX-License-Identifier: BSD-3-Clause
+// Needed for `mmap()` and friends.
+#define _POSIX_C_SOURCE 200809L
+
 #include "memory.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stddef.h>
-#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "concur.h"
 #include "logger.h"
 
-#define CUSS_MEMSIZE (1 << 20)
+// The display-mode register has a page of its own.
+#define CUSS_MEMSIZE (CU_DISP_MODE_ADDR + CU_MEM_PAGE_SIZE)
+
+#define CUSS_MEMPAGES (CUSS_MEMSIZE >> CU_MEM_PAGE_SHIFT)
 
 static uint8_t cuss_mem[CUSS_MEMSIZE];
 
+// Atomic accesses to a word of memory hold one of these locks, chosen by the
+// address of the word, each on a cache-line of its own.
+#define NUM_ATOMIC_STRIPES 64
+#define CACHE_LINE_SIZE 64
+
+typedef union AtomicStripe {
+    CuSpinLock lock;
+    uint8_t pad[CACHE_LINE_SIZE];
+} AtomicStripe;
+
+static AtomicStripe atomic_stripes[NUM_ATOMIC_STRIPES];
+
+// The write-generation of the latest write to each page of memory.
+static uint32_t cuss_page_gens[CUSS_MEMPAGES];
+static uint32_t cuss_write_gen = 0;
+
+// Only the pages of the simulated display are marked when written to, as
+// raising a mark costs a memory-barrier.
+#define FIRST_MARKED_PAGE (CU_FB_BASE >> CU_MEM_PAGE_SHIFT)
+
+// Whether each page of the simulated display has been written to since its
+// mark was last taken by `CuTakeWrittenPages()`. A mark is raised after the
+// write, so a thread that takes it also sees what was written.
+#define NUM_MARKED_PAGES (CUSS_MEMPAGES - FIRST_MARKED_PAGE)
+static CuAtomicFlag cuss_page_marks[NUM_MARKED_PAGES];
+
+static inline void MarkPage(uint32_t page) {
+    // A page before the first marked page wraps around to a large index.
+    const uint32_t i = page - FIRST_MARKED_PAGE;
+    if (i < NUM_MARKED_PAGES) {
+        CuAtomicFlagRaise(&cuss_page_marks[i]);
+    }
+}
+
+static inline void StampWrite(uint32_t addr, uint32_t nbytes) {
+    cuss_page_gens[addr >> CU_MEM_PAGE_SHIFT] = cuss_write_gen;
+    cuss_page_gens[(addr + nbytes - 1U) >> CU_MEM_PAGE_SHIFT] = cuss_write_gen;
+    MarkPage(addr >> CU_MEM_PAGE_SHIFT);
+    MarkPage((addr + nbytes - 1U) >> CU_MEM_PAGE_SHIFT);
+}
+
+// Stamp every page in the `nbytes` bytes from `addr` onwards.
+static void StampRange(uint32_t addr, uint32_t nbytes) {
+    if (nbytes == 0) {
+        return;
+    }
+    const uint32_t last = (addr + nbytes - 1U) >> CU_MEM_PAGE_SHIFT;
+    for (uint32_t p = addr >> CU_MEM_PAGE_SHIFT; p <= last; p++) {
+        cuss_page_gens[p] = cuss_write_gen;
+        MarkPage(p);
+    }
+}
+
+static bool IsValidPhyMemRange(uint32_t addr, uint32_t nbytes,
+  CuError* restrict err) {
+    if (addr > CUSS_MEMSIZE || nbytes > CUSS_MEMSIZE - addr) {
+        return CuErrMsg(err, "Bad memory-range (0x%08" PRIx32 " + 0x%08"
+          PRIx32 ").", addr, nbytes);
+    }
+    return true;
+}
+
 static inline uint16_t LeTwinBytesToUint16(const uint8_t* bytes) {
     return (uint16_t)(bytes[0]) | ((uint16_t)(bytes[1]) << 8);
 }
@@ -23,9 +96,16 @@ static inline uint32_t LeQuadBytesToUint32(const uint8_t* bytes) {
       ((uint32_t)(bytes[2]) << 16) | ((uint32_t)(bytes[3]) << 24);
 }
 
+uint32_t CuGetMemSize(void) {
+    return CUSS_MEMSIZE;
+}
+
 bool CuIsValidPhyMemAddr(uint32_t addr, CuError* restrict err) {
     if (addr >= CUSS_MEMSIZE) {
-        return CuErrMsg(err, "Bad memory-address (0x%08" PRIx32 ").", addr);
+        // Not returned directly, so that the compiler knows that `addr` is
+        // in range after a successful check.
+        CuErrMsg(err, "Bad memory-address (0x%08" PRIx32 ").", addr);
+        return false;
     }
     return true;
 }
@@ -66,6 +146,7 @@ bool CuGetWordAt(uint32_t addr, uint32_t* restrict val, CuError* restrict err) {
 bool CuSetByteAt(uint32_t addr, uint8_t val, CuError* restrict err) {
     RET_ON_ERR(CuIsValidPhyMemAddr(addr, err));
     cuss_mem[addr] = val;
+    StampWrite(addr, 1U);
     return true;
 }
 
@@ -75,6 +156,7 @@ bool CuSetHalfWordAt(uint32_t addr, uint16_t val, CuError* restrict err) {
     uint8_t* base = cuss_mem + addr;
     *base = (uint8_t)(val & 0x00FFU);
     *(base + 1) = (uint8_t)((val & 0xFF00U) >> 8);
+    StampWrite(addr, 2U);
     return true;
 }
 
@@ -86,60 +168,309 @@ bool CuSetWordAt(uint32_t addr, uint32_t val, CuError* restrict err) {
     *(base + 1) = (uint8_t)((val & 0x0000FF00U) >> 8);
     *(base + 2) = (uint8_t)((val & 0x00FF0000U) >> 16);
     *(base + 3) = (uint8_t)((val & 0xFF000000U) >> 24);
+    StampWrite(addr, 4U);
     return true;
 }
 
-bool CuInitMemFromFile(const char* restrict file, CuError* restrict err) {
-    if (file == NULL) {
-        return CuErrMsg(err, "Missing file-name.");
+static inline CuSpinLock* GetAtomicLock(uint32_t addr) {
+    return &atomic_stripes[(addr >> 2) & (NUM_ATOMIC_STRIPES - 1)].lock;
+}
+
+static bool IsValidAtomicAddr(uint32_t addr, CuError* restrict err) {
+    RET_ON_ERR(CuIsValidPhyMemAddr(addr, err) &&
+      CuIsValidPhyMemAddr(addr + 3U, err));
+    if (addr & 0x00000003U) {
+        return CuErrMsg(err, "Unaligned atomic memory-access (0x%08" PRIx32
+          ").", addr);
     }
+    return true;
+}
 
-    FILE *f = fopen(file, "rb");
-    if (f == NULL) {
-        return CuErrMsg(err, "Could not open file (%s).", strerror(errno));
+bool CuGetWordAtomicAt(uint32_t addr, uint32_t* restrict val,
+  CuError* restrict err) {
+    RET_ON_ERR(IsValidAtomicAddr(addr, err));
+    CuSpinLock* lock = GetAtomicLock(addr);
+    CuMemFence();
+    CuSpinLockAcquire(lock);
+    *val = LeQuadBytesToUint32(cuss_mem + addr);
+    CuSpinLockRelease(lock);
+    CuMemFence();
+    return true;
+}
+
+bool CuCasWordAt(uint32_t addr, uint32_t old_val, uint32_t new_val,
+  bool* restrict swapped, CuError* restrict err) {
+    RET_ON_ERR(IsValidAtomicAddr(addr, err));
+    CuSpinLock* lock = GetAtomicLock(addr);
+    uint8_t* base = cuss_mem + addr;
+    CuMemFence();
+    CuSpinLockAcquire(lock);
+    *swapped = LeQuadBytesToUint32(base) == old_val;
+    if (*swapped) {
+        *base = (uint8_t)(new_val & 0x000000FFU);
+        *(base + 1) = (uint8_t)((new_val & 0x0000FF00U) >> 8);
+        *(base + 2) = (uint8_t)((new_val & 0x00FF0000U) >> 16);
+        *(base + 3) = (uint8_t)((new_val & 0xFF000000U) >> 24);
+        StampWrite(addr, 4U);
+    }
+    CuSpinLockRelease(lock);
+    CuMemFence();
+    return true;
+}
+
+bool CuReadMemRange(uint32_t addr, uint32_t nbytes, uint8_t* restrict buf,
+  CuError* restrict err) {
+    RET_ON_ERR(IsValidPhyMemRange(addr, nbytes, err));
+    if (buf == NULL) {
+        return CuErrMsg(err, "NULL fetch-location.");
     }
-    char buffer[BUFSIZ];
-    if (setvbuf(f, buffer, _IOFBF, BUFSIZ)) {
-        fclose(f);
-        return CuErrMsg(err, "Could not set input-buffer.");
+    memcpy(buf, cuss_mem + addr, nbytes);
+    return true;
+}
+
+bool CuWriteMemRange(uint32_t addr, uint32_t nbytes,
+  const uint8_t* restrict buf, CuError* restrict err) {
+    RET_ON_ERR(IsValidPhyMemRange(addr, nbytes, err));
+    if (buf == NULL) {
+        return CuErrMsg(err, "NULL source-location.");
     }
+    memcpy(cuss_mem + addr, buf, nbytes);
+    StampRange(addr, nbytes);
+    return true;
+}
 
-    do {
-        uint8_t header[8];
-        size_t nhdr = fread(header, 1, sizeof header, f);
-        if (nhdr == 0) {
-            fclose(f);
-            return true;
-        }
-        if (nhdr < sizeof header) {
-            fclose(f);
-            return CuErrMsg(err, "Truncated section-header (%u < %u).", nhdr,
-              sizeof header);
-        }
+uint32_t CuNextMemWriteGen(void) {
+    return ++cuss_write_gen;
+}
+
+uint32_t CuGetPageWriteGen(uint32_t page) {
+    if (page >= CUSS_MEMPAGES) {
+        return 0U;
+    }
+    return cuss_page_gens[page];
+}
 
-        uint32_t base = LeQuadBytesToUint32(header);
-        uint32_t nbytes = LeQuadBytesToUint32(header + 4);
+// A memory-image is loaded in blocks of at most this many bytes, which are
+// copied into memory in parallel.
+#define IMAGE_BLOCK_SIZE (64U * 1024U)
 
-        // TODO: Handle overflows.
-        if (!CuIsValidPhyMemAddr(base + nbytes, err)) {
+// A block of the data of a section of a memory-image.
+typedef struct ImageBlock {
+    uint32_t base;
+    uint32_t nbytes;
+    const uint8_t* data;
+} ImageBlock;
+
+static int CompareImageBlocks(const void* a, const void* b) {
+    const uint32_t base_a = ((const ImageBlock*)a)->base;
+    const uint32_t base_b = ((const ImageBlock*)b)->base;
+    return (base_a > base_b) - (base_a < base_b);
+}
+
+static bool CopyImageBlocks(void* data, size_t begin, size_t end,
+  CuError* restrict err) {
+    (void)err;  // Suppress unused parameter warning.
+    const ImageBlock* blocks = data;
+    for (size_t i = begin; i < end; i++) {
+        memcpy(cuss_mem + blocks[i].base, blocks[i].data, blocks[i].nbytes);
+    }
+    return true;
+}
+
+// Check the sections of the `size` bytes of the memory-image at `image`,
+// splitting them into blocks of at most `IMAGE_BLOCK_SIZE` bytes.
+static bool GetImageBlocks(const uint8_t* restrict image, size_t size,
+  ImageBlock** restrict blocks, size_t* restrict num_blocks,
+  CuError* restrict err) {
+    size_t cap = 0;
+    *blocks = NULL;
+    *num_blocks = 0;
+    size_t off = 0;
+    while (off < size) {
+        const size_t nhdr = size - off;
+        if (nhdr < 8U) {
+            return CuErrMsg(err, "Truncated section-header (%zu < %u).", nhdr,
+              8U);
+        }
+        const uint32_t base = LeQuadBytesToUint32(image + off);
+        const uint32_t nbytes = LeQuadBytesToUint32(image + off + 4U);
+        off += 8U;
+
+        CuError nerr;
+        if (!IsValidPhyMemRange(base, nbytes, &nerr)) {
             return CuErrMsg(err,
               "Out of bounds (base=0x%08" PRIx32 " + nbytes=0x%08" PRIx32
               " > 0x%08" PRIx32 ").", base, nbytes, CUSS_MEMSIZE);
         }
-        size_t ndata = fread(cuss_mem + base, 1, nbytes, f);
-        if (ndata < nbytes) {
-            fclose(f);
-            return CuErrMsg(err, "Truncated section-data (%u < %u).", ndata,
-              nbytes);
+        if (size - off < nbytes) {
+            return CuErrMsg(err, "Truncated section-data (%zu < %" PRIu32
+              ").", size - off, nbytes);
+        }
+        for (uint32_t done = 0; done < nbytes; done += IMAGE_BLOCK_SIZE) {
+            if (*num_blocks == cap) {
+                cap = (cap == 0) ? 16U : 2U * cap;
+                ImageBlock* more = realloc(*blocks, cap * sizeof **blocks);
+                if (more == NULL) {
+                    return CuErrMsg(err, "Unable to allocate image-blocks.");
+                }
+                *blocks = more;
+            }
+            ImageBlock* blk = &(*blocks)[(*num_blocks)++];
+            blk->base = base + done;
+            blk->nbytes = (nbytes - done < IMAGE_BLOCK_SIZE) ?
+              nbytes - done : IMAGE_BLOCK_SIZE;
+            blk->data = image + off + done;
         }
+        off += nbytes;
         CuLogInfo("Loaded nbytes=0x%08" PRIx32 " at base=0x%08" PRIx32 "\n",
           nbytes, base);
-    } while (!feof(f) && !ferror(f));
-    if (ferror(f)) {
-        fclose(f);
-        return CuErrMsg(err, "Error reading file.");
     }
+    return true;
+}
 
-    fclose(f);
+void CuTakeWrittenPages(uint32_t first_page, uint32_t num_pages,
+  bool* restrict written) {
+    for (uint32_t i = 0; i < num_pages; i++) {
+        const uint32_t p = first_page + i;
+        const uint32_t m = p - FIRST_MARKED_PAGE;
+        written[i] = m < NUM_MARKED_PAGES &&
+          CuAtomicFlagTake(&cuss_page_marks[m]);
+    }
+}
+
+bool CuInitMemFromFile(const char* restrict file, CuError* restrict err) {
+    if (file == NULL) {
+        return CuErrMsg(err, "Missing file-name.");
+    }
+    const int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return CuErrMsg(err, "Could not open file (%s).", strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return CuErrMsg(err, "Could not get file-size (%s).", strerror(errno));
+    }
+    if (st.st_size <= 0) {
+        close(fd);
+        return true;
+    }
+    const size_t size = (size_t)st.st_size;
+    void* image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        return CuErrMsg(err, "Could not map file (%s).", strerror(errno));
+    }
+
+    // Check every section before copying any of them, so that the blocks can
+    // be copied by the host thread-pool in any order. Later sections must
+    // overwrite earlier ones though, so overlapping sections are copied
+    // serially in the order of the file.
+    ImageBlock* blocks;
+    size_t num_blocks;
+    if (!GetImageBlocks(image, size, &blocks, &num_blocks, err)) {
+        free(blocks);
+        munmap(image, size);
+        return false;
+    }
+    ImageBlock* sorted = malloc(num_blocks * sizeof *sorted);
+    bool overlaps = true;
+    if (sorted != NULL) {
+        memcpy(sorted, blocks, num_blocks * sizeof *sorted);
+        qsort(sorted, num_blocks, sizeof *sorted, CompareImageBlocks);
+        overlaps = false;
+        for (size_t i = 1; i < num_blocks && !overlaps; i++) {
+            overlaps = sorted[i - 1].base + sorted[i - 1].nbytes >
+              sorted[i].base;
+        }
+        free(sorted);
+    }
+    const bool ok = CuPoolParallelFor(overlaps ? NULL : CuGetHostPool(), 0,
+      num_blocks, 1U, CopyImageBlocks, blocks, err);
+    for (size_t i = 0; i < num_blocks; i++) {
+        StampRange(blocks[i].base, blocks[i].nbytes);
+    }
+    free(blocks);
+    munmap(image, size);
+    return ok;
+}
+
+bool CuLoadMemFromFile(const char* restrict file, uint32_t addr,
+  uint32_t* restrict nbytes, CuError* restrict err) {
+    if (file == NULL) {
+        return CuErrMsg(err, "Missing file-name.");
+    }
+    if (nbytes == NULL) {
+        return CuErrMsg(err, "NULL `nbytes`.");
+    }
+    const int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return CuErrMsg(err, "Could not open file (%s).", strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return CuErrMsg(err, "Could not get file-size (%s).", strerror(errno));
+    }
+    if (st.st_size < 0 || (uint64_t)st.st_size > CUSS_MEMSIZE) {
+        close(fd);
+        return CuErrMsg(err, "File too large (%jd bytes).",
+          (intmax_t)st.st_size);
+    }
+    const uint32_t size = (uint32_t)st.st_size;
+    if (!IsValidPhyMemRange(addr, size, err)) {
+        close(fd);
+        return false;
+    }
+    if (size == 0) {
+        close(fd);
+        *nbytes = 0;
+        return true;
+    }
+
+    // Map the file instead of reading it through a buffer, so the data is
+    // copied only once - from the page-cache into memory.
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return CuErrMsg(err, "Could not map file (%s).", strerror(errno));
+    }
+    memcpy(cuss_mem + addr, data, size);
+    munmap(data, size);
+    StampRange(addr, size);
+    *nbytes = size;
+    return true;
+}
+
+bool CuSaveMemToFile(const char* restrict file, uint32_t addr,
+  uint32_t nbytes, CuError* restrict err) {
+    if (file == NULL) {
+        return CuErrMsg(err, "Missing file-name.");
+    }
+    RET_ON_ERR(IsValidPhyMemRange(addr, nbytes, err));
+    const int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return CuErrMsg(err, "Could not open file (%s).", strerror(errno));
+    }
+
+    // Write straight out of memory, without an intermediate buffer.
+    const uint8_t* p = cuss_mem + addr;
+    size_t left = nbytes;
+    while (left > 0) {
+        const ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return CuErrMsg(err, "Could not write file (%s).",
+              strerror(errno));
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    if (close(fd) != 0) {
+        return CuErrMsg(err, "Could not close file (%s).", strerror(errno));
+    }
     return true;
 }
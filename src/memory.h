@@ -8,6 +8,37 @@
 
 #include "errors.h"
 
+// The granularity at which writes to memory are tracked.
+#define CU_MEM_PAGE_SHIFT 12
+#define CU_MEM_PAGE_SIZE (1U << CU_MEM_PAGE_SHIFT)
+
+// The general-purpose RAM starts at address 0, followed by the frame-buffer of
+// the display-adapter: `CU_FB_HEIGHT` rows of `CU_FB_WIDTH` 32-bpp pixels,
+// each a little-endian word 0x00RRGGBB. Every row fills exactly one page.
+#define CU_RAM_SIZE (1U << 20)
+#define CU_FB_BASE CU_RAM_SIZE
+#define CU_FB_WIDTH 1024U
+#define CU_FB_HEIGHT 768U
+#define CU_FB_PITCH (4U * CU_FB_WIDTH)
+#define CU_FB_SIZE (CU_FB_PITCH * CU_FB_HEIGHT)
+
+// The text-mode cell-grid of the display-adapter follows the frame-buffer:
+// `CU_TXT_ROWS` rows of `CU_TXT_COLS` cells, each a half-word with the code of
+// a character of the VGA font in its low byte and its attribute in its high
+// byte. The low nibble of the attribute is the color of the character and the
+// high nibble that of its background, from the 16 colors of the CGA palette.
+// The display-mode register right after it selects whether the display shows
+// the cell-grid (`CU_DISP_MODE_TEXT`) or the frame-buffer (any other value).
+#define CU_TXT_BASE (CU_FB_BASE + CU_FB_SIZE)
+#define CU_TXT_COLS 128U
+#define CU_TXT_ROWS 48U
+#define CU_TXT_SIZE (2U * CU_TXT_COLS * CU_TXT_ROWS)
+#define CU_DISP_MODE_ADDR (CU_TXT_BASE + CU_TXT_SIZE)
+#define CU_DISP_MODE_FB 0U
+#define CU_DISP_MODE_TEXT 1U
+
+extern uint32_t CuGetMemSize(void);
+
 extern bool CuIsValidPhyMemAddr(uint32_t addr, CuError* restrict err);
 
 extern bool CuGetByteAt(uint32_t addr, uint8_t* restrict val,
@@ -23,6 +54,48 @@ extern bool CuSetByteAt(uint32_t addr, uint8_t val, CuError* restrict err);
 extern bool CuSetHalfWordAt(uint32_t addr, uint16_t val, CuError* restrict err);
 extern bool CuSetWordAt(uint32_t addr, uint32_t val, CuError* restrict err);
 
+// Atomic accesses to the aligned word at `addr`, which are also full
+// memory-barriers (see "concur.h"). They are only atomic with respect to each
+// other, not to the plain accesses above. `CuCasWordAt()` stores `new_val` only
+// if the word holds `old_val`, setting `swapped` to whether it did.
+extern bool CuGetWordAtomicAt(uint32_t addr, uint32_t* restrict val,
+  CuError* restrict err);
+extern bool CuCasWordAt(uint32_t addr, uint32_t old_val, uint32_t new_val,
+  bool* restrict swapped, CuError* restrict err);
+
+// Copy `nbytes` bytes of memory from the memory-address `addr` onwards into
+// `buf`, or from `buf` into memory, checking the bounds once for the range.
+extern bool CuReadMemRange(uint32_t addr, uint32_t nbytes,
+  uint8_t* restrict buf, CuError* restrict err);
+extern bool CuWriteMemRange(uint32_t addr, uint32_t nbytes,
+  const uint8_t* restrict buf, CuError* restrict err);
+
+// Every write to a page of memory stamps it with the current write-generation.
+// A page has been written to since the start of a given write-generation if
+// its stamp is the same as or later than that write-generation.
+extern uint32_t CuNextMemWriteGen(void);
+extern uint32_t CuGetPageWriteGen(uint32_t page);
+
+// Set `written[i]` to whether the page `first_page + i` has been written to
+// since the last call for it, for `num_pages` pages, clearing those marks.
+// Only the pages of the frame-buffer, the cell-grid, and the display-mode
+// register are marked. Unlike write-generations, this can be called from a
+// thread other than the Executor (e.g. to show the frame-buffer): a page
+// written to while it runs is either reported now, with the write visible to
+// the caller, or marked again for the next call.
+extern void CuTakeWrittenPages(uint32_t first_page, uint32_t num_pages,
+  bool* restrict written);
+
 extern bool CuInitMemFromFile(const char* restrict file, CuError* restrict err);
 
+// Load the entire contents of the host-file `file` into memory from `addr`
+// onwards, setting `nbytes` to the number of bytes loaded.
+extern bool CuLoadMemFromFile(const char* restrict file, uint32_t addr,
+  uint32_t* restrict nbytes, CuError* restrict err);
+
+// Save `nbytes` bytes of memory from `addr` onwards into the host-file `file`,
+// replacing its contents.
+extern bool CuSaveMemToFile(const char* restrict file, uint32_t addr,
+  uint32_t nbytes, CuError* restrict err);
+
 #endif  // CUSS_MEMORY_INCLUDED
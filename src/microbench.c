@@ -0,0 +1,368 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "SDL_pixels.h"
+#include "SDL_rect.h"
+#include "SDL_stdinc.h"
+#include "SDL_surface.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "errors.h"
+#include "logger.h"
+#include "memory.h"
+#include "opdec.h"
+#include "ops.h"
+#include "sdlmonio.h"
+#include "sdltxt.h"
+#include "timing.h"
+
+// Microbenchmarks timing the building-blocks of CUSS in isolation, so that a
+// regression can be pinned on a layer instead of showing up only as a drop in
+// the overall simulation-speed.
+
+#define MAX_ARG_VAL_SIZE 256
+
+#define DEF_ITERS 100000U
+#define DEF_REPS 10U
+#define DEF_WARM_UPS 2U
+
+// The base-address of the memory exercised by the memory-benchmarks.
+#define DATA_BASE 0x00080000U
+#define DATA_MASK 0x0000FFFCU
+
+// The (arbitrary) address of instructions executed by the executor-benchmarks.
+#define EXEC_PC 0x00001000U
+
+// The dimensions of the off-screen surface used by the text-benchmarks.
+#define SCR_WIDTH 640
+#define SCR_HEIGHT 480
+
+#define RET_FAIL_ON_ERR(e) \
+  do { \
+      if (!(e)) { \
+          return EXIT_FAILURE; \
+      } \
+  } while (false)
+
+typedef struct BenchOptions {
+    bool info_req;
+    uint32_t iters;
+    uint32_t reps;
+    uint32_t warm_ups;
+    char filter[MAX_ARG_VAL_SIZE];
+} BenchOptions;
+
+typedef bool (*BenchFn)(uint32_t iters, CuError* restrict err);
+
+typedef struct Bench {
+    const char* name;
+    BenchFn fn;
+} Bench;
+
+// Keeps the compiler from optimizing away the results of benchmarked code.
+static volatile uint32_t bench_sink = 0;
+
+static SDL_Surface* screen = NULL;
+
+// A sample of instructions of various formats to execute or to decode.
+static const uint32_t sample_insns[] = {
+    0x00622015U,  // ADDF r3, r2, r4
+    0x004200c7U,  // SLIF r2, r2, 3
+    0x00622018U,  // MULR r3, r2, r4
+    0x0062201aU,  // DIVR r3, r2, r4
+    0x10220010U,  // ADDI r1, r2, 0x0010
+    0x0823ff00U,  // ORRI r1, r3, 0xff00
+    0x343e0040U,  // LDUI r1, 0x0040
+    0x383e0040U,  // LDWD r1, r30, 0x0040
+    0x483e0042U,  // LDBU r1, r30, 0x0042
+    0x4c3e0044U,  // STWD r1, r30, 0x0044
+    0x2c220000U,  // BRNE r1, r2, 0
+    0x14000000U,  // JMPI 0
+    0x001e001eU,  // JMPR r30, r0, 0
+    0x0000001dU,  // WREP r0
+};
+#define NUM_SAMPLE_INSNS (sizeof sample_insns / sizeof sample_insns[0])
+
+static void PrintUsage(const char* restrict prg) {
+    CuLogInfo("Microbenchmarks for the components of CUSS.");
+    CuLogInfo("Usage: %s [options]", prg);
+    CuLogInfo("Options:");
+    CuLogInfo("  -f=<str>, --filter=<str>: Only run benchmarks with names "
+      "containing <str>.");
+    CuLogInfo("  -h, --help: Show this help-message.");
+    CuLogInfo("  -n=<n>, --iterations=<n>: Time <n> operations per "
+      "repetition.");
+    CuLogInfo("  -r=<n>, --repetitions=<n>: Repeat each benchmark <n> times.");
+    CuLogInfo("  -w=<n>, --warm-ups=<n>: Discard the first <n> repetitions.");
+}
+
+static const char* OptVal(const char* restrict arg, const char* restrict sopt,
+  const char* restrict lopt) {
+    const size_t slen = strlen(sopt);
+    const size_t llen = strlen(lopt);
+    if (strncmp(arg, sopt, slen) == 0) {
+        return arg + slen;
+    }
+    if (strncmp(arg, lopt, llen) == 0) {
+        return arg + llen;
+    }
+    return NULL;
+}
+
+static bool ParseCommandLine(int argc, char *argv[],
+  BenchOptions* restrict opts) {
+    opts->info_req = false;
+    opts->iters = DEF_ITERS;
+    opts->reps = DEF_REPS;
+    opts->warm_ups = DEF_WARM_UPS;
+    opts->filter[0] = '\0';
+
+    for (int i = 1; i < argc; i++) {
+        const char* restrict arg = argv[i];
+        const char* val = NULL;
+
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            opts->info_req = true;
+            PrintUsage(argv[0]);
+            return true;
+        }
+        if ((val = OptVal(arg, "-f=", "--filter=")) != NULL) {
+            strncpy(opts->filter, val, MAX_ARG_VAL_SIZE - 1);
+            opts->filter[MAX_ARG_VAL_SIZE - 1] = '\0';
+            continue;
+        }
+        if ((val = OptVal(arg, "-n=", "--iterations=")) != NULL) {
+            opts->iters = (uint32_t)strtoul(val, NULL, 0);
+            continue;
+        }
+        if ((val = OptVal(arg, "-r=", "--repetitions=")) != NULL) {
+            opts->reps = (uint32_t)strtoul(val, NULL, 0);
+            continue;
+        }
+        if ((val = OptVal(arg, "-w=", "--warm-ups=")) != NULL) {
+            opts->warm_ups = (uint32_t)strtoul(val, NULL, 0);
+            continue;
+        }
+
+        CuLogError("Invalid argument '%s'.", arg);
+        PrintUsage(argv[0]);
+        return false;
+    }
+    if (opts->iters == 0) {
+        opts->iters = 1;
+    }
+    if (opts->reps == 0) {
+        opts->reps = 1;
+    }
+    return true;
+}
+
+static bool BenchGetWord(uint32_t iters, CuError* restrict err) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < iters; i++) {
+        uint32_t val;
+        RET_ON_ERR(CuGetWordAt(DATA_BASE + ((i << 2) & DATA_MASK), &val, err));
+        sum += val;
+    }
+    bench_sink = sum;
+    return true;
+}
+
+static bool BenchSetWord(uint32_t iters, CuError* restrict err) {
+    for (uint32_t i = 0; i < iters; i++) {
+        RET_ON_ERR(CuSetWordAt(DATA_BASE + ((i << 2) & DATA_MASK), i, err));
+    }
+    return true;
+}
+
+static bool ExecRepeatedly(uint32_t insn, uint32_t iters,
+  CuError* restrict err) {
+    CuCore* core = CuGetCore(0);
+    for (uint32_t i = 0; i < iters; i++) {
+        core->pc = EXEC_PC;
+        RET_ON_ERR(CuExecOp(core, insn, err));
+    }
+    bench_sink = CuGetProgCtr();
+    return true;
+}
+
+static bool BenchExecAlu(uint32_t iters, CuError* restrict err) {
+    return ExecRepeatedly(0x00622015U, iters, err);  // ADDF r3, r2, r4
+}
+
+static bool BenchExecMul(uint32_t iters, CuError* restrict err) {
+    return ExecRepeatedly(0x00622018U, iters, err);  // MULR r3, r2, r4
+}
+
+static bool BenchExecDiv(uint32_t iters, CuError* restrict err) {
+    return ExecRepeatedly(0x0062201aU, iters, err);  // DIVR r3, r2, r4
+}
+
+static bool BenchExecImm(uint32_t iters, CuError* restrict err) {
+    return ExecRepeatedly(0x10220010U, iters, err);  // ADDI r1, r2, 0x0010
+}
+
+static bool BenchExecLoad(uint32_t iters, CuError* restrict err) {
+    return ExecRepeatedly(0x383e0040U, iters, err);  // LDWD r1, r30, 0x0040
+}
+
+static bool BenchExecStore(uint32_t iters, CuError* restrict err) {
+    return ExecRepeatedly(0x4c3e0044U, iters, err);  // STWD r1, r30, 0x0044
+}
+
+static bool BenchExecBranch(uint32_t iters, CuError* restrict err) {
+    return ExecRepeatedly(0x2c220000U, iters, err);  // BRNE r1, r2, 0
+}
+
+static bool BenchExecJump(uint32_t iters, CuError* restrict err) {
+    return ExecRepeatedly(0x14000000U, iters, err);  // JMPI 0
+}
+
+static bool BenchDecodeOp(uint32_t iters, CuError* restrict err) {
+    (void)err;
+    char buf[64];
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < iters; i++) {
+        CuDecodeOp(sample_insns[i % NUM_SAMPLE_INSNS], buf, sizeof buf);
+        sum += (uint8_t)buf[0];
+    }
+    bench_sink = sum;
+    return true;
+}
+
+static bool BenchMonEmit(uint32_t iters, CuError* restrict err) {
+    for (uint32_t i = 0; i < iters; i++) {
+        RET_ON_ERR(CuSdlMonIoPutMsg(
+          "r01: 0x000cce33  r02: 0x00000009  r03: 0x00000005\n", err));
+    }
+    return true;
+}
+
+static bool BenchTxtRender(uint32_t iters, CuError* restrict err) {
+    static const char line[] = "00000100: 00012038  LDWD r1, r0, 0x100";
+    const SDL_Point pos = {.x = 0, .y = 0};
+    for (uint32_t i = 0; i < iters; i++) {
+        RET_ON_ERR(CuSdlTxtRenderByteSeq(screen, &pos, (const uint8_t*)line,
+          sizeof line - 1, err));
+    }
+    return true;
+}
+
+static const Bench benches[] = {
+    {.name = "mem-get-word", .fn = BenchGetWord},
+    {.name = "mem-set-word", .fn = BenchSetWord},
+    {.name = "exec-alu", .fn = BenchExecAlu},
+    {.name = "exec-mul", .fn = BenchExecMul},
+    {.name = "exec-div", .fn = BenchExecDiv},
+    {.name = "exec-imm", .fn = BenchExecImm},
+    {.name = "exec-load", .fn = BenchExecLoad},
+    {.name = "exec-store", .fn = BenchExecStore},
+    {.name = "exec-branch", .fn = BenchExecBranch},
+    {.name = "exec-jump", .fn = BenchExecJump},
+    {.name = "decode-op", .fn = BenchDecodeOp},
+    {.name = "mon-emit-line", .fn = BenchMonEmit},
+    {.name = "txt-render-line", .fn = BenchTxtRender},
+};
+#define NUM_BENCHES (sizeof benches / sizeof benches[0])
+
+static bool SetUpBenches(CuError* restrict err) {
+    RET_ON_ERR(CuInitCpu(err));
+    RET_ON_ERR(CuSetIntReg(2, 0x00012345U, err));
+    RET_ON_ERR(CuSetIntReg(4, 0x00000007U, err));
+    RET_ON_ERR(CuSetIntReg(30, DATA_BASE, err));
+    RET_ON_ERR(CuSetProgCtr(EXEC_PC, err));
+
+    screen = SDL_CreateRGBSurfaceWithFormat(/*flags=*/0, SCR_WIDTH, SCR_HEIGHT,
+      /*depth=*/32, SDL_PIXELFORMAT_ARGB8888);
+    if (screen == NULL) {
+        return CuErrMsg(err, "Could not create the off-screen surface: %s",
+          SDL_GetError());
+    }
+    RET_ON_ERR(CuSdlTxtSetUp(screen->format, err));
+    const SDL_Color fg_clr = {.r = 0xee, .g = 0xee, .b = 0xee, .a = 0xff};
+    RET_ON_ERR(CuSdlTxtSetColor(&fg_clr, err));
+    RET_ON_ERR(CuSdlMonIoSetUp(SCR_WIDTH, SCR_HEIGHT, /*wake_fn=*/NULL,
+      err));
+    return true;
+}
+
+static bool TearDownBenches(CuError* restrict err) {
+    RET_ON_ERR(CuSdlMonIoTearDown(err));
+    RET_ON_ERR(CuSdlTxtTearDown(err));
+    SDL_FreeSurface(screen);
+    screen = NULL;
+    return true;
+}
+
+// Run a benchmark `opts->warm_ups` times without timing it, then time it
+// `opts->reps` times and report the mean, the standard-deviation, and the
+// minimum of the time taken per operation in nanoseconds.
+static bool RunBench(const Bench* restrict bench,
+  const BenchOptions* restrict opts, CuError* restrict err) {
+    for (uint32_t i = 0; i < opts->warm_ups; i++) {
+        RET_ON_ERR(bench->fn(opts->iters, err));
+    }
+
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    double min = 0.0;
+    for (uint32_t i = 0; i < opts->reps; i++) {
+        const uint64_t t0 = CuTimGetHostNs();
+        RET_ON_ERR(bench->fn(opts->iters, err));
+        const uint64_t t1 = CuTimGetHostNs();
+
+        const double ns_per_op = (double)(t1 - t0) / opts->iters;
+        sum += ns_per_op;
+        sum_sq += ns_per_op * ns_per_op;
+        if (i == 0 || ns_per_op < min) {
+            min = ns_per_op;
+        }
+    }
+    const double mean = sum / opts->reps;
+    const double var = sum_sq / opts->reps - mean * mean;
+    const double std_dev = (var > 0.0) ? SDL_sqrt(var) : 0.0;
+    CuLogInfo("%-16s %10.2f %10.2f %10.2f", bench->name, mean, std_dev, min);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    BenchOptions opts;
+    RET_FAIL_ON_ERR(ParseCommandLine(argc, argv, &opts));
+    if (opts.info_req) {
+        return EXIT_SUCCESS;
+    }
+
+    CuError err;
+    if (!SetUpBenches(&err)) {
+        CuLogError("Could not set up the benchmarks: %s", err.err_msg);
+        return EXIT_FAILURE;
+    }
+
+    CuLogInfo("%" PRIu32 " repetitions (after %" PRIu32 " warm-ups) of %"
+      PRIu32 " operations each:", opts.reps, opts.warm_ups, opts.iters);
+    CuLogInfo("%-16s %10s %10s %10s", "benchmark", "mean-ns", "stddev-ns",
+      "min-ns");
+    bool ok = true;
+    for (size_t i = 0; i < NUM_BENCHES && ok; i++) {
+        if (opts.filter[0] != '\0' &&
+          strstr(benches[i].name, opts.filter) == NULL) {
+            continue;
+        }
+        ok = RunBench(&benches[i], &opts, &err);
+        if (!ok) {
+            CuLogError("Benchmark '%s' failed: %s", benches[i].name,
+              err.err_msg);
+        }
+    }
+
+    if (!TearDownBenches(&err)) {
+        CuLogError("Could not tear down the benchmarks: %s", err.err_msg);
+        return EXIT_FAILURE;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
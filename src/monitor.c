@@ -6,14 +6,39 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "checkpt.h"
+#include "concur.h"
 #include "cpu.h"
+#include "logger.h"
 #include "memory.h"
 #include "opdec.h"
+#include "pipeline.h"
+#include "symtab.h"
+#include "timing.h"
 
 static CuMonGetInpFn inp_fn = NULL;
 static CuMonPutMsgFn out_fn = NULL;
+static bool interactive = true;
+
+// The output of each command is accumulated here and handed to `out_fn` in
+// one go, instead of in the many fragments that make up each line.
+#define OUT_BUF_SIZE 8192
+static char out_buf[OUT_BUF_SIZE];
+static size_t out_len = 0;
+
+// The sequence-number of the last stop of the executor reported to the user.
+static uint32_t last_stop_seq = 0;
+
+// A stop of the executor while the Monitor waits for input is reported right
+// away from the executor's thread. `out_mut` guards `last_stop_seq` and the
+// calls to `out_fn` between the two threads.
+static CuMutex out_mut = NULL;
+static bool awaiting_inp = false;
+
+static void ReportStopAsync(void);
 
 bool CuMonSetUp(CuMonGetInpFn get_fn, CuMonPutMsgFn put_fn,
   CuError* restrict err) {
@@ -25,43 +50,370 @@ bool CuMonSetUp(CuMonGetInpFn get_fn, CuMonPutMsgFn put_fn,
         return CuErrMsg(err, "NULL `put_fn`.");
     }
     out_fn = put_fn;
+    if (out_mut == NULL) {
+        RET_ON_ERR(CuMutCreate(&out_mut, err));
+    }
+    CuSetCpuStopHook(ReportStopAsync);
+    return true;
+}
+
+void CuMonSetInteractive(bool is_interactive) {
+    interactive = is_interactive;
+}
+
+static bool FlushMsgs(CuError* restrict err) {
+    if (out_len == 0) {
+        return true;
+    }
+    out_buf[out_len] = '\0';
+    out_len = 0;
+    return out_fn(out_buf, err);
+}
+
+static bool PutMsg(const char* restrict msg, CuError* restrict err) {
+    const size_t len = strlen(msg);
+    if (out_len + len >= OUT_BUF_SIZE) {
+        RET_ON_ERR(FlushMsgs(err));
+        if (len >= OUT_BUF_SIZE) {
+            return out_fn(msg, err);
+        }
+    }
+    memcpy(out_buf + out_len, msg, len);
+    out_len += len;
+    return true;
+}
+
+static bool PutErr(const CuError* restrict nerr, CuError* restrict err) {
+    RET_ON_ERR(PutMsg("ERROR: ", err));
+    RET_ON_ERR(PutMsg(nerr->err_msg, err));
+    RET_ON_ERR(PutMsg("\n", err));
     return true;
 }
 
 static bool PrintUsage(CuError* restrict err) {
-    RET_ON_ERR(out_fn("Commands:\n", err));
-    RET_ON_ERR(out_fn("  .: Repeat last command.\n", err));
-    RET_ON_ERR(out_fn("  ?, help: Show available commands.\n", err));
-    RET_ON_ERR(out_fn("  dis: Disassemble code.\n", err));
-    RET_ON_ERR(out_fn("  exit, quit: Exit CUSS.\n", err));
-    RET_ON_ERR(out_fn("  reg: Print out register-values.\n", err));
-    RET_ON_ERR(out_fn("  step: Execute the next instruction.\n", err));
+    RET_ON_ERR(PutMsg("Commands:\n", err));
+    RET_ON_ERR(PutMsg("  .: Repeat last command.\n", err));
+    RET_ON_ERR(PutMsg("  ?, help: Show available commands.\n", err));
+    RET_ON_ERR(PutMsg("  break [<addr> [if <cond>]]: Add a break-point at "
+      "<addr> (or list them).\n", err));
+    RET_ON_ERR(PutMsg("  checkpoints: Print out checkpoint statistics.\n",
+      err));
+    RET_ON_ERR(PutMsg("  continue: Run instructions until stopped.\n", err));
+    RET_ON_ERR(PutMsg("  core [<n>]: Select core <n> for 'reg', 'step', etc. "
+      "(or show it).\n", err));
+    RET_ON_ERR(PutMsg("  delete <addr>: Remove the break-point at <addr>.\n",
+      err));
+    RET_ON_ERR(PutMsg("  dis [<addr> [<count>]]: Disassemble <count> "
+      "instructions at <addr>.\n", err));
+    RET_ON_ERR(PutMsg("  exit, quit: Exit CUSS.\n", err));
+    RET_ON_ERR(PutMsg("  find <addr> <len> <val> [b|h|w]: Find <val> in "
+      "<len> bytes at <addr>.\n", err));
+    RET_ON_ERR(PutMsg("  load <file> <addr>: Load the host-file <file> at "
+      "<addr>.\n", err));
+    RET_ON_ERR(PutMsg("  mem <addr> <len> [b|h|w]: Dump <len> bytes at "
+      "<addr>.\n", err));
+    RET_ON_ERR(PutMsg("  pause: Stop running instructions.\n", err));
+    RET_ON_ERR(PutMsg("  pipe: Print out pipeline-model statistics.\n", err));
+    RET_ON_ERR(PutMsg("  reg: Print out register-values.\n", err));
+    RET_ON_ERR(PutMsg("  reverse-continue: Go back to the previous stop at a "
+      "break-point or a\n    watch-point.\n", err));
+    RET_ON_ERR(PutMsg("  reverse-step [<n>]: Go back by <n> (default 1) "
+      "instructions.\n", err));
+    RET_ON_ERR(PutMsg("  run <n>: Run the next <n> instructions.\n", err));
+    RET_ON_ERR(PutMsg("  stats: Print out simulated-timing statistics.\n",
+      err));
+    RET_ON_ERR(PutMsg("  save <file> <addr> <len>: Save <len> bytes at "
+      "<addr> to the host-file <file>.\n", err));
+    RET_ON_ERR(PutMsg("  step: Execute the next instruction.\n", err));
+    RET_ON_ERR(PutMsg("  unwatch <addr>: Remove the watch-point at <addr>.\n",
+      err));
+    RET_ON_ERR(PutMsg("  until <addr>: Run instructions until reaching "
+      "<addr>.\n", err));
+    RET_ON_ERR(PutMsg("  watch <addr> [b|h|w] [if <cond>]: Stop after stores "
+      "to <addr>.\n", err));
+    RET_ON_ERR(PutMsg("    (<cond> uses r0-r31, pc, psr, ep, hits, val, old, "
+      "numbers, ( ), !, &,\n", err));
+    RET_ON_ERR(PutMsg("    ==, !=, <, <=, >, >=, &&, and ||.)\n", err));
+    RET_ON_ERR(PutMsg("  (<addr> may also be the name of a symbol, see "
+      "'--symbols'.)\n", err));
     return true;
 }
 
-static bool Disassemble(CuError* restrict err) {
-    const uint32_t pc = CuGetProgCtr();
+static const char hex_digits[] = "0123456789abcdef";
+
+static inline char* PutHex(char* p, uint32_t val, int num_digits) {
+    for (int i = num_digits - 1; i >= 0; i--) {
+        *p++ = hex_digits[(val >> (4 * i)) & 0xFU];
+    }
+    return p;
+}
+
+// Read a value of `unit` (1, 2, or 4) little-endian bytes.
+static inline uint32_t LeBytesToUnit(const uint8_t* bytes, uint32_t unit) {
+    uint32_t val = 0;
+    for (uint32_t i = 0; i < unit; i++) {
+        val |= (uint32_t)bytes[i] << (8U * i);
+    }
+    return val;
+}
 
+// Parse a unit of memory-access ("b", "h", or "w") into its size in bytes.
+static bool ParseUnit(const char* restrict str, uint32_t* restrict unit) {
+    if (strcmp(str, "b") == 0) {
+        *unit = 1U;
+    } else if (strcmp(str, "h") == 0) {
+        *unit = 2U;
+    } else if (strcmp(str, "w") == 0) {
+        *unit = 4U;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Check that `addr` is a valid memory-address aligned to `unit` and clamp
+// `len` bytes from `addr` onwards to the end of memory.
+static bool IsValidMemRange(uint32_t addr, uint32_t unit,
+  uint32_t* restrict len) {
+    const uint32_t mem_size = CuGetMemSize();
+    if (addr >= mem_size || (addr & (unit - 1U)) != 0) {
+        return false;
+    }
+    if (*len > mem_size - addr) {
+        *len = mem_size - addr;
+    }
+    *len = (*len + unit - 1U) & ~(unit - 1U);
+    return true;
+}
+
+// Memory is read in chunks of this many bytes to limit calls to `out_fn`.
+#define MEM_CHUNK_SIZE 4096U
+
+// Print out a hex-dump of `len` bytes of memory from `addr` onwards as values
+// of `unit` bytes each.
+static bool DumpMemory(uint32_t addr, uint32_t len, uint32_t unit,
+  CuError* restrict err) {
+    if (!IsValidMemRange(addr, unit, &len)) {
+        RET_ON_ERR(PutMsg("ERROR: Invalid address.\n", err));
+        return true;
+    }
+
+    // Each line shows the address, the values, and the bytes as text.
+#define DUMP_LINE_BYTES 16U
+#define DUMP_LINE_SIZE (12 + 3 * DUMP_LINE_BYTES + 2 + DUMP_LINE_BYTES + 1)
+    static uint8_t bytes[MEM_CHUNK_SIZE];
+    static char txt_buf[MEM_CHUNK_SIZE / DUMP_LINE_BYTES * DUMP_LINE_SIZE + 1];
     CuError nerr;
-    uint32_t insn;
-    if (!CuGetWordAt(pc, &insn, &nerr)) {
-        return CuErrMsg(err, "Error reading instruction: %s", nerr.err_msg);
+    while (len > 0) {
+        const uint32_t n = (len < MEM_CHUNK_SIZE) ? len : MEM_CHUNK_SIZE;
+        if (!CuReadMemRange(addr, n, bytes, &nerr)) {
+            return CuErrMsg(err, "Error reading memory: %s", nerr.err_msg);
+        }
+        char* p = txt_buf;
+        for (uint32_t off = 0; off < n; off += DUMP_LINE_BYTES) {
+            const uint32_t line_n = (n - off < DUMP_LINE_BYTES) ? n - off :
+              DUMP_LINE_BYTES;
+            *p++ = ' ';
+            *p++ = ' ';
+            p = PutHex(p, addr + off, 8);
+            *p++ = ':';
+            for (uint32_t i = 0; i < line_n; i += unit) {
+                *p++ = ' ';
+                p = PutHex(p, LeBytesToUnit(bytes + off + i, unit),
+                  2 * (int)unit);
+            }
+            if (unit == 1U) {
+                for (uint32_t i = line_n; i < DUMP_LINE_BYTES; i++) {
+                    *p++ = ' ';
+                    *p++ = ' ';
+                    *p++ = ' ';
+                }
+                *p++ = ' ';
+                *p++ = ' ';
+                for (uint32_t i = 0; i < line_n; i++) {
+                    const uint8_t c = bytes[off + i];
+                    *p++ = (c >= 0x20 && c < 0x7f) ? (char)c : '.';
+                }
+            }
+            *p++ = '\n';
+        }
+        *p = '\0';
+        RET_ON_ERR(PutMsg(txt_buf, err));
+        addr += n;
+        len -= n;
     }
+#undef DUMP_LINE_SIZE
+#undef DUMP_LINE_BYTES
+    return true;
+}
 
-#define INSN_BUF_SIZE 64
-    char insn_buf[INSN_BUF_SIZE];
-    CuDecodeOp(insn, insn_buf, INSN_BUF_SIZE);
-#undef INSN_BUF_SIZE
+// Print out the addresses within `len` bytes of memory from `addr` onwards
+// that hold the value `val` of `unit` bytes.
+static bool FindInMemory(uint32_t addr, uint32_t len, uint32_t val,
+  uint32_t unit, CuError* restrict err) {
+    if (!IsValidMemRange(addr, unit, &len)) {
+        RET_ON_ERR(PutMsg("ERROR: Invalid address.\n", err));
+        return true;
+    }
+    if (unit < 4U && val >= (1U << (8U * unit))) {
+        RET_ON_ERR(PutMsg("ERROR: Value too large for the unit.\n", err));
+        return true;
+    }
 
+    // Only the first few matches are printed out.
+#define MAX_SHOWN_MATCHES 32U
 #define MSG_BUF_SIZE 128
     char msg_buf[MSG_BUF_SIZE];
-    snprintf(msg_buf, MSG_BUF_SIZE, "  %08" PRIx32 ": %s\n", pc, insn_buf);
+    static uint8_t bytes[MEM_CHUNK_SIZE];
+    uint32_t num_matches = 0;
+    CuError nerr;
+    while (len > 0) {
+        const uint32_t n = (len < MEM_CHUNK_SIZE) ? len : MEM_CHUNK_SIZE;
+        if (!CuReadMemRange(addr, n, bytes, &nerr)) {
+            return CuErrMsg(err, "Error reading memory: %s", nerr.err_msg);
+        }
+        for (uint32_t i = 0; i < n; i += unit) {
+            if (LeBytesToUnit(bytes + i, unit) != val) {
+                continue;
+            }
+            if (num_matches < MAX_SHOWN_MATCHES) {
+                snprintf(msg_buf, MSG_BUF_SIZE, "  %08" PRIx32 "\n", addr + i);
+                RET_ON_ERR(PutMsg(msg_buf, err));
+            }
+            num_matches++;
+        }
+        addr += n;
+        len -= n;
+    }
+    if (num_matches > MAX_SHOWN_MATCHES) {
+        snprintf(msg_buf, MSG_BUF_SIZE, "Found %" PRIu32 " matches, showing "
+          "the first %" PRIu32 ".\n", num_matches, MAX_SHOWN_MATCHES);
+    } else {
+        snprintf(msg_buf, MSG_BUF_SIZE, "Found %" PRIu32 " match(es).\n",
+          num_matches);
+    }
+    RET_ON_ERR(PutMsg(msg_buf, err));
 #undef MSG_BUF_SIZE
+#undef MAX_SHOWN_MATCHES
+    return true;
+}
+
+// Put " <name+0x<offset>>" for `addr` into `buf`, or nothing if there is no
+// symbol for `addr`, returning `buf`.
+static const char* SymSuffix(uint32_t addr, char* restrict buf, size_t size) {
+    buf[0] = '\0';
+    if (size < 4) {
+        return buf;
+    }
+    buf[0] = ' ';
+    buf[1] = '<';
+    size_t len = CuPutSymAddr(addr, buf + 2, size - 3);
+    if (len == 0) {
+        buf[0] = '\0';
+        return buf;
+    }
+    buf[2 + len] = '>';
+    buf[3 + len] = '\0';
+    return buf;
+}
+
+static bool PutSymLabel(uint32_t addr, CuError* restrict err) {
+    char label[CU_SYM_MAX_NAME + 16];
+    const size_t len = CuPutSymAddr(addr, label, sizeof label - 2);
+    label[len] = ':';
+    label[len + 1] = '\n';
+    label[len + 2] = '\0';
+    return PutMsg(label, err);
+}
 
-    RET_ON_ERR(out_fn(msg_buf, err));
+// Disassembly is decoded in chunks of instructions to limit calls to
+// `out_fn`, with a batch of chunks decoded at once on the host thread-pool.
+#define DIS_CHUNK_INSNS 256
+#define DIS_BATCH_CHUNKS 16
+
+typedef struct DisChunk {
+    uint32_t addr;
+    uint32_t n;
+    // Whether the chunk starts with a label for its symbol.
+    bool label;
+    uint32_t insns[DIS_CHUNK_INSNS];
+    char txt_buf[DIS_CHUNK_INSNS * CU_OPDEC_LINE_SIZE + 1];
+} DisChunk;
+
+static DisChunk dis_chunks[DIS_BATCH_CHUNKS];
+
+static bool DecodeDisChunks(void* data, size_t begin, size_t end,
+  CuError* restrict err) {
+    (void)data;  // Suppress unused parameter warning.
+    (void)err;  // Suppress unused parameter warning.
+    for (size_t i = begin; i < end; i++) {
+        DisChunk* c = &dis_chunks[i];
+        size_t len;
+        CuDecodeOps(c->addr, c->insns, c->n, c->txt_buf, sizeof c->txt_buf,
+          &len);
+    }
+    return true;
+}
+
+// Disassemble `count` instructions from the memory-address `addr` onwards.
+static bool Disassemble(uint32_t addr, uint32_t count, CuError* restrict err) {
+    const uint32_t mem_size = CuGetMemSize();
+    if (addr >= mem_size || (addr & 0x3U) != 0) {
+        RET_ON_ERR(PutMsg("ERROR: Invalid address.\n", err));
+        return true;
+    }
+    if (count > (mem_size - addr) / 4U) {
+        count = (mem_size - addr) / 4U;
+    }
+
+    uint8_t bytes[4 * DIS_CHUNK_INSNS];
+    CuError nerr;
+    bool first = true;
+    while (count > 0) {
+        size_t num_chunks = 0;
+        while (count > 0 && num_chunks < DIS_BATCH_CHUNKS) {
+            DisChunk* c = &dis_chunks[num_chunks++];
+            uint32_t n = (count < DIS_CHUNK_INSNS) ? count : DIS_CHUNK_INSNS;
+
+            // Label the instructions at the start of every symbol (or at the
+            // start of the disassembly) and break the chunk at the next
+            // symbol.
+            uint32_t sym_addr;
+            c->label = CuFindSymbol(addr, &sym_addr) != NULL &&
+              (first || sym_addr == addr);
+            first = false;
+            uint32_t next_addr;
+            if (CuGetNextSymAddr(addr, &next_addr) &&
+              (next_addr - addr + 3U) / 4U < n) {
+                n = (next_addr - addr + 3U) / 4U;
+            }
+            if (!CuReadMemRange(addr, 4U * n, bytes, &nerr)) {
+                return CuErrMsg(err, "Error reading instructions: %s",
+                  nerr.err_msg);
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                c->insns[i] = LeBytesToUnit(bytes + 4U * i, 4U);
+            }
+            c->addr = addr;
+            c->n = n;
+            addr += 4U * n;
+            count -= n;
+        }
+        RET_ON_ERR(CuPoolParallelFor(CuGetHostPool(), 0, num_chunks, 1U,
+          DecodeDisChunks, NULL, err));
+        for (size_t i = 0; i < num_chunks; i++) {
+            if (dis_chunks[i].label) {
+                RET_ON_ERR(PutSymLabel(dis_chunks[i].addr, err));
+            }
+            RET_ON_ERR(PutMsg(dis_chunks[i].txt_buf, err));
+        }
+    }
     return true;
 }
 
+#undef DIS_BATCH_CHUNKS
+#undef DIS_CHUNK_INSNS
+
 static bool PrintRegisters(CuError* restrict err) {
     CuError nerr;
 #define MSG_BUF_SIZE 128
@@ -71,11 +423,11 @@ static bool PrintRegisters(CuError* restrict err) {
 #define REGS_PER_LINE 8
         if (i % REGS_PER_LINE == 0) {
             if (i != 0) {
-                RET_ON_ERR(out_fn("\n", err));
+                RET_ON_ERR(PutMsg("\n", err));
             }
             snprintf(msg_buf, MSG_BUF_SIZE, "r%02d-r%02d:", i,
               i + REGS_PER_LINE - 1);
-            RET_ON_ERR(out_fn(msg_buf, err));
+            RET_ON_ERR(PutMsg(msg_buf, err));
         }
 #undef REGS_PER_LINE
 
@@ -85,14 +437,379 @@ static bool PrintRegisters(CuError* restrict err) {
               nerr.err_msg);
         }
         snprintf(msg_buf, MSG_BUF_SIZE, " %08" PRIx32, rval);
-        RET_ON_ERR(out_fn(msg_buf, err));
+        RET_ON_ERR(PutMsg(msg_buf, err));
+    }
+#undef MSG_BUF_SIZE
+    RET_ON_ERR(PutMsg("\n", err));
+
+    return true;
+}
+
+static bool PrintTimingStats(CuError* restrict err) {
+    CuTimingStats stats;
+    CuGetCpuTimingStats(&stats);
+
+    const double cpi = (stats.insns == 0) ? 0.0 :
+      (double)stats.cycles / (double)stats.insns;
+    const double sim_us = (double)stats.cycles * 1000000.0 /
+      (double)stats.clock_hz;
+    const double host_us = (double)stats.host_ns / 1000.0;
+    const double ratio = (host_us == 0.0) ? 0.0 : sim_us / host_us;
+
+#define MSG_BUF_SIZE 128
+    char msg_buf[MSG_BUF_SIZE];
+    snprintf(msg_buf, MSG_BUF_SIZE, "Instructions: %" PRIu64 ", cycles: %"
+      PRIu64 " (CPI=%0.3f).\n", stats.insns, stats.cycles, cpi);
+    RET_ON_ERR(PutMsg(msg_buf, err));
+    snprintf(msg_buf, MSG_BUF_SIZE, "Simulated time: %0.3f us at %0.1f MHz.\n",
+      sim_us, (double)stats.clock_hz / 1000000.0);
+    RET_ON_ERR(PutMsg(msg_buf, err));
+    snprintf(msg_buf, MSG_BUF_SIZE,
+      "Host time: %0.3f us (simulated/host=%0.4f).\n", host_us, ratio);
+    RET_ON_ERR(PutMsg(msg_buf, err));
+#undef MSG_BUF_SIZE
+
+    return true;
+}
+
+static bool PrintPipelineStats(CuError* restrict err) {
+    if (!CuIsPipelineModelEnabled()) {
+        RET_ON_ERR(PutMsg("Pipeline-model not enabled (see '--pipeline').\n",
+          err));
+        return true;
+    }
+    CuPipeStats stats;
+    CuPipeGetStats(&stats);
+
+    const double cpi = (stats.insns == 0) ? 0.0 :
+      (double)stats.cycles / (double)stats.insns;
+
+#define MSG_BUF_SIZE 128
+    char msg_buf[MSG_BUF_SIZE];
+    snprintf(msg_buf, MSG_BUF_SIZE, "Instructions: %" PRIu64 ", cycles: %"
+      PRIu64 " (CPI=%0.3f).\n", stats.insns, stats.cycles, cpi);
+    RET_ON_ERR(PutMsg(msg_buf, err));
+    for (int i = 0; i < CU_PIPE_NUM_STALL_REASONS; i++) {
+        snprintf(msg_buf, MSG_BUF_SIZE, "  %-14s %" PRIu64 " stall-cycles\n",
+          CuPipeStallReasonName(i), stats.stalls[i]);
+        RET_ON_ERR(PutMsg(msg_buf, err));
+    }
+#undef MSG_BUF_SIZE
+
+    return true;
+}
+
+// Transfer data between a host-file and memory, but only while the executor
+// is not running.
+static bool TransferMem(bool save, const char* restrict file, uint32_t addr,
+  uint32_t len, CuError* restrict err) {
+    if (CuGetCpuState() == CU_CPU_RUNNING) {
+        RET_ON_ERR(PutMsg("ERROR: Executor is running (see 'pause').\n", err));
+        return true;
+    }
+    CuError nerr;
+    const bool ok = save ? CuSaveMemToFile(file, addr, len, &nerr) :
+      CuLoadMemFromFile(file, addr, &len, &nerr);
+    if (!ok) {
+        RET_ON_ERR(PutErr(&nerr, err));
+        return true;
+    }
+#define MSG_BUF_SIZE 128
+    char msg_buf[MSG_BUF_SIZE];
+    snprintf(msg_buf, MSG_BUF_SIZE, "%s %" PRIu32 " bytes at %08" PRIx32 ".\n",
+      save ? "Saved" : "Loaded", len, addr);
+#undef MSG_BUF_SIZE
+    RET_ON_ERR(PutMsg(msg_buf, err));
+    return true;
+}
+
+// Split `inp` at " if " into the command, copied into `cmd`, and the
+// condition, if any, which is returned.
+static const char* SplitCond(const char* restrict inp, char* restrict cmd,
+  size_t cmd_size) {
+    const char* cond = strstr(inp, " if ");
+    size_t len = (cond == NULL) ? strlen(inp) : (size_t)(cond - inp);
+    if (len >= cmd_size) {
+        len = cmd_size - 1;
+    }
+    memcpy(cmd, inp, len);
+    cmd[len] = '\0';
+    return (cond == NULL) ? NULL : cond + 4;
+}
+
+static bool PrintPoint(const char* restrict kind, const CuPointInfo* info,
+  CuError* restrict err) {
+    static const char* unit_names[] = {"", "b", "h", "", "w"};
+    char sym_buf[CU_SYM_MAX_NAME + 16];
+#define MSG_BUF_SIZE 192
+    char msg_buf[MSG_BUF_SIZE];
+    snprintf(msg_buf, MSG_BUF_SIZE, "  %s %08" PRIx32 "%s%s%s (hits=%" PRIu64
+      ")", kind, info->addr, SymSuffix(info->addr, sym_buf, sizeof sym_buf),
+      (info->size == 0) ? "" : " ", unit_names[info->size], info->hits);
+#undef MSG_BUF_SIZE
+    RET_ON_ERR(PutMsg(msg_buf, err));
+    if (info->cond[0] != '\0') {
+        RET_ON_ERR(PutMsg(" if ", err));
+        RET_ON_ERR(PutMsg(info->cond, err));
+    }
+    RET_ON_ERR(PutMsg("\n", err));
+    return true;
+}
+
+static bool PrintPoints(CuError* restrict err) {
+    CuPointInfo bps[CU_MAX_BREAK_POINTS];
+    CuPointInfo wps[CU_MAX_WATCH_POINTS];
+    const int num_bps = CuListBreakPoints(bps);
+    const int num_wps = CuListWatchPoints(wps);
+    if (num_bps == 0 && num_wps == 0) {
+        RET_ON_ERR(PutMsg("No break-points or watch-points.\n", err));
+        return true;
+    }
+    for (int i = 0; i < num_bps; i++) {
+        RET_ON_ERR(PrintPoint("break", &bps[i], err));
+    }
+    for (int i = 0; i < num_wps; i++) {
+        RET_ON_ERR(PrintPoint("watch", &wps[i], err));
     }
+    return true;
+}
+
+typedef enum {
+    POINT_ADD_BREAK,
+    POINT_REMOVE_BREAK,
+    POINT_ADD_WATCH,
+    POINT_REMOVE_WATCH,
+} PointChange;
+
+// Add or remove a break-point or a watch-point of `size` bytes with the
+// condition `cond`, but only while the executor is not running.
+static bool ChangePoints(PointChange change, uint32_t addr, uint32_t size,
+  const char* restrict cond, CuError* restrict err) {
+    if (CuGetCpuState() == CU_CPU_RUNNING) {
+        RET_ON_ERR(PutMsg("ERROR: Executor is running (see 'pause').\n", err));
+        return true;
+    }
+    CuError nerr;
+    bool ok = false;
+    switch (change) {
+      case POINT_ADD_BREAK:
+        ok = CuAddCondBreakPoint(addr, cond, &nerr);
+        break;
+
+      case POINT_REMOVE_BREAK:
+        ok = CuRemoveBreakPoint(addr, &nerr);
+        break;
+
+      case POINT_ADD_WATCH:
+        ok = CuAddWatchPoint(addr, size, cond, &nerr);
+        break;
+
+      case POINT_REMOVE_WATCH:
+        ok = CuRemoveWatchPoint(addr, &nerr);
+        break;
+    }
+    if (!ok) {
+        RET_ON_ERR(PutErr(&nerr, err));
+    }
+    return true;
+}
+
+// Parse an unsigned number in decimal, octal, or hexadecimal notation.
+static bool ParseNum(const char* restrict str, uint64_t* restrict val) {
+    char* end = NULL;
+    *val = strtoull(str, &end, 0);
+    return end != str && *end == '\0';
+}
+
+// Parse a memory-address given as a number or as the name of a symbol.
+static bool ParseAddr(const char* restrict str, uint64_t* restrict addr) {
+    uint32_t sym_addr;
+    if (ParseNum(str, addr)) {
+        return true;
+    }
+    if (!CuLookUpSymbol(str, &sym_addr)) {
+        return false;
+    }
+    *addr = sym_addr;
+    return true;
+}
+
+// Describe in `msg_buf` the last stop of the executor, unless it has already
+// been reported. This must be called with `out_mut` held.
+static bool DescribeNewStop(char* restrict msg_buf, size_t size) {
+    CuCpuStopInfo info;
+    CuGetCpuStopInfo(&info);
+    if (info.seq == last_stop_seq) {
+        return false;
+    }
+    last_stop_seq = info.seq;
+
+    const double host_ms = (double)info.host_ns / 1000000.0;
+    const double mips = (info.host_ns == 0) ? 0.0 :
+      (double)info.insns * 1000.0 / (double)info.host_ns;
+
+    char sym_buf[CU_SYM_MAX_NAME + 16];
+    char core_buf[32] = "";
+    if (CuGetNumCores() > 1) {
+        snprintf(core_buf, sizeof core_buf, " on core %d", info.core);
+    }
+    snprintf(msg_buf, size, "Stopped (%s) at %08" PRIx32 "%s%s after %"
+      PRIu64 " instructions in %0.3f ms (%0.2f MIPS).\n",
+      CuCpuStopReasonName(info.reason), info.pc,
+      SymSuffix(info.pc, sym_buf, sizeof sym_buf), core_buf, info.insns,
+      host_ms, mips);
+    return true;
+}
+
+#define STOP_MSG_BUF_SIZE 192
+
+// Report the last stop of the executor if it has not been reported yet.
+static bool ReportStop(CuError* restrict err) {
+    char msg_buf[STOP_MSG_BUF_SIZE];
+    if (DescribeNewStop(msg_buf, sizeof msg_buf)) {
+        RET_ON_ERR(PutMsg(msg_buf, err));
+    }
+    return true;
+}
+
+// Called by the executor every time it stops. While the Monitor waits for
+// input, the stop is reported at once, followed by a fresh prompt; otherwise
+// it is left for the Monitor to report before its next prompt.
+static void ReportStopAsync(void) {
+    CuError err;
+    if (!CuMutLock(&out_mut, &err)) {
+        CuLogWarn("Could not report the stop: %s", err.err_msg);
+        return;
+    }
+    // The leading new-line moves past any partly-entered input.
+    char msg_buf[STOP_MSG_BUF_SIZE + 16] = "\n";
+    if (awaiting_inp && DescribeNewStop(msg_buf + 1, STOP_MSG_BUF_SIZE)) {
+        if (interactive) {
+            strcat(msg_buf, "CUSS > ");
+        }
+        if (!out_fn(msg_buf, &err)) {
+            CuLogWarn("Could not report the stop: %s", err.err_msg);
+        }
+    }
+    if (!CuMutUnlock(&out_mut, &err)) {
+        CuLogWarn("Could not report the stop: %s", err.err_msg);
+    }
+}
+
+#undef STOP_MSG_BUF_SIZE
+
+// Report any stop of the executor not reported yet, prompt the user and hand
+// over the output so far, after which a stop is reported by the executor.
+static bool ShowPrompt(CuError* restrict err) {
+    RET_ON_ERR(CuMutLock(&out_mut, err));
+    CuError nerr;
+    if (!ReportStop(err) || (interactive && !PutMsg("CUSS > ", err)) ||
+      !FlushMsgs(err)) {
+        CuMutUnlock(&out_mut, &nerr);
+        return false;
+    }
+    awaiting_inp = true;
+    return CuMutUnlock(&out_mut, err);
+}
+
+// Stop reporting the stops of the executor as they happen.
+static bool EndPrompt(CuError* restrict err) {
+    RET_ON_ERR(CuMutLock(&out_mut, err));
+    awaiting_inp = false;
+    return CuMutUnlock(&out_mut, err);
+}
+
+// Select the core named in `arg` for inspection (or show the selected one).
+static bool SelectCore(const char* restrict arg, CuError* restrict err) {
+    uint64_t n;
+    if (arg[0] == '\0') {
+#define MSG_BUF_SIZE 64
+        char msg_buf[MSG_BUF_SIZE];
+        snprintf(msg_buf, MSG_BUF_SIZE, "Core %d of %d.\n",
+          CuGetSelectedCore(), CuGetNumCores());
 #undef MSG_BUF_SIZE
-    RET_ON_ERR(out_fn("\n", err));
+        RET_ON_ERR(PutMsg(msg_buf, err));
+        return true;
+    }
+    if (!ParseNum(arg + 1, &n) || n >= (uint64_t)CuGetNumCores()) {
+        RET_ON_ERR(PutMsg("ERROR: Invalid core-number.\n", err));
+        return true;
+    }
+    CuError nerr;
+    if (!CuSelectCore((int)n, &nerr)) {
+        RET_ON_ERR(PutErr(&nerr, err));
+    }
+    return true;
+}
+
+// Hand control to the executor to run instructions at full speed. This does
+// not wait for the executor to stop, which is reported as soon as it happens
+// if the Monitor is then waiting for input, or else before the next prompt.
+static bool RunCpu(uint64_t max_insns, uint32_t until_addr,
+  CuError* restrict err) {
+    CuError nerr;
+    if (!CuRunCpu(max_insns, until_addr, &nerr)) {
+        RET_ON_ERR(PutErr(&nerr, err));
+        return true;
+    }
+    RET_ON_ERR(PutMsg("Running...\n", err));
+    if (!interactive) {
+        RET_ON_ERR(CuWaitCpuStopped(err));
+    }
+    return true;
+}
+
+static bool PrintCkptStats(CuError* restrict err) {
+    CuCkptStats stats;
+    CuCkptGetStats(&stats);
+    if (stats.num_ckpts == 0) {
+        RET_ON_ERR(PutMsg("Checkpoints not enabled (see "
+          "'--checkpoint-interval').\n", err));
+        return true;
+    }
 
+#define MSG_BUF_SIZE 128
+    char msg_buf[MSG_BUF_SIZE];
+    snprintf(msg_buf, MSG_BUF_SIZE, "Checkpoints: %d using %0.2f MiB, from %"
+      PRIu64 " to %" PRIu64 " instructions.\n", stats.num_ckpts,
+      (double)stats.num_bytes / (1024.0 * 1024.0), stats.oldest_insns,
+      stats.latest_insns);
+    RET_ON_ERR(PutMsg(msg_buf, err));
+    snprintf(msg_buf, MSG_BUF_SIZE, "Now at %" PRIu64 " instructions.\n",
+      CuGetCpuInsnCount());
+#undef MSG_BUF_SIZE
+    RET_ON_ERR(PutMsg(msg_buf, err));
     return true;
 }
 
+// Reverse the execution by `n` instructions, or to the previous stop if `n`
+// is zero.
+static bool ReverseCpu(uint64_t n, CuError* restrict err) {
+    if (CuGetCpuState() == CU_CPU_RUNNING) {
+        RET_ON_ERR(PutMsg("ERROR: Executor is running (see 'pause').\n", err));
+        return true;
+    }
+    CuError nerr;
+    bool found = true;
+    const bool rev_ok = (n == 0) ? CuReverseContinue(&found, &nerr) :
+      CuReverseStep(n, &nerr);
+    if (!rev_ok) {
+        RET_ON_ERR(PutErr(&nerr, err));
+        return true;
+    }
+
+    char sym_buf[CU_SYM_MAX_NAME + 16];
+    const uint32_t pc = CuGetProgCtr();
+#define MSG_BUF_SIZE 192
+    char msg_buf[MSG_BUF_SIZE];
+    snprintf(msg_buf, MSG_BUF_SIZE, "%sAt %08" PRIx32 "%s after %" PRIu64
+      " instructions.\n", found ? "" : "No earlier stop. ", pc,
+      SymSuffix(pc, sym_buf, sizeof sym_buf), CuGetCpuInsnCount());
+#undef MSG_BUF_SIZE
+    RET_ON_ERR(PutMsg(msg_buf, err));
+    return Disassemble(pc, 1, err);
+}
+
 bool CuRunMon(bool* restrict quit, CuError* restrict err) {
     if (inp_fn == NULL || out_fn == NULL) {
         return CuErrMsg(err, "Monitor not initialized.");
@@ -100,8 +817,11 @@ bool CuRunMon(bool* restrict quit, CuError* restrict err) {
     if (quit == NULL) {
         return CuErrMsg(err, "NULL `quit`.");
     }
-    RET_ON_ERR(out_fn("                *** CUSS Monitor ***\n", err));
-    RET_ON_ERR(out_fn("(Enter 'help' to see the available commands.)\n", err));
+    if (interactive) {
+        RET_ON_ERR(PutMsg("                *** CUSS Monitor ***\n", err));
+        RET_ON_ERR(PutMsg("(Enter 'help' to see the available commands.)\n",
+          err));
+    }
 
     *quit = false;
 #define MAX_USER_INPUT_SIZE 128
@@ -119,12 +839,16 @@ bool CuRunMon(bool* restrict quit, CuError* restrict err) {
             if (inp[0] != '.') {
                 strncpy(prev_cmd, inp, MAX_USER_INPUT_SIZE);
             }
-            RET_ON_ERR(out_fn("CUSS > ", err));
+            RET_ON_ERR(ShowPrompt(err));
             RET_ON_ERR(inp_fn(inp, MAX_USER_INPUT_SIZE, &eof, err));
+            RET_ON_ERR(EndPrompt(err));
         }
 #undef MAX_USER_INPUT_SIZE
         if (eof) {
-            RET_ON_ERR(out_fn("\n-*- EOF -*-\n", err));
+            if (interactive) {
+                RET_ON_ERR(PutMsg("\n-*- EOF -*-\n", err));
+            }
+            RET_ON_ERR(FlushMsgs(err));
             *quit = true;
             RET_ON_ERR(CuSetCpuState(CU_CPU_QUITTING, err));
             return true;
@@ -132,11 +856,11 @@ bool CuRunMon(bool* restrict quit, CuError* restrict err) {
 
         if (strcmp(inp, ".") == 0) {
             if (prev_cmd[0] == '\0') {
-                RET_ON_ERR(out_fn("ERROR: No previous command.\n", err));
+                RET_ON_ERR(PutMsg("ERROR: No previous command.\n", err));
             } else {
-                RET_ON_ERR(out_fn(">>> ", err));
-                RET_ON_ERR(out_fn(prev_cmd, err));
-                RET_ON_ERR(out_fn("\n", err));
+                RET_ON_ERR(PutMsg(">>> ", err));
+                RET_ON_ERR(PutMsg(prev_cmd, err));
+                RET_ON_ERR(PutMsg("\n", err));
                 rep_cmd = true;
             }
             continue;
@@ -145,28 +869,239 @@ bool CuRunMon(bool* restrict quit, CuError* restrict err) {
             RET_ON_ERR(PrintUsage(err));
             continue;
         }
-        if (strcmp(inp, "dis") == 0) {
-            RET_ON_ERR(Disassemble(err));
+        if (strcmp(inp, "break") == 0) {
+            RET_ON_ERR(PrintPoints(err));
+            continue;
+        }
+        if (strncmp(inp, "break ", 6) == 0) {
+            char cmd[128];
+            const char* cond = SplitCond(inp, cmd, sizeof cmd);
+            char addr_arg[32];
+            char extra_arg[2];
+            uint64_t addr;
+            if (sscanf(cmd, "break %31s %1s", addr_arg, extra_arg) != 1 ||
+              !ParseAddr(addr_arg, &addr) || addr > UINT32_MAX) {
+                RET_ON_ERR(PutMsg("ERROR: Usage: break <addr> [if <cond>]\n",
+                  err));
+                continue;
+            }
+            RET_ON_ERR(ChangePoints(POINT_ADD_BREAK, (uint32_t)addr, 0, cond,
+              err));
+            continue;
+        }
+        if (strcmp(inp, "checkpoints") == 0) {
+            RET_ON_ERR(PrintCkptStats(err));
+            continue;
+        }
+        if (strcmp(inp, "continue") == 0) {
+            RET_ON_ERR(RunCpu(CU_CPU_RUN_NO_LIMIT, CU_CPU_RUN_NO_UNTIL, err));
+            continue;
+        }
+        if (strcmp(inp, "core") == 0 || strncmp(inp, "core ", 5) == 0) {
+            RET_ON_ERR(SelectCore(inp + 4, err));
+            continue;
+        }
+        if (strncmp(inp, "delete ", 7) == 0) {
+            uint64_t addr;
+            if (!ParseAddr(inp + 7, &addr) || addr > UINT32_MAX) {
+                RET_ON_ERR(PutMsg("ERROR: Invalid address.\n", err));
+                continue;
+            }
+            RET_ON_ERR(ChangePoints(POINT_REMOVE_BREAK, (uint32_t)addr, 0,
+              NULL, err));
+            continue;
+        }
+        if (strcmp(inp, "dis") == 0 || strncmp(inp, "dis ", 4) == 0) {
+            char addr_arg[32];
+            char count_arg[32];
+            const int num_args = sscanf(inp, "dis %31s %31s", addr_arg,
+              count_arg);
+            uint64_t addr = CuGetProgCtr();
+            uint64_t count = 1;
+            if ((num_args >= 1 && (!ParseAddr(addr_arg, &addr) ||
+              addr > UINT32_MAX)) || (num_args >= 2 &&
+              (!ParseNum(count_arg, &count) || count > UINT32_MAX))) {
+                RET_ON_ERR(PutMsg("ERROR: Usage: dis [<addr> [<count>]]\n",
+                  err));
+                continue;
+            }
+            RET_ON_ERR(Disassemble((uint32_t)addr, (uint32_t)count, err));
             continue;
         }
         if (strcmp(inp, "exit") == 0 || strcmp(inp, "quit") == 0) {
+            RET_ON_ERR(FlushMsgs(err));
             *quit = true;
             RET_ON_ERR(CuSetCpuState(CU_CPU_QUITTING, err));
             return true;
         }
+        if (strncmp(inp, "find ", 5) == 0) {
+            char addr_arg[32];
+            char len_arg[32];
+            char val_arg[32];
+            char unit_arg[4] = "b";
+            const int num_args = sscanf(inp, "find %31s %31s %31s %3s",
+              addr_arg, len_arg, val_arg, unit_arg);
+            uint64_t addr;
+            uint64_t len;
+            uint64_t val;
+            uint32_t unit;
+            if (num_args < 3 || !ParseAddr(addr_arg, &addr) ||
+              addr > UINT32_MAX || !ParseNum(len_arg, &len) ||
+              len > UINT32_MAX || !ParseNum(val_arg, &val) ||
+              val > UINT32_MAX || !ParseUnit(unit_arg, &unit)) {
+                RET_ON_ERR(PutMsg("ERROR: Usage: find <addr> <len> <val> "
+                  "[b|h|w]\n", err));
+                continue;
+            }
+            RET_ON_ERR(FindInMemory((uint32_t)addr, (uint32_t)len,
+              (uint32_t)val, unit, err));
+            continue;
+        }
+        if (strncmp(inp, "load ", 5) == 0) {
+            char file_arg[128];
+            char addr_arg[32];
+            uint64_t addr;
+            if (sscanf(inp, "load %127s %31s", file_arg, addr_arg) != 2 ||
+              !ParseAddr(addr_arg, &addr) || addr > UINT32_MAX) {
+                RET_ON_ERR(PutMsg("ERROR: Usage: load <file> <addr>\n", err));
+                continue;
+            }
+            RET_ON_ERR(TransferMem(false, file_arg, (uint32_t)addr, 0, err));
+            continue;
+        }
+        if (strncmp(inp, "mem ", 4) == 0) {
+            char addr_arg[32];
+            char len_arg[32];
+            char unit_arg[4] = "b";
+            const int num_args = sscanf(inp, "mem %31s %31s %3s", addr_arg,
+              len_arg, unit_arg);
+            uint64_t addr;
+            uint64_t len;
+            uint32_t unit;
+            if (num_args < 2 || !ParseAddr(addr_arg, &addr) ||
+              addr > UINT32_MAX || !ParseNum(len_arg, &len) ||
+              len > UINT32_MAX || !ParseUnit(unit_arg, &unit)) {
+                RET_ON_ERR(PutMsg("ERROR: Usage: mem <addr> <len> [b|h|w]\n",
+                  err));
+                continue;
+            }
+            RET_ON_ERR(DumpMemory((uint32_t)addr, (uint32_t)len, unit, err));
+            continue;
+        }
+        if (strcmp(inp, "pause") == 0) {
+            RET_ON_ERR(CuPauseCpu(err));
+            continue;
+        }
+        if (strcmp(inp, "pipe") == 0) {
+            RET_ON_ERR(PrintPipelineStats(err));
+            continue;
+        }
         if (strcmp(inp, "reg") == 0) {
             RET_ON_ERR(PrintRegisters(err));
             continue;
         }
+        if (strcmp(inp, "reverse-continue") == 0) {
+            RET_ON_ERR(ReverseCpu(0, err));
+            continue;
+        }
+        if (strcmp(inp, "reverse-step") == 0) {
+            RET_ON_ERR(ReverseCpu(1, err));
+            continue;
+        }
+        if (strncmp(inp, "reverse-step ", 13) == 0) {
+            uint64_t n;
+            if (!ParseNum(inp + 13, &n) || n == 0) {
+                RET_ON_ERR(PutMsg("ERROR: Invalid instruction-count.\n", err));
+                continue;
+            }
+            RET_ON_ERR(ReverseCpu(n, err));
+            continue;
+        }
+        if (strncmp(inp, "run ", 4) == 0) {
+            uint64_t n;
+            if (!ParseNum(inp + 4, &n) || n == 0) {
+                RET_ON_ERR(PutMsg("ERROR: Invalid instruction-count.\n", err));
+                continue;
+            }
+            RET_ON_ERR(RunCpu(n, CU_CPU_RUN_NO_UNTIL, err));
+            continue;
+        }
+        if (strncmp(inp, "save ", 5) == 0) {
+            char file_arg[128];
+            char addr_arg[32];
+            char len_arg[32];
+            uint64_t addr;
+            uint64_t len;
+            if (sscanf(inp, "save %127s %31s %31s", file_arg, addr_arg,
+              len_arg) != 3 || !ParseAddr(addr_arg, &addr) ||
+              addr > UINT32_MAX || !ParseNum(len_arg, &len) ||
+              len > UINT32_MAX) {
+                RET_ON_ERR(PutMsg("ERROR: Usage: save <file> <addr> <len>\n",
+                  err));
+                continue;
+            }
+            RET_ON_ERR(TransferMem(true, file_arg, (uint32_t)addr,
+              (uint32_t)len, err));
+            continue;
+        }
+        if (strcmp(inp, "stats") == 0) {
+            RET_ON_ERR(PrintTimingStats(err));
+            continue;
+        }
         if (strcmp(inp, "step") == 0) {
+            if (CuGetCpuState() == CU_CPU_RUNNING) {
+                RET_ON_ERR(PutMsg("ERROR: Executor is running (see 'pause')."
+                  "\n", err));
+                continue;
+            }
             RET_ON_ERR(CuExecSingleStep(err));
-            RET_ON_ERR(Disassemble(err));
+            RET_ON_ERR(Disassemble(CuGetProgCtr(), 1, err));
+            continue;
+        }
+        if (strncmp(inp, "unwatch ", 8) == 0) {
+            uint64_t addr;
+            if (!ParseAddr(inp + 8, &addr) || addr > UINT32_MAX) {
+                RET_ON_ERR(PutMsg("ERROR: Invalid address.\n", err));
+                continue;
+            }
+            RET_ON_ERR(ChangePoints(POINT_REMOVE_WATCH, (uint32_t)addr, 0,
+              NULL, err));
+            continue;
+        }
+        if (strncmp(inp, "until ", 6) == 0) {
+            uint64_t addr;
+            if (!ParseAddr(inp + 6, &addr) || addr >= CU_CPU_RUN_NO_UNTIL ||
+              (addr & 0x3U) != 0) {
+                RET_ON_ERR(PutMsg("ERROR: Invalid address.\n", err));
+                continue;
+            }
+            RET_ON_ERR(RunCpu(CU_CPU_RUN_NO_LIMIT, (uint32_t)addr, err));
+            continue;
+        }
+        if (strncmp(inp, "watch ", 6) == 0) {
+            char cmd[128];
+            const char* cond = SplitCond(inp, cmd, sizeof cmd);
+            char addr_arg[32];
+            char unit_arg[4] = "w";
+            char extra_arg[2];
+            uint64_t addr;
+            uint32_t unit;
+            const int num_args = sscanf(cmd, "watch %31s %3s %1s", addr_arg,
+              unit_arg, extra_arg);
+            if (num_args < 1 || num_args > 2 || !ParseAddr(addr_arg, &addr) ||
+              addr > UINT32_MAX || !ParseUnit(unit_arg, &unit)) {
+                RET_ON_ERR(PutMsg("ERROR: Usage: watch <addr> [b|h|w] "
+                  "[if <cond>]\n", err));
+                continue;
+            }
+            RET_ON_ERR(ChangePoints(POINT_ADD_WATCH, (uint32_t)addr, unit,
+              cond, err));
             continue;
         }
         if (inp[0] != '\0') {
             char buf[256];
             snprintf(buf, sizeof buf, "ERROR: Unknown command '%s'.\n", inp);
-            RET_ON_ERR(out_fn(buf, err));
+            RET_ON_ERR(PutMsg(buf, err));
         }
     } while (!*quit);
 
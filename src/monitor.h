@@ -18,6 +18,11 @@ typedef bool (*CuMonPutMsgFn)(const char* restrict msg, CuError* restrict err);
 extern bool CuMonSetUp(CuMonGetInpFn get_fn, CuMonPutMsgFn put_fn,
   CuError* restrict err);
 
+// Whether the Monitor is used interactively (the default), or reads commands
+// from a script without showing prompts, waiting for every run of the executor
+// to stop before reading the next command.
+extern void CuMonSetInteractive(bool interactive);
+
 extern bool CuRunMon(bool* restrict quit, CuError* restrict err);
 
 #endif  // CUSS_MONITOR_INCLUDED
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_OPCODES_INCLUDED
+#define CUSS_OPCODES_INCLUDED
+
+// The single description of the op-codes of the CUP ISA (see "doc/cup.md"),
+// shared by the executor, the decoder, and the assembler as "X-macros".
+
+// The operands of an instruction, in the order written in assembly-language.
+typedef enum {
+    CU_OPF_NONE = 0,
+    // `rt`, `ra`, `rb`.
+    CU_OPF_T_A_B,
+    // `rt`, `ra`, `imm5`.
+    CU_OPF_T_A_IMM5,
+    // `rt`, `ra`.
+    CU_OPF_T_A,
+    // `rt`.
+    CU_OPF_T,
+    // `ra`.
+    CU_OPF_A,
+    // `ra`, `rb`, `imm5`.
+    CU_OPF_A_B_IMM5,
+    // `rt`, `ra`, `imm16`.
+    CU_OPF_T_A_IMM16,
+    // `rt`, `imm16`.
+    CU_OPF_T_IMM16,
+    // `rt`, `imm21`.
+    CU_OPF_T_IMM21,
+    // `imm26`.
+    CU_OPF_IMM26,
+    // The instruction is identified by its secondary op-code `op1`.
+    CU_OPF_OP1,
+} CuOpFmt;
+
+// X(op0, mnemonic, operand-format, executor) for each primary op-code `op0`,
+// where `executor` names the group of instructions executed by the same
+// function `CuExec<executor>` in "ops.c".
+#define CU_OP0_LIST(X) \
+  X(0x00, ----, CU_OPF_OP1, Op0x00) \
+  X(0x01, ANDI, CU_OPF_T_A_IMM16, BoolImmOps) \
+  X(0x02, ORRI, CU_OPF_T_A_IMM16, BoolImmOps) \
+  X(0x03, XORI, CU_OPF_T_A_IMM16, BoolImmOps) \
+  X(0x04, ADDI, CU_OPF_T_A_IMM16, AddImmOp) \
+  X(0x05, JMPI, CU_OPF_IMM26, JmpOps) \
+  X(0x06, JALI, CU_OPF_IMM26, JmpOps) \
+  X(0x07, BRNR, CU_OPF_T_IMM21, FlagBranchOps) \
+  X(0x08, BROR, CU_OPF_T_IMM21, FlagBranchOps) \
+  X(0x09, BRCR, CU_OPF_T_IMM21, FlagBranchOps) \
+  X(0x0a, BRZR, CU_OPF_T_IMM21, FlagBranchOps) \
+  X(0x0b, BRNE, CU_OPF_T_A_IMM16, CmpBranchOps) \
+  X(0x0c, BRGT, CU_OPF_T_A_IMM16, CmpBranchOps) \
+  X(0x0d, LDUI, CU_OPF_T_IMM16, LoadUpImmOp) \
+  X(0x0e, LDWD, CU_OPF_T_A_IMM16, LoadMemOps) \
+  X(0x0f, LDHS, CU_OPF_T_A_IMM16, LoadMemOps) \
+  X(0x10, LDHU, CU_OPF_T_A_IMM16, LoadMemOps) \
+  X(0x11, LDBS, CU_OPF_T_A_IMM16, LoadMemOps) \
+  X(0x12, LDBU, CU_OPF_T_A_IMM16, LoadMemOps) \
+  X(0x13, STWD, CU_OPF_T_A_IMM16, StoreMemOps) \
+  X(0x14, STHW, CU_OPF_T_A_IMM16, StoreMemOps) \
+  X(0x15, STSB, CU_OPF_T_A_IMM16, StoreMemOps) \
+  X(0x16, LDLW, CU_OPF_T_A_IMM16, AtomicMemOps) \
+  X(0x17, STCW, CU_OPF_T_A_IMM16, AtomicMemOps) \
+  X(0x18, FENC, CU_OPF_NONE, FenceOp)
+
+// X(op1, mnemonic, operand-format) for each secondary op-code `op1` used with
+// the primary op-code 0x00.
+#define CU_OP1_LIST(X) \
+  X(0x00, SLLR, CU_OPF_T_A_B) \
+  X(0x01, SLRF, CU_OPF_T_A_B) \
+  X(0x02, SRLR, CU_OPF_T_A_B) \
+  X(0x03, SRRF, CU_OPF_T_A_B) \
+  X(0x04, SRAR, CU_OPF_T_A_B) \
+  X(0x05, SRAS, CU_OPF_T_A_B) \
+  X(0x06, SLLI, CU_OPF_T_A_IMM5) \
+  X(0x07, SLIF, CU_OPF_T_A_IMM5) \
+  X(0x08, SRLI, CU_OPF_T_A_IMM5) \
+  X(0x09, SRIF, CU_OPF_T_A_IMM5) \
+  X(0x0a, SRAI, CU_OPF_T_A_IMM5) \
+  X(0x0b, SRAJ, CU_OPF_T_A_IMM5) \
+  X(0x0c, ANDR, CU_OPF_T_A_B) \
+  X(0x0d, ADRF, CU_OPF_T_A_B) \
+  X(0x0e, ORRR, CU_OPF_T_A_B) \
+  X(0x0f, ORRF, CU_OPF_T_A_B) \
+  X(0x10, NOTR, CU_OPF_T_A) \
+  X(0x11, NOTF, CU_OPF_T_A) \
+  X(0x12, XORR, CU_OPF_T_A_B) \
+  X(0x13, XORF, CU_OPF_T_A_B) \
+  X(0x14, ADDR, CU_OPF_T_A_B) \
+  X(0x15, ADDF, CU_OPF_T_A_B) \
+  X(0x16, SUBR, CU_OPF_T_A_B) \
+  X(0x17, SUBF, CU_OPF_T_A_B) \
+  X(0x18, MULR, CU_OPF_T_A_B) \
+  X(0x19, MULF, CU_OPF_T_A_B) \
+  X(0x1a, DIVR, CU_OPF_T_A_B) \
+  X(0x1b, DIVF, CU_OPF_T_A_B) \
+  X(0x1c, RDEP, CU_OPF_T) \
+  X(0x1d, WREP, CU_OPF_A) \
+  X(0x1e, JMPR, CU_OPF_A_B_IMM5) \
+  X(0x1f, JALR, CU_OPF_A_B_IMM5) \
+  X(0x20, RDCI, CU_OPF_T) \
+  X(0x21, RDCN, CU_OPF_T)
+
+#endif  // CUSS_OPCODES_INCLUDED
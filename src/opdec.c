@@ -2,8 +2,10 @@
 // SPDX-License-Identifier: BSD-3-Clause
 #include "opdec.h"
 
-#include <inttypes.h>
-#include <stdio.h>
+#include "opcodes.h"
+
+#define NUM_OP0S (1 << 6)
+#define NUM_OP1S (1 << 6)
 
 #define GET_OP0(insn) (uint8_t)(((insn & 0xFC000000U) >> 26) & 0x0000003FU)
 #define GET_OP1(insn) (uint8_t)((insn) & 0x0000003FU)
@@ -17,300 +19,162 @@
 #define GET_IMM21(insn) (insn & 0x001FFFFFU)
 #define GET_IMM26(insn) (insn & 0x03FFFFFFU)
 
-static void CuDecodeOp0x00(uint32_t insn, char* restrict buf, size_t size) {
-    const uint8_t rt = GET_RT(insn);
-    const uint8_t ra = GET_RA(insn);
-    const uint8_t rb = GET_RB(insn);
-    const uint8_t imm5 = GET_IMM5(insn);
-
-    switch (GET_OP1(insn)) {
-      case 0x00:
-        snprintf(buf, size, "SLLR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x01:
-        snprintf(buf, size, "SLRF r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x02:
-        snprintf(buf, size, "SRLR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x03:
-        snprintf(buf, size, "SRRF r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x04:
-        snprintf(buf, size, "SRAR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x05:
-        snprintf(buf, size, "SRAS r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x06:
-        snprintf(buf, size, "SLLI r%d, r%d, %d", rt, ra, imm5);
-        break;
-
-      case 0x07:
-        snprintf(buf, size, "SLIF r%d, r%d, %d", rt, ra, imm5);
-        break;
-
-      case 0x08:
-        snprintf(buf, size, "SRLI r%d, r%d, %d", rt, ra, imm5);
-        break;
-
-      case 0x09:
-        snprintf(buf, size, "SRIF r%d, r%d, %d", rt, ra, imm5);
-        break;
-
-      case 0x0a:
-        snprintf(buf, size, "SRAI r%d, r%d, %d", rt, ra, imm5);
-        break;
-
-      case 0x0b:
-        snprintf(buf, size, "SRAJ r%d, r%d, %d", rt, ra, imm5);
-        break;
-
-      case 0x0c:
-        snprintf(buf, size, "ANDR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x0d:
-        snprintf(buf, size, "ADRF r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x0e:
-        snprintf(buf, size, "ORRR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x0f:
-        snprintf(buf, size, "ORRF r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x10:
-        snprintf(buf, size, "NOTR r%d, r%d", rt, ra);
-        break;
-
-      case 0x11:
-        snprintf(buf, size, "NOTF r%d, r%d", rt, ra);
-        break;
-
-      case 0x12:
-        snprintf(buf, size, "XORR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x13:
-        snprintf(buf, size, "XORF r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x14:
-        snprintf(buf, size, "ADDR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x15:
-        snprintf(buf, size, "ADDF r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x16:
-        snprintf(buf, size, "SUBR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x17:
-        snprintf(buf, size, "SUBF r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x18:
-        snprintf(buf, size, "MULR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x19:
-        snprintf(buf, size, "MULF r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x1a:
-        snprintf(buf, size, "DIVR r%d, r%d, r%d", rt, ra, rb);
-        break;
-
-      case 0x1b:
-        snprintf(buf, size, "DIVF r%d, r%d, r%d", rt, ra, rb);
-        break;
+typedef struct OpDesc {
+    const char* mnem;
+    CuOpFmt fmt;
+} OpDesc;
 
-      case 0x1c:
-        snprintf(buf, size, "RDEP r%d", rt);
-        break;
+// Descriptions of instructions indexed by `op0` and by `op1`, with a NULL
+// `mnem` for undefined op-codes.
+#define OP0_DESC(op0, mnem, fmt, exec) [op0] = {#mnem, fmt},
+static const OpDesc op0_descs[NUM_OP0S] = {CU_OP0_LIST(OP0_DESC)};
+#undef OP0_DESC
 
-      case 0x1d:
-        snprintf(buf, size, "WREP r%d", ra);
-        break;
+#define OP1_DESC(op1, mnem, fmt) [op1] = {#mnem, fmt},
+static const OpDesc op1_descs[NUM_OP1S] = {CU_OP1_LIST(OP1_DESC)};
+#undef OP1_DESC
 
-      case 0x1e:
-        snprintf(buf, size, "JMPR r%d, r%d, %d", ra, rb, imm5);
-        break;
+static const char hex_digits[] = "0123456789abcdef";
 
-      case 0x1f:
-        snprintf(buf, size, "JALR r%d, r%d, %d", ra, rb, imm5);
-        break;
+// The following emit text at `p`, never going past `end`, and return the
+// position just after the emitted text.
 
-      default:
-        snprintf(buf, size, "????");
-        break;
+static inline char* PutChar(char* p, const char* end, char c) {
+    if (p < end) {
+        *p++ = c;
     }
+    return p;
 }
 
-void CuDecodeOp(uint32_t insn, char* restrict buf, size_t size) {
-    switch (GET_OP0(insn)) {
-      case 0x00:
-        CuDecodeOp0x00(insn, buf, size);
-        break;
-
-      case 0x01:
-        snprintf(buf, size, "ANDI r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
-        break;
-
-      case 0x02:
-        snprintf(buf, size, "ORRI r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
-        break;
-
-      case 0x03:
-        snprintf(buf, size, "XORI r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
-        break;
-
-      case 0x04:
-        snprintf(buf, size, "ADDI r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
-        break;
+static inline char* PutStr(char* p, const char* end, const char* restrict s) {
+    while (*s != '\0' && p < end) {
+        *p++ = *s++;
+    }
+    return p;
+}
 
-      case 0x05:
-        snprintf(buf, size, "JMPI %08" PRIx32, GET_IMM26(insn));
-        break;
+static inline char* PutHex(char* p, const char* end, uint32_t val,
+  int num_digits) {
+    for (int i = num_digits - 1; i >= 0; i--) {
+        p = PutChar(p, end, hex_digits[(val >> (4 * i)) & 0xFU]);
+    }
+    return p;
+}
 
-      case 0x06:
-        snprintf(buf, size, "JALI %08" PRIx32, GET_IMM26(insn));
-        break;
+// Only used for register-numbers and `imm5`, both less than 100.
+static inline char* PutDec(char* p, const char* end, uint8_t val) {
+    if (val >= 10) {
+        p = PutChar(p, end, (char)('0' + val / 10));
+    }
+    return PutChar(p, end, (char)('0' + val % 10));
+}
 
-      case 0x07:
-        snprintf(buf, size, "BRNR r%d, %08" PRIx32, GET_RT(insn),
-          GET_IMM21(insn));
-        break;
+static inline char* PutReg(char* p, const char* end, uint8_t r) {
+    return PutDec(PutChar(p, end, 'r'), end, r);
+}
 
-      case 0x08:
-        snprintf(buf, size, "BROR r%d, %08" PRIx32, GET_RT(insn),
-          GET_IMM21(insn));
-        break;
+static inline char* PutSep(char* p, const char* end) {
+    return PutChar(PutChar(p, end, ','), end, ' ');
+}
 
-      case 0x09:
-        snprintf(buf, size, "BRCR r%d, %08" PRIx32, GET_RT(insn),
-          GET_IMM21(insn));
-        break;
+static char* PutInsn(char* p, const char* end, uint32_t insn) {
+    const OpDesc* desc = &op0_descs[GET_OP0(insn)];
+    if (desc->fmt == CU_OPF_OP1) {
+        desc = &op1_descs[GET_OP1(insn)];
+    }
+    if (desc->mnem == NULL) {
+        return PutStr(p, end, "????");
+    }
 
-      case 0x0a:
-        snprintf(buf, size, "BRZR r%d, %08" PRIx32, GET_RT(insn),
-          GET_IMM21(insn));
+    p = PutStr(p, end, desc->mnem);
+    if (desc->fmt != CU_OPF_NONE) {
+        p = PutChar(p, end, ' ');
+    }
+    switch (desc->fmt) {
+      case CU_OPF_T_A_B:
+        p = PutSep(PutReg(p, end, GET_RT(insn)), end);
+        p = PutSep(PutReg(p, end, GET_RA(insn)), end);
+        p = PutReg(p, end, GET_RB(insn));
         break;
 
-      case 0x0b:
-        snprintf(buf, size, "BRNE r%d, %08" PRIx32, GET_RT(insn),
-          GET_IMM21(insn));
+      case CU_OPF_T_A_IMM5:
+        p = PutSep(PutReg(p, end, GET_RT(insn)), end);
+        p = PutSep(PutReg(p, end, GET_RA(insn)), end);
+        p = PutDec(p, end, GET_IMM5(insn));
         break;
 
-      case 0x0c:
-        snprintf(buf, size, "BRGT r%d, %08" PRIx32, GET_RT(insn),
-          GET_IMM21(insn));
+      case CU_OPF_T_A:
+        p = PutSep(PutReg(p, end, GET_RT(insn)), end);
+        p = PutReg(p, end, GET_RA(insn));
         break;
 
-      case 0x0d:
-        snprintf(buf, size, "LDUI r%d, %04" PRIx32, GET_RT(insn),
-          GET_IMM16(insn));
+      case CU_OPF_T:
+        p = PutReg(p, end, GET_RT(insn));
         break;
 
-      case 0x0e:
-        snprintf(buf, size, "LDWD r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
+      case CU_OPF_A:
+        p = PutReg(p, end, GET_RA(insn));
         break;
 
-      case 0x0f:
-        snprintf(buf, size, "LDHS r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
+      case CU_OPF_A_B_IMM5:
+        p = PutSep(PutReg(p, end, GET_RA(insn)), end);
+        p = PutSep(PutReg(p, end, GET_RB(insn)), end);
+        p = PutDec(p, end, GET_IMM5(insn));
         break;
 
-      case 0x10:
-        snprintf(buf, size, "LDHU r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
+      case CU_OPF_T_A_IMM16:
+        p = PutSep(PutReg(p, end, GET_RT(insn)), end);
+        p = PutSep(PutReg(p, end, GET_RA(insn)), end);
+        p = PutHex(PutStr(p, end, "0x"), end, GET_IMM16(insn), 4);
         break;
 
-      case 0x11:
-        snprintf(buf, size, "LDBS r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
+      case CU_OPF_T_IMM16:
+        p = PutSep(PutReg(p, end, GET_RT(insn)), end);
+        p = PutHex(PutStr(p, end, "0x"), end, GET_IMM16(insn), 4);
         break;
 
-      case 0x12:
-        snprintf(buf, size, "LDBU r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
+      case CU_OPF_T_IMM21:
+        p = PutSep(PutReg(p, end, GET_RT(insn)), end);
+        p = PutHex(PutStr(p, end, "0x"), end, GET_IMM21(insn), 8);
         break;
 
-      case 0x13:
-        snprintf(buf, size, "STWD r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
+      case CU_OPF_IMM26:
+        p = PutHex(PutStr(p, end, "0x"), end, GET_IMM26(insn), 8);
         break;
 
-      case 0x14:
-        snprintf(buf, size, "STHW r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
+      case CU_OPF_NONE:
+      case CU_OPF_OP1:
         break;
+    }
+    return p;
+}
 
-      case 0x15:
-        snprintf(buf, size, "STSB r%d, r%d, %04" PRIx32, GET_RT(insn),
-          GET_RA(insn), GET_IMM16(insn));
-        break;
+size_t CuDecodeOp(uint32_t insn, char* restrict buf, size_t size) {
+    if (buf == NULL || size == 0) {
+        return 0;
+    }
+    char* p = PutInsn(buf, buf + size - 1, insn);
+    *p = '\0';
+    return p - buf;
+}
 
-      case 0x16:
-      case 0x17:
-      case 0x18:
-      case 0x19:
-      case 0x1a:
-      case 0x1b:
-      case 0x1c:
-      case 0x1d:
-      case 0x1e:
-      case 0x1f:
-      case 0x20:
-      case 0x21:
-      case 0x22:
-      case 0x23:
-      case 0x24:
-      case 0x25:
-      case 0x26:
-      case 0x27:
-      case 0x28:
-      case 0x29:
-      case 0x2a:
-      case 0x2b:
-      case 0x2c:
-      case 0x2d:
-      case 0x2e:
-      case 0x2f:
-      case 0x30:
-      case 0x31:
-      case 0x32:
-      case 0x33:
-      case 0x34:
-      case 0x35:
-      case 0x36:
-      case 0x37:
-      case 0x38:
-      case 0x39:
-      case 0x3a:
-      case 0x3b:
-      case 0x3c:
-      case 0x3d:
-      case 0x3e:
-      case 0x3f:
-      default:
-        snprintf(buf, size, "????");
-        break;
+size_t CuDecodeOps(uint32_t addr, const uint32_t* restrict insns, size_t n,
+  char* restrict buf, size_t size, size_t* restrict len) {
+    *len = 0;
+    if (buf == NULL || size == 0) {
+        return 0;
+    }
+    const char* end = buf + size - 1;
+    char* p = buf;
+    size_t i;
+    for (i = 0; i < n && (size_t)(end - p) >= CU_OPDEC_LINE_SIZE; i++) {
+        p = PutStr(p, end, "  ");
+        p = PutHex(p, end, addr + 4U * (uint32_t)i, 8);
+        p = PutStr(p, end, ": ");
+        p = PutInsn(p, end, insns[i]);
+        p = PutChar(p, end, '\n');
     }
+    *p = '\0';
+    *len = p - buf;
+    return i;
 }
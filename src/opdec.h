@@ -6,6 +6,18 @@
 #include <stddef.h>
 #include <stdint.h>
 
-extern void CuDecodeOp(uint32_t insn, char* restrict buf, size_t size);
+// The maximum size of a line of disassembly from `CuDecodeOps()`, including
+// the terminal newline.
+#define CU_OPDEC_LINE_SIZE 48
+
+// Decode `insn` into `buf`, returning the length of the decoded text.
+extern size_t CuDecodeOp(uint32_t insn, char* restrict buf, size_t size);
+
+// Decode `n` instructions `insns` at the memory-address `addr` onwards into
+// `buf`, as one line per instruction, returning the number of instructions
+// decoded (fewer than `n` if `buf` is full) and setting `len` to the length of
+// the decoded text.
+extern size_t CuDecodeOps(uint32_t addr, const uint32_t* restrict insns,
+  size_t n, char* restrict buf, size_t size, size_t* restrict len);
 
 #endif  // CUSS_OPDEC_INCLUDED
@@ -0,0 +1,411 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "openc.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include "opcodes.h"
+
+#define PUT_OP0(op0) ((uint32_t)(op0) << 26)
+
+#define PUT_RT(r) ((uint32_t)(r) << 21)
+#define PUT_RA(r) ((uint32_t)(r) << 16)
+#define PUT_RB(r) ((uint32_t)(r) << 11)
+
+#define PUT_IMM5(imm) ((uint32_t)(imm) << 6)
+
+// How the name of a label is encoded as the immediate value of an instruction.
+typedef enum {
+    LABEL_ADDR = 0,
+    // The offset in words from the instruction.
+    LABEL_PC_REL,
+    // The word-address.
+    LABEL_WORD,
+} LabelMode;
+
+typedef struct OpEnc {
+    const char* mnem;
+    uint32_t base;
+    CuOpFmt fmt;
+    const char* exec;
+} OpEnc;
+
+// Encodings of instructions, with the mnemonic of the pseudo-instruction to
+// load a 32-bit constant last.
+#define OP0_ENC(op0, mnem, fmt, exec) {#mnem, PUT_OP0(op0), fmt, #exec},
+#define OP1_ENC(op1, mnem, fmt) {#mnem, (uint32_t)(op1), fmt, "Op0x00"},
+static const OpEnc op_encs[] = {
+    CU_OP0_LIST(OP0_ENC)
+    CU_OP1_LIST(OP1_ENC)
+    {"LDCW", 0, CU_OPF_T_IMM16, ""},
+};
+#undef OP0_ENC
+#undef OP1_ENC
+#define NUM_OP_ENCS (sizeof op_encs / sizeof op_encs[0])
+#define LDCW_IDX (NUM_OP_ENCS - 1)
+
+// An open-addressed hash-table of the indices (plus one) of the entries in
+// `op_encs` keyed by their mnemonics packed into 32 bits.
+#define ENC_TAB_BITS 7
+#define ENC_TAB_SIZE (1U << ENC_TAB_BITS)
+static uint32_t enc_tab_keys[ENC_TAB_SIZE];
+static uint8_t enc_tab_idxs[ENC_TAB_SIZE];
+static LabelMode label_modes[NUM_OP_ENCS];
+static uint32_t orri_base = 0;
+static uint32_t ldui_base = 0;
+static bool enc_tab_ready = false;
+
+static inline uint32_t HashKey(uint32_t key) {
+    return (key * 0x9E3779B1U) >> (32 - ENC_TAB_BITS);
+}
+
+// Pack the mnemonic `mnem` of `len` characters in upper-case into `key`.
+static inline bool PackMnem(const char* restrict mnem, size_t len,
+  uint32_t* restrict key) {
+    if (len != 4) {
+        return false;
+    }
+    uint32_t k = 0;
+    for (size_t i = 0; i < 4; i++) {
+        k = (k << 8) | (uint8_t)toupper((unsigned char)mnem[i]);
+    }
+    *key = k;
+    return true;
+}
+
+static void InitEncTab(void) {
+    for (size_t i = 0; i < NUM_OP_ENCS; i++) {
+        const OpEnc* enc = &op_encs[i];
+        uint32_t key;
+        if (enc->fmt == CU_OPF_OP1 || !PackMnem(enc->mnem, 4, &key)) {
+            continue;
+        }
+        uint32_t h = HashKey(key);
+        while (enc_tab_idxs[h] != 0) {
+            h = (h + 1) & (ENC_TAB_SIZE - 1);
+        }
+        enc_tab_keys[h] = key;
+        enc_tab_idxs[h] = (uint8_t)(i + 1);
+
+        if (strcmp(enc->exec, "JmpOps") == 0 ||
+          strcmp(enc->exec, "CmpBranchOps") == 0) {
+            label_modes[i] = LABEL_PC_REL;
+        } else if (strcmp(enc->exec, "FlagBranchOps") == 0) {
+            label_modes[i] = LABEL_WORD;
+        }
+        if (strcmp(enc->mnem, "ORRI") == 0) {
+            orri_base = enc->base;
+        } else if (strcmp(enc->mnem, "LDUI") == 0) {
+            ldui_base = enc->base;
+        }
+    }
+    enc_tab_ready = true;
+}
+
+// Return the index of the encoding of `mnem` in `op_encs`, or -1.
+static int FindOpEnc(const char* restrict mnem, size_t len) {
+    if (!enc_tab_ready) {
+        InitEncTab();
+    }
+    uint32_t key;
+    if (!PackMnem(mnem, len, &key)) {
+        return -1;
+    }
+    for (uint32_t h = HashKey(key); enc_tab_idxs[h] != 0;
+      h = (h + 1) & (ENC_TAB_SIZE - 1)) {
+        if (enc_tab_keys[h] == key) {
+            return enc_tab_idxs[h] - 1;
+        }
+    }
+    return -1;
+}
+
+size_t CuGetOpEncSize(const char* restrict mnem, size_t len) {
+    const int i = FindOpEnc(mnem, len);
+    if (i < 0) {
+        return 0;
+    }
+    return ((size_t)i == LDCW_IDX) ? 2 : 1;
+}
+
+typedef struct Parser {
+    const char* p;
+    const char* end;
+    uint32_t pc;
+    CuOpEncLabelFn label_fn;
+    void* ctx;
+} Parser;
+
+static inline void SkipSpace(Parser* restrict ps) {
+    while (ps->p < ps->end && isspace((unsigned char)*ps->p)) {
+        ps->p++;
+    }
+}
+
+static bool ParseSep(Parser* restrict ps, CuError* restrict err) {
+    SkipSpace(ps);
+    if (ps->p == ps->end || *ps->p != ',') {
+        return CuErrMsg(err, "Expected ','.");
+    }
+    ps->p++;
+    SkipSpace(ps);
+    return true;
+}
+
+static bool ParseReg(Parser* restrict ps, uint32_t* restrict r,
+  CuError* restrict err) {
+    const char* p = ps->p;
+    if (p == ps->end || (*p != 'r' && *p != 'R') || ++p == ps->end ||
+      !isdigit((unsigned char)*p)) {
+        return CuErrMsg(err, "Expected a register.");
+    }
+    uint32_t n = (uint32_t)(*p++ - '0');
+    if (p < ps->end && isdigit((unsigned char)*p) && n != 0) {
+        n = 10 * n + (uint32_t)(*p++ - '0');
+    }
+    if (n > 31 || (p < ps->end && isalnum((unsigned char)*p))) {
+        return CuErrMsg(err, "Bad register.");
+    }
+    *r = n;
+    ps->p = p;
+    return true;
+}
+
+static inline bool IsNameChar(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.';
+}
+
+// Parse a number or the name of a label into `val`, setting `is_label` to
+// whether it was a label.
+static bool ParseVal(Parser* restrict ps, LabelMode mode,
+  int64_t* restrict val, bool* restrict is_label, CuError* restrict err) {
+    const char* p = ps->p;
+    *is_label = false;
+    if (p < ps->end && (isalpha((unsigned char)*p) || *p == '_' ||
+      *p == '.')) {
+        const char* name = p;
+        while (p < ps->end && IsNameChar(*p)) {
+            p++;
+        }
+        uint32_t addr;
+        if (ps->label_fn == NULL ||
+          !ps->label_fn(name, (size_t)(p - name), &addr, ps->ctx)) {
+            return CuErrMsg(err, "Unknown label '%.*s'.", (int)(p - name),
+              name);
+        }
+        ps->p = p;
+        *is_label = true;
+        switch (mode) {
+          case LABEL_PC_REL: {
+            const int64_t off = (int64_t)addr - (int64_t)ps->pc;
+            if (off % 4 != 0) {
+                return CuErrMsg(err, "Misaligned label '%.*s'.",
+                  (int)(p - name), name);
+            }
+            *val = off / 4;
+            return true;
+          }
+
+          case LABEL_WORD:
+            if (addr % 4 != 0) {
+                return CuErrMsg(err, "Misaligned label '%.*s'.",
+                  (int)(p - name), name);
+            }
+            *val = addr / 4;
+            return true;
+
+          case LABEL_ADDR:
+            break;
+        }
+        *val = addr;
+        return true;
+    }
+
+    const bool neg = p < ps->end && *p == '-';
+    if (neg) {
+        p++;
+    }
+    const bool hex = ps->end - p > 2 && p[0] == '0' &&
+      (p[1] == 'x' || p[1] == 'X');
+    if (hex) {
+        p += 2;
+    }
+    const char* digits = p;
+    int64_t v = 0;
+    while (p < ps->end && v <= UINT32_MAX) {
+        const int c = (unsigned char)*p;
+        int d;
+        if (isdigit(c)) {
+            d = c - '0';
+        } else if (hex && isxdigit(c)) {
+            d = tolower(c) - 'a' + 10;
+        } else {
+            break;
+        }
+        v = v * (hex ? 16 : 10) + d;
+        p++;
+    }
+    if (p == digits || (p < ps->end && IsNameChar(*p))) {
+        return CuErrMsg(err, "Bad immediate value.");
+    }
+    ps->p = p;
+    *val = neg ? -v : v;
+    return true;
+}
+
+// Parse an immediate value that must fit into `bits` bits, as a signed or
+// (unless `unsigned_only`) an unsigned number.
+static bool ParseImm(Parser* restrict ps, int bits, bool unsigned_only,
+  LabelMode mode, uint32_t* restrict imm, CuError* restrict err) {
+    int64_t val = 0;
+    bool is_label;
+    RET_ON_ERR(ParseVal(ps, mode, &val, &is_label, err));
+    if (mode == LABEL_PC_REL && is_label) {
+        // The offset is sign-extended when executed, so a label further away
+        // than that would be reached by a branch in the other direction.
+        const int64_t lim = (int64_t)1 << (bits - 1);
+        if (val < -lim || val >= lim) {
+            return CuErrMsg(err, "Branch target out of range.");
+        }
+    }
+    const int64_t min = unsigned_only ? 0 : -((int64_t)1 << (bits - 1));
+    const int64_t max = ((int64_t)1 << bits) - 1;
+    if (val < min || val > max) {
+        return CuErrMsg(err, "Immediate value out of range.");
+    }
+    *imm = (uint32_t)((uint64_t)val & (uint64_t)max);
+    return true;
+}
+
+bool CuEncodeOps(const char* restrict text, size_t len, uint32_t pc,
+  CuOpEncLabelFn label_fn, void* ctx, uint32_t* restrict insns,
+  size_t* restrict num_insns, CuError* restrict err) {
+    Parser ps = {
+        .p = text, .end = text + len, .pc = pc, .label_fn = label_fn,
+        .ctx = ctx,
+    };
+    *num_insns = 0;
+    SkipSpace(&ps);
+    const char* mnem = ps.p;
+    while (ps.p < ps.end && !isspace((unsigned char)*ps.p)) {
+        ps.p++;
+    }
+    const int i = FindOpEnc(mnem, (size_t)(ps.p - mnem));
+    if (i < 0) {
+        return CuErrMsg(err, "Unknown mnemonic '%.*s'.", (int)(ps.p - mnem),
+          mnem);
+    }
+    const OpEnc* enc = &op_encs[i];
+    const LabelMode mode = label_modes[i];
+    SkipSpace(&ps);
+
+    uint32_t insn = enc->base;
+    uint32_t rt = 0;
+    uint32_t ra = 0;
+    uint32_t rb = 0;
+    uint32_t imm = 0;
+    switch (enc->fmt) {
+      case CU_OPF_T_A_B:
+        RET_ON_ERR(ParseReg(&ps, &rt, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseReg(&ps, &ra, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseReg(&ps, &rb, err));
+        insn |= PUT_RT(rt) | PUT_RA(ra) | PUT_RB(rb);
+        break;
+
+      case CU_OPF_T_A_IMM5:
+        RET_ON_ERR(ParseReg(&ps, &rt, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseReg(&ps, &ra, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseImm(&ps, 5, true, mode, &imm, err));
+        insn |= PUT_RT(rt) | PUT_RA(ra) | PUT_IMM5(imm);
+        break;
+
+      case CU_OPF_T_A:
+        RET_ON_ERR(ParseReg(&ps, &rt, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseReg(&ps, &ra, err));
+        insn |= PUT_RT(rt) | PUT_RA(ra);
+        break;
+
+      case CU_OPF_T:
+        RET_ON_ERR(ParseReg(&ps, &rt, err));
+        insn |= PUT_RT(rt);
+        break;
+
+      case CU_OPF_A:
+        RET_ON_ERR(ParseReg(&ps, &ra, err));
+        insn |= PUT_RA(ra);
+        break;
+
+      case CU_OPF_A_B_IMM5:
+        RET_ON_ERR(ParseReg(&ps, &ra, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseReg(&ps, &rb, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseImm(&ps, 5, true, mode, &imm, err));
+        insn |= PUT_RA(ra) | PUT_RB(rb) | PUT_IMM5(imm);
+        break;
+
+      case CU_OPF_T_A_IMM16:
+        RET_ON_ERR(ParseReg(&ps, &rt, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseReg(&ps, &ra, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseImm(&ps, 16, false, mode, &imm, err));
+        insn |= PUT_RT(rt) | PUT_RA(ra) | imm;
+        break;
+
+      case CU_OPF_T_IMM16:
+        RET_ON_ERR(ParseReg(&ps, &rt, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        if ((size_t)i == LDCW_IDX) {
+            RET_ON_ERR(ParseImm(&ps, 32, false, mode, &imm, err));
+            insn = orri_base | PUT_RT(rt) | (imm & 0x0000FFFFU);
+            insns[(*num_insns)++] = insn;
+            insn = ldui_base | PUT_RT(rt) | (imm >> 16);
+            break;
+        }
+        RET_ON_ERR(ParseImm(&ps, 16, false, mode, &imm, err));
+        insn |= PUT_RT(rt) | imm;
+        break;
+
+      case CU_OPF_T_IMM21:
+        RET_ON_ERR(ParseReg(&ps, &rt, err));
+        RET_ON_ERR(ParseSep(&ps, err));
+        RET_ON_ERR(ParseImm(&ps, 21, false, mode, &imm, err));
+        insn |= PUT_RT(rt) | imm;
+        break;
+
+      case CU_OPF_IMM26:
+        RET_ON_ERR(ParseImm(&ps, 26, false, mode, &imm, err));
+        insn |= imm;
+        break;
+
+      case CU_OPF_NONE:
+      case CU_OPF_OP1:
+        break;
+    }
+    SkipSpace(&ps);
+    if (ps.p != ps.end) {
+        *num_insns = 0;
+        return CuErrMsg(err, "Unexpected '%c' after the operands.", *ps.p);
+    }
+    insns[(*num_insns)++] = insn;
+    return true;
+}
+
+bool CuEncodeOp(const char* restrict text, uint32_t* restrict insn,
+  CuError* restrict err) {
+    uint32_t insns[CU_OPENC_MAX_INSNS];
+    size_t n;
+    RET_ON_ERR(CuEncodeOps(text, strlen(text), 0, NULL, NULL, insns, &n, err));
+    if (n != 1) {
+        return CuErrMsg(err, "Not a single instruction.");
+    }
+    *insn = insns[0];
+    return true;
+}
@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_OPENC_INCLUDED
+#define CUSS_OPENC_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errors.h"
+
+// The encoder of CUP assembly-language, the reverse of the decoder in
+// "opdec.h", driven by the same table of op-codes.
+//
+// An instruction is written as its mnemonic (in any case) followed by its
+// operands separated by commas, in the order given by "opcodes.h". Registers
+// are written as `r0` to `r31`. Immediate values are written as (possibly
+// negative) decimal numbers or as hexadecimal numbers with a "0x" prefix, and
+// must fit their fields as either signed or unsigned numbers.
+//
+// An immediate value can also be the name of a label, resolved by the caller:
+// the offset in words from the instruction for JMPI, JALI, BRNE, and BRGT, the
+// word-address for the branches based on flags (relative to `r0`), and the
+// address itself for the rest. Since the offset is sign-extended, a label for
+// the former must be within range of it as a signed number.
+//
+// The pseudo-instruction "LDCW rt, imm32" loads a 32-bit constant into `rt`
+// as "ORRI rt, r0, <lower 16 bits>" followed by "LDUI rt, <upper 16 bits>".
+
+// The maximum number of instructions encoded from a single instruction.
+#define CU_OPENC_MAX_INSNS 2
+
+// Resolve the label `name` of `len` characters into `addr`, returning false
+// if it is unknown.
+typedef bool (*CuOpEncLabelFn)(const char* restrict name, size_t len,
+  uint32_t* restrict addr, void* ctx);
+
+// Return the number of instructions that the mnemonic `mnem` of `len`
+// characters encodes to, or zero if it is not a known mnemonic.
+extern size_t CuGetOpEncSize(const char* restrict mnem, size_t len);
+
+// Encode the instruction `text` of `len` characters at the memory-address `pc`
+// into `insns` (with room for `CU_OPENC_MAX_INSNS`), setting `num_insns` to
+// the number of instructions. Labels are resolved with `label_fn`, if not
+// NULL.
+extern bool CuEncodeOps(const char* restrict text, size_t len, uint32_t pc,
+  CuOpEncLabelFn label_fn, void* ctx, uint32_t* restrict insns,
+  size_t* restrict num_insns, CuError* restrict err);
+
+// Encode the single instruction `text`, as output by `CuDecodeOp()`, into
+// `insn`.
+extern bool CuEncodeOp(const char* restrict text, uint32_t* restrict insn,
+  CuError* restrict err);
+
+#endif  // CUSS_OPENC_INCLUDED
@@ -3,9 +3,14 @@
 #include "ops.h"
 
 #include <inttypes.h>
+#include <stddef.h>
 
+#include "concur.h"
 #include "cpu.h"
 #include "memory.h"
+#include "opcodes.h"
+#include "stbuf.h"
+#include "timing.h"
 
 // The register used to establish linkage across procedure-calls.
 #define LINK_REG_NUM 31
@@ -42,10 +47,65 @@
 
 // The type of a function to which the execution of a given instruction is
 // delegated using the dispatcher-table `cup_op_executors` below.
-typedef bool (*CuOpExecutor)(uint32_t pc, uint32_t insn, CuError* restrict err);
+typedef bool (*CuOpExecutor)(CuCore* restrict core, uint32_t pc, uint32_t insn,
+  CuError* restrict err);
 
 static CuOpExecutor cup_op_executors[NUM_OP0S];
 
+// Only set while there is something (like a watch-point) to check on stores.
+static CuStoreHookFn store_hook = NULL;
+
+// Plain loads and stores go through the store-buffer of `core`, if it has one.
+static inline bool LoadWord(const CuCore* restrict core, uint32_t addr,
+  uint32_t* restrict val, CuError* restrict err) {
+    return core->sbuf == NULL ? CuGetWordAt(addr, val, err) :
+      CuSbufGetWordAt(core->sbuf, addr, val, err);
+}
+
+static inline bool LoadHalfWord(const CuCore* restrict core, uint32_t addr,
+  uint16_t* restrict val, CuError* restrict err) {
+    return core->sbuf == NULL ? CuGetHalfWordAt(addr, val, err) :
+      CuSbufGetHalfWordAt(core->sbuf, addr, val, err);
+}
+
+static inline bool LoadByte(const CuCore* restrict core, uint32_t addr,
+  uint8_t* restrict val, CuError* restrict err) {
+    return core->sbuf == NULL ? CuGetByteAt(addr, val, err) :
+      CuSbufGetByteAt(core->sbuf, addr, val, err);
+}
+
+// Stores through a store-buffer are only seen by watch-points, etc. once it is
+// committed (at which point the store-hook is called instead).
+static inline bool StoreWord(CuCore* restrict core, uint32_t addr,
+  uint32_t val, CuError* restrict err) {
+    if (core->sbuf == NULL) {
+        return CuSetWordAt(addr, val, err);
+    }
+    RET_ON_ERR(CuSbufSetWordAt(core->sbuf, addr, val, err));
+    core->sbuf_full = CuSbufIsFull(core->sbuf);
+    return true;
+}
+
+static inline bool StoreHalfWord(CuCore* restrict core, uint32_t addr,
+  uint16_t val, CuError* restrict err) {
+    if (core->sbuf == NULL) {
+        return CuSetHalfWordAt(addr, val, err);
+    }
+    RET_ON_ERR(CuSbufSetHalfWordAt(core->sbuf, addr, val, err));
+    core->sbuf_full = CuSbufIsFull(core->sbuf);
+    return true;
+}
+
+static inline bool StoreByte(CuCore* restrict core, uint32_t addr,
+  uint8_t val, CuError* restrict err) {
+    if (core->sbuf == NULL) {
+        return CuSetByteAt(addr, val, err);
+    }
+    RET_ON_ERR(CuSbufSetByteAt(core->sbuf, addr, val, err));
+    core->sbuf_full = CuSbufIsFull(core->sbuf);
+    return true;
+}
+
 static inline uint32_t GetSignExtImm16(uint32_t insn) {
     uint32_t imm16 = GET_IMM16(insn);
     if (imm16 & 0x00008000U) {
@@ -70,30 +130,52 @@ static inline uint32_t GetSignExtImm26(uint32_t insn) {
     return imm26;
 }
 
-static void SetCpuIntFlags(uint64_t res) {
-    const bool neg = (res & 0x0000000080000000U) > 0;
-    const bool ovf = (res & 0xFFFFFFFF00000000U) > 0;
-    const bool car = (res & 0x0000000100000000U) > 0;
-    const bool zer = (res & 0x00000000FFFFFFFFU) == 0;
-    CuSetIntFlags(neg, ovf, car, zer);
+static inline void SetCpuIntFlags(CuCore* restrict core, uint64_t res) {
+    if (res & 0x0000000080000000U) {
+        core->psr |= CU_PSR_NEG;
+    }
+    if (res & 0xFFFFFFFF00000000U) {
+        core->psr |= CU_PSR_OVF;
+    }
+    if (res & 0x0000000100000000U) {
+        core->psr |= CU_PSR_CAR;
+    }
+    if ((res & 0x00000000FFFFFFFFU) == 0) {
+        core->psr |= CU_PSR_ZER;
+    }
+}
+
+static inline void SetIntReg(CuCore* restrict core, uint8_t r_n,
+  uint32_t r_val) {
+    if (r_n != 0x00) {
+        core->iregs[r_n] = r_val;
+    }
 }
 
-static bool CuExecBadOp0xNN(uint32_t pc, uint32_t insn,
+static inline bool SetProgCtr(CuCore* restrict core, uint32_t pc,
   CuError* restrict err) {
+    RET_ON_ERR(CuIsValidPhyMemAddr(pc, err));
+    if (pc & 0x00000003U) {
+        return CuErrMsg(err, "Unaligned instruction (PC=%08" PRIx32 ").", pc);
+    }
+    core->pc = pc;
+    return true;
+}
+
+static bool CuExecBadOp0xNN(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    (void)core;  // Suppress unused parameter warning.
     const uint8_t op0 = GET_OP0(insn);
     return CuErrMsg(err,
       "Bad instruction (op0=%02" PRIx8 " at pc=%08" PRIx32 ").", op0, pc);
 }
 
 // op0 = 0x00: an R-type container of many instructions.
-static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
+static bool CuExecOp0x00(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
     const uint8_t rt_num = GET_RT(insn);
-
-    uint32_t ra_val;
-    RET_ON_ERR(CuGetIntReg(GET_RA(insn), &ra_val, err));
-
-    uint32_t rb_val;
-    RET_ON_ERR(CuGetIntReg(GET_RB(insn), &rb_val, err));
+    const uint32_t ra_val = core->iregs[GET_RA(insn)];
+    uint32_t rb_val = core->iregs[GET_RB(insn)];
 
     uint32_t new_pc = NEXT_PC(pc);
 
@@ -117,9 +199,9 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // Only consider bits 0-4 - there are only 32 bits in a register.
         rb_val &= 0x000000001FU;
         const uint32_t res = ra_val << rb_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, res, err));
+        SetIntReg(core, rt_num, res);
         if (op1 == 0x01) {
-            SetCpuIntFlags(res);
+            SetCpuIntFlags(core, res);
         }
         break;
       }
@@ -140,13 +222,13 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // We therefore need to manually propagate the sign-bit.
         if ((op1 == 0x04 || op1 == 0x05) && (ra_val & 0x80000000U)) {
             // A string of `rb_val` 1s in the LSB.
-            uint64_t mask = (1 << rb_val) - 1;
+            uint64_t mask = (UINT64_C(1) << rb_val) - 1U;
             mask <<= (32 - rb_val);
             res |= mask;
         }
-        RET_ON_ERR(CuSetIntReg(rt_num, res, err));
+        SetIntReg(core, rt_num, res);
         if (op1 == 0x03 || op1 == 0x05) {
-            SetCpuIntFlags(res);
+            SetCpuIntFlags(core, res);
         }
         break;
       }
@@ -156,9 +238,9 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // SLLI (0x06): Shift `ra` left logically using the `imm5` immediate.
         // SLIF (0x07): The same as SLLI, but sets the integer condition-flags.
         const uint32_t res = ra_val << GET_IMM5(insn);
-        RET_ON_ERR(CuSetIntReg(rt_num, res, err));
+        SetIntReg(core, rt_num, res);
         if (op1 == 0x07) {
-            SetCpuIntFlags(res);
+            SetCpuIntFlags(core, res);
         }
         break;
       }
@@ -177,13 +259,13 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // We therefore need to manually propagate the sign-bit.
         if ((op1 == 0x0a || op1 == 0x0b) && (ra_val & 0x80000000U)) {
             // A string of `imm5` 1s in the LSB.
-            uint64_t mask = (1 << imm5) - 1;
+            uint64_t mask = (UINT64_C(1) << imm5) - 1U;
             mask <<= (32 - imm5);
             res |= mask;
         }
-        RET_ON_ERR(CuSetIntReg(rt_num, res, err));
+        SetIntReg(core, rt_num, res);
         if (op1 == 0x09 || op1 == 0x0b) {
-            SetCpuIntFlags(res);
+            SetCpuIntFlags(core, res);
         }
         break;
       }
@@ -193,9 +275,9 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // ANDR (0x0c): Bit-wise AND of `ra` and `rb` operands.
         // ADRF (0x0d): The same as ANDR, but sets the integer condition-flags.
         const uint32_t res = ra_val & rb_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, res, err));
+        SetIntReg(core, rt_num, res);
         if (op1 == 0x0d) {
-            SetCpuIntFlags(res);
+            SetCpuIntFlags(core, res);
         }
         break;
       }
@@ -205,9 +287,9 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // ORRR (0x0e): Bit-wise OR of `ra` and `rb` operands.
         // ORRF (0x0f): The same as ORRR, but sets the integer condition-flags.
         const uint32_t res = ra_val | rb_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, res, err));
+        SetIntReg(core, rt_num, res);
         if (op1 == 0x0f) {
-            SetCpuIntFlags(res);
+            SetCpuIntFlags(core, res);
         }
         break;
       }
@@ -217,9 +299,9 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // NOTR (0x10): Bit-wise NOT of `ra`.
         // NOTF (0x11): The same as NOTR, but sets the integer condition-flags.
         const uint32_t res = ~ra_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, res, err));
+        SetIntReg(core, rt_num, res);
         if (op1 == 0x11) {
-            SetCpuIntFlags(res);
+            SetCpuIntFlags(core, res);
         }
         break;
       }
@@ -229,9 +311,9 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // XORR (0x12): Bit-wise XOR of `ra` and `rb` operands.
         // XORF (0x13): The same as XORR, but sets the integer condition-flags.
         const uint32_t res = ra_val ^ rb_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, res, err));
+        SetIntReg(core, rt_num, res);
         if (op1 == 0x13) {
-            SetCpuIntFlags(res);
+            SetCpuIntFlags(core, res);
         }
         break;
       }
@@ -241,9 +323,9 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // ADDR (0x14): Addition of `ra` and `rb` operands.
         // ADDF (0x15): The same as ADDR, but sets the integer condition-flags.
         const int64_t ext_prec_val = (int64_t)ra_val + (int64_t)rb_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, ext_prec_val & 0xFFFFFFFFU, err));
+        SetIntReg(core, rt_num, ext_prec_val & 0xFFFFFFFFU);
         if (op1 == 0x15) {
-            SetCpuIntFlags(ext_prec_val);
+            SetCpuIntFlags(core, ext_prec_val);
         }
         break;
       }
@@ -253,9 +335,9 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         // SUBR (0x16): Subtraction of `ra` and `rb` operands.
         // SUBF (0x17): The same as SUBR, but sets the integer condition-flags.
         const int64_t ext_prec_val = (int64_t)ra_val - (int64_t)rb_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, ext_prec_val & 0xFFFFFFFFU, err));
+        SetIntReg(core, rt_num, ext_prec_val & 0xFFFFFFFFU);
         if (op1 == 0x17) {
-            SetCpuIntFlags(ext_prec_val);
+            SetCpuIntFlags(core, ext_prec_val);
         }
         break;
       }
@@ -264,11 +346,11 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
       case 0x19: {
         // MULR (0x18): Multiplication of `ra` and `rb` operands.
         // MULF (0x19): The same as MULR, but sets the integer condition-flags.
-        const int64_t ext_prec_val = (int64_t)ra_val * (int64_t)rb_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, ext_prec_val & 0xFFFFFFFFU, err));
-        CuSetExtPrecReg((ext_prec_val & 0xFFFFFFFF00000000U) >> 32);
+        const uint64_t ext_prec_val = (uint64_t)ra_val * (uint64_t)rb_val;
+        SetIntReg(core, rt_num, ext_prec_val & 0xFFFFFFFFU);
+        core->epr = (ext_prec_val & 0xFFFFFFFF00000000U) >> 32;
         if (op1 == 0x19) {
-            SetCpuIntFlags(ext_prec_val);
+            SetCpuIntFlags(core, ext_prec_val);
         }
         break;
       }
@@ -277,27 +359,30 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
       case 0x1b: {
         // DIVR (0x1a): Division of `ep`:`ra` by `rb`.
         // DIVF (0x1b): The same as DIVR, but sets the integer condition-flags.
-        int64_t epra = CuGetExtPrecReg();
-        epra <<= 32;
-        epra |= ra_val;
+        if (rb_val == 0) {
+            return CuErrMsg(err, "Division by zero (pc=%08" PRIx32 ").", pc);
+        }
+        // The dividend `ep`:`ra` is taken as a signed 64-bit number.
+        const int64_t epra = (int64_t)(((uint64_t)core->epr << 32) |
+          ra_val);
         const int64_t ext_prec_val = epra / (int64_t)rb_val;
-        RET_ON_ERR(CuSetIntReg(rt_num, ext_prec_val & 0xFFFFFFFFU, err));
-        CuSetExtPrecReg(epra % (int64_t)rb_val);
+        SetIntReg(core, rt_num, ext_prec_val & 0xFFFFFFFFU);
+        core->epr = epra % (int64_t)rb_val;
         if (op1 == 0x1b) {
-            SetCpuIntFlags(ext_prec_val);
+            SetCpuIntFlags(core, ext_prec_val);
         }
         break;
       }
 
       case 0x1c: {
         // RDEP (0x1c): Read `ep` into `rt`.
-        RET_ON_ERR(CuSetIntReg(rt_num, CuGetExtPrecReg(), err));
+        SetIntReg(core, rt_num, core->epr);
         break;
       }
 
       case 0x1d: {
         // WREP (0x1d): Write `ep` using `ra`.
-        CuSetExtPrecReg(ra_val);
+        core->epr = ra_val;
         break;
       }
 
@@ -309,9 +394,23 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
         res <<= GET_IMM5(insn);
         res += ra_val;  // Wrap-around semantics with over-/under-flow.
         if (op1 == 0x1f) {
-            RET_ON_ERR(CuSetIntReg(LINK_REG_NUM, NEXT_PC(pc), err));
+            SetIntReg(core, LINK_REG_NUM, NEXT_PC(pc));
         }
         new_pc = res;
+        CuTimTakenBranch(&core->tim);
+        break;
+      }
+
+      case 0x20: {
+        // RDCI (0x20): Read the index of this core (from zero onwards) into
+        // `rt`.
+        SetIntReg(core, rt_num, core->id);
+        break;
+      }
+
+      case 0x21: {
+        // RDCN (0x21): Read the number of cores into `rt`.
+        SetIntReg(core, rt_num, (uint32_t)CuGetNumCores());
         break;
       }
 
@@ -321,17 +420,16 @@ static bool CuExecOp0x00(uint32_t pc, uint32_t insn, CuError* restrict err) {
       }
     }
 
-    RET_ON_ERR(CuSetProgCtr(new_pc, err));
+    RET_ON_ERR(SetProgCtr(core, new_pc, err));
     return true;
 }
 
 // ANDI (0x01): Bit-wise AND of `ra` with a zero-extended 16-bit immediate.
 // ORRI (0x02): Bit-wise OR of `ra` with a zero-extended 16-bit immediate.
 // XORI (0x03): Bit-wise XOR of `ra` with a zero-extended 16-bit immediate.
-static bool CuExecBoolImmOps(uint32_t pc, uint32_t insn,
-  CuError* restrict err) {
-    uint32_t ra_val;
-    RET_ON_ERR(CuGetIntReg(GET_RA(insn), &ra_val, err));
+static bool CuExecBoolImmOps(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    const uint32_t ra_val = core->iregs[GET_RA(insn)];
 
     uint32_t res = GET_IMM16(insn);
     switch (GET_OP0(insn)) {
@@ -347,38 +445,40 @@ static bool CuExecBoolImmOps(uint32_t pc, uint32_t insn,
         res ^= ra_val;
         break;
     }
-    RET_ON_ERR(CuSetIntReg(GET_RT(insn), res, err));
-    SetCpuIntFlags(res);
+    SetIntReg(core, GET_RT(insn), res);
+    SetCpuIntFlags(core, res);
 
-    RET_ON_ERR(CuSetProgCtr(NEXT_PC(pc), err));
+    RET_ON_ERR(SetProgCtr(core, NEXT_PC(pc), err));
     return true;
 }
 
 // ADDI (0x04): Addition of `ra` with a sign-extended 16-bit immediate value.
-static bool CuExecAddImmOp(uint32_t pc, uint32_t insn, CuError* restrict err) {
-    uint32_t ra_val;
-    RET_ON_ERR(CuGetIntReg(GET_RA(insn), &ra_val, err));
+static bool CuExecAddImmOp(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    const uint32_t ra_val = core->iregs[GET_RA(insn)];
 
     int64_t ext_prec_val = GetSignExtImm16(insn);
     ext_prec_val += (int64_t)ra_val;
-    RET_ON_ERR(CuSetIntReg(GET_RT(insn), ext_prec_val & 0xFFFFFFFFU, err));
-    SetCpuIntFlags(ext_prec_val);
+    SetIntReg(core, GET_RT(insn), ext_prec_val & 0xFFFFFFFFU);
+    SetCpuIntFlags(core, ext_prec_val);
 
-    RET_ON_ERR(CuSetProgCtr(NEXT_PC(pc), err));
+    RET_ON_ERR(SetProgCtr(core, NEXT_PC(pc), err));
     return true;
 }
 
 // JMPI (0x05): Jump to a PC-relative address using a sign-extended 26-bit
 // immediate value taken as a word-address (giving a 28-bit reach).
 // JALI (0x06): Like JMPI above, but saves the return-address in `r31`.
-static bool CuExecJmpOps(uint32_t pc, uint32_t insn, CuError* restrict err) {
+static bool CuExecJmpOps(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
     uint32_t addr = GetSignExtImm26(insn);
     addr <<= 2;
     addr += pc;  // Wrap-around semantics with over-/under-flow.
     if (GET_OP0(insn) == 0x06) {
-        RET_ON_ERR(CuSetIntReg(LINK_REG_NUM, NEXT_PC(pc), err));
+        SetIntReg(core, LINK_REG_NUM, NEXT_PC(pc));
     }
-    RET_ON_ERR(CuSetProgCtr(addr, err));
+    RET_ON_ERR(SetProgCtr(core, addr, err));
+    CuTimTakenBranch(&core->tim);
     return true;
 }
 
@@ -387,10 +487,9 @@ static bool CuExecJmpOps(uint32_t pc, uint32_t insn, CuError* restrict err) {
 // BROR (0x08): Like BRNR, but for the `overflow` flag.
 // BRCR (0x09): Like BRNR, but for the `carry` flag.
 // BRZR (0x0a): Like BRNR, but for the `zero` flag.
-static bool CuExecFlagBranchOps(uint32_t pc, uint32_t insn,
-  CuError* restrict err) {
-    uint32_t rt_val;
-    RET_ON_ERR(CuGetIntReg(GET_RT(insn), &rt_val, err));
+static bool CuExecFlagBranchOps(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    const uint32_t rt_val = core->iregs[GET_RT(insn)];
 
     uint32_t addr = GetSignExtImm21(insn);
     addr <<= 2;
@@ -399,36 +498,36 @@ static bool CuExecFlagBranchOps(uint32_t pc, uint32_t insn,
     bool flag_set = false;
     switch (GET_OP0(insn)) {
       case 0x07:
-        flag_set = CuIsNegFlagSet();
+        flag_set = (core->psr & CU_PSR_NEG) != 0;
         break;
 
       case 0x08:
-        flag_set = CuIsOvfFlagSet();
+        flag_set = (core->psr & CU_PSR_OVF) != 0;
         break;
 
       case 0x09:
-        flag_set = CuIsCarFlagSet();
+        flag_set = (core->psr & CU_PSR_CAR) != 0;
         break;
 
       case 0x0a:
-        flag_set = CuIsZerFlagSet();
+        flag_set = (core->psr & CU_PSR_ZER) != 0;
         break;
     }
     const uint32_t new_pc = flag_set ?  addr : (NEXT_PC(pc));
-    RET_ON_ERR(CuSetProgCtr(new_pc, err));
+    RET_ON_ERR(SetProgCtr(core, new_pc, err));
+    if (flag_set) {
+        CuTimTakenBranch(&core->tim);
+    }
     return true;
 }
 
 // BRNE (0x0b): Jump to the PC-relative address at sign-extended `imm16` (taken
 // as a word-address) when `rt` != `ra`.
 // BRGT (0x0c): Like BRNE, but when `rt` > `ra`.
-static bool CuExecCmpBranchOps(uint32_t pc, uint32_t insn,
-  CuError* restrict err) {
-    uint32_t rt_val;
-    RET_ON_ERR(CuGetIntReg(GET_RT(insn), &rt_val, err));
-
-    uint32_t ra_val;
-    RET_ON_ERR(CuGetIntReg(GET_RA(insn), &ra_val, err));
+static bool CuExecCmpBranchOps(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    const uint32_t rt_val = core->iregs[GET_RT(insn)];
+    const uint32_t ra_val = core->iregs[GET_RA(insn)];
 
     uint32_t addr = GetSignExtImm16(insn);
     addr <<= 2;
@@ -445,15 +544,21 @@ static bool CuExecCmpBranchOps(uint32_t pc, uint32_t insn,
         break;
     }
     const uint32_t new_pc = cond_met ?  addr : (NEXT_PC(pc));
-    RET_ON_ERR(CuSetProgCtr(new_pc, err));
+    RET_ON_ERR(SetProgCtr(core, new_pc, err));
+    if (cond_met) {
+        CuTimTakenBranch(&core->tim);
+    }
     return true;
 }
 
-// LDUI (0x0d): Load the upper 16 bits of `rt` using `imm16` (`ra` is ignored).
-static bool CuExecLoadUpImmOp(uint32_t pc, uint32_t insn,
-  CuError* restrict err) {
-    RET_ON_ERR(CuSetIntReg(GET_RT(insn), GET_IMM16(insn) << 16, err));
-    RET_ON_ERR(CuSetProgCtr(NEXT_PC(pc), err));
+// LDUI (0x0d): Load the upper 16 bits of `rt` using `imm16` (`ra` is ignored),
+// leaving the lower 16 bits of `rt` intact.
+static bool CuExecLoadUpImmOp(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    uint32_t rt_val = core->iregs[GET_RT(insn)];
+    rt_val = (GET_IMM16(insn) << 16) | (rt_val & 0x0000FFFFU);
+    SetIntReg(core, GET_RT(insn), rt_val);
+    RET_ON_ERR(SetProgCtr(core, NEXT_PC(pc), err));
     return true;
 }
 
@@ -462,25 +567,30 @@ static bool CuExecLoadUpImmOp(uint32_t pc, uint32_t insn,
 // LDHU (0x10): Like LDHS, but for a half-word without sign-extension.
 // LDBS (0x11): Like LDWD, but for a sign-extended single byte.
 // LDBU (0x12): Like LDBS, but for a byte without sign-extension.
-static bool CuExecLoadMemOps(uint32_t pc, uint32_t insn,
-  CuError* restrict err) {
-    uint32_t ra_val;
-    RET_ON_ERR(CuGetIntReg(GET_RA(insn), &ra_val, err));
+static bool CuExecLoadMemOps(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    const uint32_t ra_val = core->iregs[GET_RA(insn)];
     // Wrap-around semantics with over-/under-flow.
     const uint32_t addr = ra_val + GetSignExtImm16(insn);
 
-    uint32_t rt_val;
+    uint32_t rt_val = 0U;
     const uint8_t op0 = GET_OP0(insn);
     switch (op0) {
       case 0x0e: {
-        RET_ON_ERR(CuGetWordAt(addr, &rt_val, err));
+        RET_ON_ERR(LoadWord(core, addr, &rt_val, err));
+        if (addr & 0x00000003U) {
+            CuTimUnalignedAccess(&core->tim);
+        }
         break;
       }
 
       case 0x0f:
       case 0x10: {
         uint16_t hw;
-        RET_ON_ERR(CuGetHalfWordAt(addr, &hw, err));
+        RET_ON_ERR(LoadHalfWord(core, addr, &hw, err));
+        if (addr & 0x00000001U) {
+            CuTimUnalignedAccess(&core->tim);
+        }
         rt_val = (uint32_t)hw;
         if (op0 == 0x0f && (hw & 0x8000U)) {
             rt_val |= 0xFFFF0000U;
@@ -493,7 +603,7 @@ static bool CuExecLoadMemOps(uint32_t pc, uint32_t insn,
       case 0x11:
       case 0x12: {
         uint8_t b;
-        RET_ON_ERR(CuGetByteAt(addr, &b, err));
+        RET_ON_ERR(LoadByte(core, addr, &b, err));
         rt_val = (uint32_t)b;
         if (op0 == 0x11 && (b & 0x80U)) {
             rt_val |= 0xFFFFFF00U;
@@ -503,114 +613,128 @@ static bool CuExecLoadMemOps(uint32_t pc, uint32_t insn,
         break;
       }
     }
-    RET_ON_ERR(CuSetIntReg(GET_RT(insn), rt_val, err));
-    RET_ON_ERR(CuSetProgCtr(NEXT_PC(pc), err));
+    SetIntReg(core, GET_RT(insn), rt_val);
+    RET_ON_ERR(SetProgCtr(core, NEXT_PC(pc), err));
     return true;
 }
 
 // STWD (0x13): Store the word in `rt` into memory at `ra` + sign_ext(`imm16`).
 // STHW (0x14): Like STWD, but store a half-word (16 LSBs).
 // STSB (0x15): Like STWD, but store a single byte (8 LSBs).
-static bool CuExecStoreMemOps(uint32_t pc, uint32_t insn,
-  CuError* restrict err) {
-    uint32_t ra_val;
-    RET_ON_ERR(CuGetIntReg(GET_RA(insn), &ra_val, err));
+static bool CuExecStoreMemOps(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    uint32_t nbytes = 1U;
+    const uint32_t ra_val = core->iregs[GET_RA(insn)];
     // Wrap-around semantics with over-/under-flow.
     const uint32_t addr = ra_val + GetSignExtImm16(insn);
 
-    uint32_t rt_val;
-    RET_ON_ERR(CuGetIntReg(GET_RT(insn), &rt_val, err));
+    const uint32_t rt_val = core->iregs[GET_RT(insn)];
 
     switch (GET_OP0(insn)) {
       case 0x13:
-        RET_ON_ERR(CuSetWordAt(addr, rt_val, err));
+        RET_ON_ERR(StoreWord(core, addr, rt_val, err));
+        nbytes = 4U;
+        if (addr & 0x00000003U) {
+            CuTimUnalignedAccess(&core->tim);
+        }
         break;
 
       case 0x14:
-        RET_ON_ERR(CuSetHalfWordAt(addr, rt_val & 0x0000FFFFU, err));
+        RET_ON_ERR(StoreHalfWord(core, addr,
+          (uint16_t)(rt_val & 0x0000FFFFU), err));
+        nbytes = 2U;
+        if (addr & 0x00000001U) {
+            CuTimUnalignedAccess(&core->tim);
+        }
         break;
 
       case 0x15:
-        RET_ON_ERR(CuSetByteAt(addr, rt_val & 0x000000FFU, err));
+        RET_ON_ERR(StoreByte(core, addr, (uint8_t)(rt_val & 0x000000FFU),
+          err));
         break;
     }
+    if (store_hook != NULL && core->sbuf == NULL) {
+        store_hook(core, addr, nbytes);
+    }
 
-    RET_ON_ERR(CuSetProgCtr(NEXT_PC(pc), err));
+    RET_ON_ERR(SetProgCtr(core, NEXT_PC(pc), err));
     return true;
 }
 
-void CuInitOps(void) {
-    cup_op_executors[0x00] = CuExecOp0x00;
-
-    cup_op_executors[0x01] = CuExecBoolImmOps;
-    cup_op_executors[0x02] = CuExecBoolImmOps;
-    cup_op_executors[0x03] = CuExecBoolImmOps;
-    cup_op_executors[0x04] = CuExecAddImmOp;
-    cup_op_executors[0x05] = CuExecJmpOps;
-    cup_op_executors[0x06] = CuExecJmpOps;
-    cup_op_executors[0x07] = CuExecFlagBranchOps;
-    cup_op_executors[0x08] = CuExecFlagBranchOps;
-    cup_op_executors[0x09] = CuExecFlagBranchOps;
-    cup_op_executors[0x0a] = CuExecFlagBranchOps;
-    cup_op_executors[0x0b] = CuExecCmpBranchOps;
-    cup_op_executors[0x0c] = CuExecCmpBranchOps;
-    cup_op_executors[0x0d] = CuExecLoadUpImmOp;
-    cup_op_executors[0x0e] = CuExecLoadMemOps;
-    cup_op_executors[0x0f] = CuExecLoadMemOps;
-    cup_op_executors[0x10] = CuExecLoadMemOps;
-    cup_op_executors[0x11] = CuExecLoadMemOps;
-    cup_op_executors[0x12] = CuExecLoadMemOps;
-    cup_op_executors[0x13] = CuExecStoreMemOps;
-    cup_op_executors[0x14] = CuExecStoreMemOps;
-    cup_op_executors[0x15] = CuExecStoreMemOps;
+// LDLW (0x16): Atomically load the aligned word at `ra` + sign_ext(`imm16`)
+// into `rt`, reserving the word along with the value loaded.
+// STCW (0x17): Atomically store the word in `rt` into memory at `ra` +
+// sign_ext(`imm16`), only if this core still has a reservation for that word
+// and the word still holds the value loaded by the LDLW, then set `rt` to 1 if
+// the word was stored and to 0 otherwise. The reservation is lost either way.
+//
+// Both are full memory-barriers, like FENC (see "doc/cup.md").
+static bool CuExecAtomicMemOps(CuCore* restrict core, uint32_t pc,
+  uint32_t insn, CuError* restrict err) {
+    const uint32_t ra_val = core->iregs[GET_RA(insn)];
+    // Wrap-around semantics with over-/under-flow.
+    const uint32_t addr = ra_val + GetSignExtImm16(insn);
 
+    const uint8_t rt_num = GET_RT(insn);
+    uint32_t rt_val;
+    if (GET_OP0(insn) == 0x16) {
+        RET_ON_ERR(CuGetWordAtomicAt(addr, &rt_val, err));
+        core->resv_valid = true;
+        core->resv_addr = addr;
+        core->resv_val = rt_val;
+    } else {
+        bool stored = false;
+        if (core->resv_valid && core->resv_addr == addr) {
+            RET_ON_ERR(CuCasWordAt(addr, core->resv_val, core->iregs[rt_num],
+              &stored, err));
+        } else {
+            // Still check the address and act as a memory-barrier.
+            RET_ON_ERR(CuGetWordAtomicAt(addr, &rt_val, err));
+        }
+        core->resv_valid = false;
+        if (stored && store_hook != NULL) {
+            store_hook(core, addr, 4U);
+        }
+        rt_val = stored ? 1U : 0U;
+    }
+    SetIntReg(core, rt_num, rt_val);
+
+    RET_ON_ERR(SetProgCtr(core, NEXT_PC(pc), err));
+    return true;
+}
+
+// FENC (0x18): A full memory-barrier (see "doc/cup.md").
+static bool CuExecFenceOp(CuCore* restrict core, uint32_t pc, uint32_t insn,
+  CuError* restrict err) {
+    (void)insn;  // Suppress unused parameter warning.
+    CuMemFence();
+    RET_ON_ERR(SetProgCtr(core, NEXT_PC(pc), err));
+    return true;
+}
+
+bool CuIsSyncOp(uint32_t insn) {
+    const uint8_t op0 = GET_OP0(insn);
+    return op0 == 0x16 || op0 == 0x17 || op0 == 0x18;
+}
+
+void CuSetStoreHook(CuStoreHookFn hook) {
+    store_hook = hook;
+}
+
+void CuInitOps(void) {
     // TODO: Define and implement the rest of the ISA.
-    cup_op_executors[0x16] = CuExecBadOp0xNN;
-    cup_op_executors[0x17] = CuExecBadOp0xNN;
-    cup_op_executors[0x18] = CuExecBadOp0xNN;
-    cup_op_executors[0x19] = CuExecBadOp0xNN;
-    cup_op_executors[0x1a] = CuExecBadOp0xNN;
-    cup_op_executors[0x1b] = CuExecBadOp0xNN;
-    cup_op_executors[0x1c] = CuExecBadOp0xNN;
-    cup_op_executors[0x1d] = CuExecBadOp0xNN;
-    cup_op_executors[0x1e] = CuExecBadOp0xNN;
-    cup_op_executors[0x1f] = CuExecBadOp0xNN;
-    cup_op_executors[0x20] = CuExecBadOp0xNN;
-    cup_op_executors[0x21] = CuExecBadOp0xNN;
-    cup_op_executors[0x22] = CuExecBadOp0xNN;
-    cup_op_executors[0x23] = CuExecBadOp0xNN;
-    cup_op_executors[0x24] = CuExecBadOp0xNN;
-    cup_op_executors[0x25] = CuExecBadOp0xNN;
-    cup_op_executors[0x26] = CuExecBadOp0xNN;
-    cup_op_executors[0x27] = CuExecBadOp0xNN;
-    cup_op_executors[0x28] = CuExecBadOp0xNN;
-    cup_op_executors[0x29] = CuExecBadOp0xNN;
-    cup_op_executors[0x2a] = CuExecBadOp0xNN;
-    cup_op_executors[0x2b] = CuExecBadOp0xNN;
-    cup_op_executors[0x2c] = CuExecBadOp0xNN;
-    cup_op_executors[0x2d] = CuExecBadOp0xNN;
-    cup_op_executors[0x2e] = CuExecBadOp0xNN;
-    cup_op_executors[0x2f] = CuExecBadOp0xNN;
-    cup_op_executors[0x30] = CuExecBadOp0xNN;
-    cup_op_executors[0x31] = CuExecBadOp0xNN;
-    cup_op_executors[0x32] = CuExecBadOp0xNN;
-    cup_op_executors[0x33] = CuExecBadOp0xNN;
-    cup_op_executors[0x34] = CuExecBadOp0xNN;
-    cup_op_executors[0x35] = CuExecBadOp0xNN;
-    cup_op_executors[0x36] = CuExecBadOp0xNN;
-    cup_op_executors[0x37] = CuExecBadOp0xNN;
-    cup_op_executors[0x38] = CuExecBadOp0xNN;
-    cup_op_executors[0x39] = CuExecBadOp0xNN;
-    cup_op_executors[0x3a] = CuExecBadOp0xNN;
-    cup_op_executors[0x3b] = CuExecBadOp0xNN;
-    cup_op_executors[0x3c] = CuExecBadOp0xNN;
-    cup_op_executors[0x3d] = CuExecBadOp0xNN;
-    cup_op_executors[0x3e] = CuExecBadOp0xNN;
-    cup_op_executors[0x3f] = CuExecBadOp0xNN;
+    for (int i = 0; i < NUM_OP0S; i++) {
+        cup_op_executors[i] = CuExecBadOp0xNN;
+    }
+
+#define SET_OP0_EXECUTOR(op0, mnem, fmt, exec) \
+    cup_op_executors[op0] = CuExec##exec;
+    CU_OP0_LIST(SET_OP0_EXECUTOR)
+#undef SET_OP0_EXECUTOR
 }
 
-bool CuExecOp(uint32_t pc, uint32_t insn, CuError* restrict err) {
+bool CuExecOp(CuCore* restrict core, uint32_t insn, CuError* restrict err) {
     const uint8_t op0 = GET_OP0(insn);
-    RET_ON_ERR(cup_op_executors[op0](pc, insn, err));
+    RET_ON_ERR(cup_op_executors[op0](core, core->pc, insn, err));
     return true;
 }
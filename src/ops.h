@@ -6,10 +6,26 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "cpu.h"
 #include "errors.h"
 
 extern void CuInitOps(void);
 
-extern bool CuExecOp(uint32_t pc, uint32_t insn, CuError* restrict err);
+// The type of a function called after every store to memory by an instruction,
+// with the core that executed it, the address, and the number of bytes stored.
+typedef void (*CuStoreHookFn)(CuCore* restrict core, uint32_t addr,
+  uint32_t nbytes);
+
+// Set (or clear, with NULL) the function called after every store to memory.
+extern void CuSetStoreHook(CuStoreHookFn hook);
+
+// Whether `insn` synchronizes with other cores (LDLW, STCW, and FENC), which
+// the deterministic scheduler only executes between quanta. These always
+// access memory directly, never through the store-buffer of a core.
+extern bool CuIsSyncOp(uint32_t insn);
+
+// Execute `insn` at the program-counter of `core`.
+extern bool CuExecOp(CuCore* restrict core, uint32_t insn,
+  CuError* restrict err);
 
 #endif  // CUSS_OPS_INCLUDED
@@ -0,0 +1,253 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "pipeline.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "timing.h"
+
+// A simple model of a classic five-stage (IF, ID, EX, MEM, WB) in-order
+// pipeline with full forwarding and no branch-prediction, fed with the stream
+// of instructions retired by the functional executor. Instead of simulating
+// each stage every cycle, it only tracks the cycle in which the next
+// instruction can enter the EX stage, when the EX stage next becomes free, and
+// when the value of each register can next be forwarded to the EX stage.
+
+// Extract the `op0`, and `op1` fields from an instruction.
+#define GET_OP0(insn) (uint8_t)(((insn & 0xFC000000U) >> 26) & 0x0000003FU)
+#define GET_OP1(insn) (uint8_t)((insn) & 0x0000003FU)
+
+// Extract the `rt`, `ra`, and `rb` fields from an instruction.
+#define GET_RT(insn) (uint8_t)(((insn & 0x03E00000U) >> 21) & 0x0000001FU)
+#define GET_RA(insn) (uint8_t)(((insn & 0x001F0000U) >> 16) & 0x0000001FU)
+#define GET_RB(insn) (uint8_t)(((insn & 0x0000F800U) >> 11) & 0x0000001FU)
+
+// The register used to establish linkage across procedure-calls.
+#define LINK_REG_NUM 31
+
+// Pseudo-register numbers for the `ep` and `psr` registers, which take part in
+// data-dependencies just like the general-purpose integer registers.
+#define EP_REG_NUM 32
+#define PSR_REG_NUM 33
+#define NUM_DEP_REGS 34
+
+// Sentinel-value for an unused register-operand (`r0` never causes a stall).
+#define NO_REG 0
+
+// The number of cycles needed to fetch and decode an instruction before it can
+// enter the EX stage.
+#define FRONT_END_CYCLES 2U
+
+// The number of cycles needed after EX for the MEM and WB stages.
+#define BACK_END_CYCLES 2U
+
+// The number of wrong-path instructions flushed when a jump or a branch is
+// taken, since these are only resolved at the end of the EX stage.
+#define TAKEN_BRANCH_BUBBLES 2U
+
+// How an instruction uses the pipeline.
+typedef struct PipeOp {
+    uint8_t srcs[3];
+    uint8_t dsts[2];
+    bool sets_flags;
+    bool is_load;
+    bool is_muldiv;
+    bool is_ctl_flow;
+} PipeOp;
+
+// The cycle in which the next instruction can enter the EX stage at the
+// earliest, only considering in-order issue and branch-bubbles.
+static uint64_t next_ex_cycle = 0;
+// The cycle in which the EX stage becomes free for the next instruction.
+static uint64_t ex_free_cycle = 0;
+// The cycle in which the value of a register can be forwarded to EX.
+static uint64_t reg_ready_cycle[NUM_DEP_REGS];
+
+static CuPipeStats pipe_stats;
+
+static const char* const stall_reason_names[CU_PIPE_NUM_STALL_REASONS] = {
+    "data-hazard",
+    "mul/div-busy",
+    "branch-bubble",
+};
+
+void CuPipeInit(void) {
+    next_ex_cycle = FRONT_END_CYCLES;
+    ex_free_cycle = 0;
+    for (int i = 0; i < NUM_DEP_REGS; i++) {
+        reg_ready_cycle[i] = 0;
+    }
+    pipe_stats.insns = 0;
+    pipe_stats.cycles = 0;
+    for (int i = 0; i < CU_PIPE_NUM_STALL_REASONS; i++) {
+        pipe_stats.stalls[i] = 0;
+    }
+}
+
+static void DecodePipeOp(uint32_t insn, PipeOp* restrict op) {
+    const uint8_t op0 = GET_OP0(insn);
+    const uint8_t rt = GET_RT(insn);
+    const uint8_t ra = GET_RA(insn);
+    const uint8_t rb = GET_RB(insn);
+
+    op->srcs[0] = NO_REG;
+    op->srcs[1] = NO_REG;
+    op->srcs[2] = NO_REG;
+    op->dsts[0] = NO_REG;
+    op->dsts[1] = NO_REG;
+    op->sets_flags = false;
+    op->is_load = false;
+    op->is_muldiv = false;
+    op->is_ctl_flow = false;
+
+    if (op0 == 0x00) {
+        const uint8_t op1 = GET_OP1(insn);
+        // Odd-numbered secondary op-codes (up to DIVF) set the flags.
+        op->sets_flags = (op1 & 0x01) && op1 <= 0x1b;
+        if (op1 <= 0x05 || (op1 >= 0x0c && op1 <= 0x0f) ||
+          (op1 >= 0x12 && op1 <= 0x17)) {
+            op->srcs[0] = ra;
+            op->srcs[1] = rb;
+            op->dsts[0] = rt;
+        } else if (op1 <= 0x0b || op1 == 0x10 || op1 == 0x11) {
+            op->srcs[0] = ra;
+            op->dsts[0] = rt;
+        } else if (op1 == 0x18 || op1 == 0x19) {
+            op->srcs[0] = ra;
+            op->srcs[1] = rb;
+            op->dsts[0] = rt;
+            op->dsts[1] = EP_REG_NUM;
+            op->is_muldiv = true;
+        } else if (op1 == 0x1a || op1 == 0x1b) {
+            op->srcs[0] = ra;
+            op->srcs[1] = rb;
+            op->srcs[2] = EP_REG_NUM;
+            op->dsts[0] = rt;
+            op->dsts[1] = EP_REG_NUM;
+            op->is_muldiv = true;
+        } else if (op1 == 0x1c) {
+            op->srcs[0] = EP_REG_NUM;
+            op->dsts[0] = rt;
+        } else if (op1 == 0x1d) {
+            op->srcs[0] = ra;
+            op->dsts[0] = EP_REG_NUM;
+        } else if (op1 == 0x1e || op1 == 0x1f) {
+            op->srcs[0] = ra;
+            op->srcs[1] = rb;
+            op->dsts[0] = (op1 == 0x1f) ? LINK_REG_NUM : NO_REG;
+            op->is_ctl_flow = true;
+        } else if (op1 == 0x20 || op1 == 0x21) {
+            op->dsts[0] = rt;
+        }
+        return;
+    }
+
+    if (op0 <= 0x04) {
+        // ANDI, ORRI, XORI, and ADDI.
+        op->srcs[0] = ra;
+        op->dsts[0] = rt;
+        op->sets_flags = true;
+    } else if (op0 == 0x05 || op0 == 0x06) {
+        // JMPI and JALI.
+        op->dsts[0] = (op0 == 0x06) ? LINK_REG_NUM : NO_REG;
+        op->is_ctl_flow = true;
+    } else if (op0 <= 0x0a) {
+        // BRNR, BROR, BRCR, and BRZR.
+        op->srcs[0] = rt;
+        op->srcs[1] = PSR_REG_NUM;
+        op->is_ctl_flow = true;
+    } else if (op0 <= 0x0c) {
+        // BRNE and BRGT.
+        op->srcs[0] = rt;
+        op->srcs[1] = ra;
+        op->is_ctl_flow = true;
+    } else if (op0 == 0x0d) {
+        // LDUI.
+        op->srcs[0] = rt;
+        op->dsts[0] = rt;
+    } else if (op0 <= 0x12) {
+        // LDWD, LDHS, LDHU, LDBS, and LDBU.
+        op->srcs[0] = ra;
+        op->dsts[0] = rt;
+        op->is_load = true;
+    } else if (op0 <= 0x15) {
+        // STWD, STHW, and STSB.
+        op->srcs[0] = ra;
+        op->srcs[1] = rt;
+    } else if (op0 == 0x16) {
+        // LDLW.
+        op->srcs[0] = ra;
+        op->dsts[0] = rt;
+        op->is_load = true;
+    } else if (op0 == 0x17) {
+        // STCW, which also writes its success into `rt` after the access.
+        op->srcs[0] = ra;
+        op->srcs[1] = rt;
+        op->dsts[0] = rt;
+        op->is_load = true;
+    }
+}
+
+void CuPipeIssue(uint32_t pc, uint32_t insn, uint32_t next_pc) {
+    PipeOp op;
+    DecodePipeOp(insn, &op);
+
+    // Wait for the EX stage to be vacated by a multi-cycle instruction.
+    uint64_t ex_cycle = next_ex_cycle;
+    if (ex_free_cycle > ex_cycle) {
+        pipe_stats.stalls[CU_PIPE_STALL_MULDIV] += ex_free_cycle - ex_cycle;
+        ex_cycle = ex_free_cycle;
+    }
+
+    // Wait for the source-operands to be available for forwarding.
+    uint64_t srcs_ready_cycle = 0;
+    for (int i = 0; i < 3; i++) {
+        const uint8_t src = op.srcs[i];
+        if (src != NO_REG && reg_ready_cycle[src] > srcs_ready_cycle) {
+            srcs_ready_cycle = reg_ready_cycle[src];
+        }
+    }
+    if (srcs_ready_cycle > ex_cycle) {
+        pipe_stats.stalls[CU_PIPE_STALL_DATA] += srcs_ready_cycle - ex_cycle;
+        ex_cycle = srcs_ready_cycle;
+    }
+
+    const uint64_t ex_cycles = op.is_muldiv ? CuTimGetOpCycles(insn) : 1U;
+    ex_free_cycle = ex_cycle + ex_cycles;
+
+    // Results from EX can be forwarded as soon as EX is done, while loaded
+    // values are only available after MEM.
+    const uint64_t res_ready_cycle = ex_free_cycle + (op.is_load ? 1U : 0U);
+    for (int i = 0; i < 2; i++) {
+        if (op.dsts[i] != NO_REG) {
+            reg_ready_cycle[op.dsts[i]] = res_ready_cycle;
+        }
+    }
+    if (op.sets_flags) {
+        reg_ready_cycle[PSR_REG_NUM] = res_ready_cycle;
+    }
+
+    next_ex_cycle = ex_cycle + 1U;
+    if (op.is_ctl_flow && next_pc != pc + sizeof(uint32_t)) {
+        pipe_stats.stalls[CU_PIPE_STALL_BRANCH] += TAKEN_BRANCH_BUBBLES;
+        next_ex_cycle = ex_free_cycle + TAKEN_BRANCH_BUBBLES;
+    }
+
+    pipe_stats.insns++;
+    pipe_stats.cycles = ex_free_cycle + BACK_END_CYCLES;
+}
+
+void CuPipeGetStats(CuPipeStats* restrict stats) {
+    if (stats == NULL) {
+        return;
+    }
+    *stats = pipe_stats;
+}
+
+const char* CuPipeStallReasonName(CuPipeStallReason reason) {
+    if (reason >= CU_PIPE_NUM_STALL_REASONS) {
+        return "unknown";
+    }
+    return stall_reason_names[reason];
+}
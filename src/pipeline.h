@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_PIPELINE_INCLUDED
+#define CUSS_PIPELINE_INCLUDED
+
+#include <stdint.h>
+
+// Reasons for an instruction to stall in the pipeline-model.
+typedef enum {
+    CU_PIPE_STALL_DATA = 0,
+    CU_PIPE_STALL_MULDIV,
+    CU_PIPE_STALL_BRANCH,
+    CU_PIPE_NUM_STALL_REASONS,
+} CuPipeStallReason;
+
+// A snapshot of the statistics gathered by the pipeline-model.
+typedef struct CuPipeStats {
+    uint64_t insns;
+    uint64_t cycles;
+    uint64_t stalls[CU_PIPE_NUM_STALL_REASONS];
+} CuPipeStats;
+
+extern void CuPipeInit(void);
+
+extern void CuPipeIssue(uint32_t pc, uint32_t insn, uint32_t next_pc);
+
+extern void CuPipeGetStats(CuPipeStats* restrict stats);
+extern const char* CuPipeStallReasonName(CuPipeStallReason reason);
+
+#endif  // CUSS_PIPELINE_INCLUDED
@@ -0,0 +1,328 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "refcup.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "memory.h"
+
+// A deliberately-simple reference-model of the CUP semantics described in
+// "doc/cup.md", written independently of "ops.c" (and without any regard for
+// performance) to cross-check the executor. Where the document is silent, it
+// follows the conventions documented in "ops.c":
+//
+//   * Flags are derived from the 64-bit extended-precision result of an
+//     operation and are only ever set (never cleared) by instructions.
+//   * Branch and jump offsets are word-addresses.
+//   * The dividend `ep`:`ra` for DIVR/DIVF is a signed 64-bit number.
+//
+// It models a single core, so RDCI and RDCN read 0 and 1, and STCW only fails
+// for want of a matching reservation.
+
+#define LINK_REG 31
+
+static uint32_t SgnExt(uint32_t val, int bits) {
+    const uint32_t sign = 1U << (bits - 1);
+    val &= (sign << 1) - 1U;
+    return (val ^ sign) - sign;
+}
+
+static void SetFlags(CuRefCup* restrict ref, uint64_t res) {
+    if (res & 0x80000000U) {
+        ref->neg = true;
+    }
+    if (res >> 32) {
+        ref->ovf = true;
+    }
+    if ((res >> 32) & 0x1U) {
+        ref->car = true;
+    }
+    if ((res & 0xFFFFFFFFU) == 0) {
+        ref->zer = true;
+    }
+}
+
+static void SetReg(CuRefCup* restrict ref, uint32_t r, uint32_t val) {
+    if (r != 0) {
+        ref->iregs[r] = val;
+    }
+}
+
+static bool IsValidRange(const CuRefCup* restrict ref, uint32_t addr,
+  uint32_t n) {
+    return addr < ref->mem_size && n <= ref->mem_size - addr;
+}
+
+static bool Load(CuRefCup* restrict ref, uint32_t addr, uint32_t n,
+  uint32_t* restrict val, CuError* restrict err) {
+    if (!IsValidRange(ref, addr, n)) {
+        return CuErrMsg(err, "Bad load-address (0x%08" PRIx32 ").", addr);
+    }
+    *val = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        *val |= (uint32_t)ref->mem[addr + i] << (8 * i);
+    }
+    return true;
+}
+
+static bool Store(CuRefCup* restrict ref, uint32_t addr, uint32_t n,
+  uint32_t val, CuError* restrict err) {
+    if (!IsValidRange(ref, addr, n)) {
+        return CuErrMsg(err, "Bad store-address (0x%08" PRIx32 ").", addr);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        ref->mem[addr + i] = (uint8_t)(val >> (8 * i));
+        ref->dirty_pages[(addr + i) >> CU_MEM_PAGE_SHIFT] = true;
+    }
+    return true;
+}
+
+bool CuRefInit(CuRefCup* restrict ref, uint32_t mem_size,
+  CuError* restrict err) {
+    ref->mem = calloc(mem_size, sizeof(uint8_t));
+    ref->dirty_pages = calloc((mem_size >> CU_MEM_PAGE_SHIFT) + 1U,
+      sizeof(bool));
+    if (ref->mem == NULL || ref->dirty_pages == NULL) {
+        CuRefFree(ref);
+        return CuErrMsg(err, "Unable to allocate reference-memory.");
+    }
+    ref->mem_size = mem_size;
+    for (int i = 0; i < CU_NUM_IREGS; i++) {
+        ref->iregs[i] = 0;
+    }
+    ref->epr = 0;
+    ref->pc = 0;
+    ref->neg = ref->ovf = ref->car = ref->zer = false;
+    ref->resv_valid = false;
+    ref->resv_addr = 0;
+    ref->resv_val = 0;
+    return true;
+}
+
+void CuRefFree(CuRefCup* restrict ref) {
+    free(ref->mem);
+    free(ref->dirty_pages);
+    ref->mem = NULL;
+    ref->dirty_pages = NULL;
+    ref->mem_size = 0;
+}
+
+static bool StepOp0x00(CuRefCup* restrict ref, uint32_t insn,
+  uint32_t* restrict next_pc, CuError* restrict err) {
+    const uint32_t op1 = insn & 0x3FU;
+    const uint32_t rt = (insn >> 21) & 0x1FU;
+    const uint32_t a = ref->iregs[(insn >> 16) & 0x1FU];
+    const uint32_t b = ref->iregs[(insn >> 11) & 0x1FU];
+    const uint32_t imm5 = (insn >> 6) & 0x1FU;
+    const bool flags = (op1 & 0x01U) != 0;
+
+    uint64_t res = 0;
+    switch (op1) {
+      case 0x00: case 0x01:  // SLLR, SLRF
+        res = (uint32_t)(a << (b & 0x1FU));
+        break;
+      case 0x02: case 0x03:  // SRLR, SRRF
+        res = a >> (b & 0x1FU);
+        break;
+      case 0x04: case 0x05:  // SRAR, SRAS
+        res = (uint32_t)((int32_t)a >> (b & 0x1FU));
+        break;
+      case 0x06: case 0x07:  // SLLI, SLIF
+        res = (uint32_t)(a << imm5);
+        break;
+      case 0x08: case 0x09:  // SRLI, SRIF
+        res = a >> imm5;
+        break;
+      case 0x0a: case 0x0b:  // SRAI, SRAJ
+        res = (uint32_t)((int32_t)a >> imm5);
+        break;
+      case 0x0c: case 0x0d:  // ANDR, ADRF
+        res = a & b;
+        break;
+      case 0x0e: case 0x0f:  // ORRR, ORRF
+        res = a | b;
+        break;
+      case 0x10: case 0x11:  // NOTR, NOTF
+        res = (uint32_t)~a;
+        break;
+      case 0x12: case 0x13:  // XORR, XORF
+        res = a ^ b;
+        break;
+      case 0x14: case 0x15:  // ADDR, ADDF
+        res = (uint64_t)a + (uint64_t)b;
+        break;
+      case 0x16: case 0x17:  // SUBR, SUBF
+        res = (uint64_t)a - (uint64_t)b;
+        break;
+      case 0x18: case 0x19:  // MULR, MULF
+        res = (uint64_t)a * (uint64_t)b;
+        ref->epr = (uint32_t)(res >> 32);
+        break;
+      case 0x1a: case 0x1b: {  // DIVR, DIVF
+        if (b == 0) {
+            return CuErrMsg(err, "Division by zero.");
+        }
+        const int64_t dividend = (int64_t)(((uint64_t)ref->epr << 32) | a);
+        res = (uint64_t)(dividend / (int64_t)b);
+        ref->epr = (uint32_t)(dividend % (int64_t)b);
+        break;
+      }
+      case 0x1c:  // RDEP
+        SetReg(ref, rt, ref->epr);
+        return true;
+      case 0x1d:  // WREP
+        ref->epr = a;
+        return true;
+      case 0x1e: case 0x1f:  // JMPR, JALR
+        if (op1 == 0x1f) {
+            SetReg(ref, LINK_REG, ref->pc + 4U);
+        }
+        *next_pc = a + (b << imm5);
+        return true;
+      case 0x20:  // RDCI
+        SetReg(ref, rt, 0U);
+        return true;
+      case 0x21:  // RDCN
+        SetReg(ref, rt, 1U);
+        return true;
+      default:
+        return CuErrMsg(err, "Bad instruction (op1=%02" PRIx32 ").", op1);
+    }
+    SetReg(ref, rt, (uint32_t)res);
+    if (flags) {
+        SetFlags(ref, res);
+    }
+    return true;
+}
+
+bool CuRefStep(CuRefCup* restrict ref, CuError* restrict err) {
+    if (ref->pc & 0x3U) {
+        return CuErrMsg(err, "Unaligned PC (0x%08" PRIx32 ").", ref->pc);
+    }
+    uint32_t insn = 0;
+    RET_ON_ERR(Load(ref, ref->pc, 4U, &insn, err));
+
+    const uint32_t op0 = insn >> 26;
+    const uint32_t rt = (insn >> 21) & 0x1FU;
+    const uint32_t t = ref->iregs[rt];
+    const uint32_t a = ref->iregs[(insn >> 16) & 0x1FU];
+    const uint32_t imm16 = insn & 0xFFFFU;
+    const uint32_t ea = a + SgnExt(imm16, 16);
+
+    uint32_t next_pc = ref->pc + 4U;
+    uint32_t val = 0;
+    switch (op0) {
+      case 0x00:
+        RET_ON_ERR(StepOp0x00(ref, insn, &next_pc, err));
+        break;
+      case 0x01:  // ANDI
+        SetReg(ref, rt, a & imm16);
+        SetFlags(ref, a & imm16);
+        break;
+      case 0x02:  // ORRI
+        SetReg(ref, rt, a | imm16);
+        SetFlags(ref, a | imm16);
+        break;
+      case 0x03:  // XORI
+        SetReg(ref, rt, a ^ imm16);
+        SetFlags(ref, a ^ imm16);
+        break;
+      case 0x04: {  // ADDI
+        const uint64_t res = (uint64_t)a + (uint64_t)SgnExt(imm16, 16);
+        SetReg(ref, rt, (uint32_t)res);
+        SetFlags(ref, res);
+        break;
+      }
+      case 0x05: case 0x06:  // JMPI, JALI
+        if (op0 == 0x06) {
+            SetReg(ref, LINK_REG, ref->pc + 4U);
+        }
+        next_pc = ref->pc + (SgnExt(insn, 26) << 2);
+        break;
+      case 0x07: case 0x08: case 0x09: case 0x0a: {  // BRNR, BROR, BRCR, BRZR
+        const bool flag[] = {ref->neg, ref->ovf, ref->car, ref->zer};
+        if (flag[op0 - 0x07]) {
+            next_pc = t + (SgnExt(insn, 21) << 2);
+        }
+        break;
+      }
+      case 0x0b:  // BRNE
+        if (t != a) {
+            next_pc = ref->pc + (SgnExt(imm16, 16) << 2);
+        }
+        break;
+      case 0x0c:  // BRGT
+        if (t > a) {
+            next_pc = ref->pc + (SgnExt(imm16, 16) << 2);
+        }
+        break;
+      case 0x0d:  // LDUI
+        SetReg(ref, rt, (imm16 << 16) | (t & 0xFFFFU));
+        break;
+      case 0x0e:  // LDWD
+        RET_ON_ERR(Load(ref, ea, 4U, &val, err));
+        SetReg(ref, rt, val);
+        break;
+      case 0x0f:  // LDHS
+        RET_ON_ERR(Load(ref, ea, 2U, &val, err));
+        SetReg(ref, rt, SgnExt(val, 16));
+        break;
+      case 0x10:  // LDHU
+        RET_ON_ERR(Load(ref, ea, 2U, &val, err));
+        SetReg(ref, rt, val);
+        break;
+      case 0x11:  // LDBS
+        RET_ON_ERR(Load(ref, ea, 1U, &val, err));
+        SetReg(ref, rt, SgnExt(val, 8));
+        break;
+      case 0x12:  // LDBU
+        RET_ON_ERR(Load(ref, ea, 1U, &val, err));
+        SetReg(ref, rt, val);
+        break;
+      case 0x13:  // STWD
+        RET_ON_ERR(Store(ref, ea, 4U, t, err));
+        break;
+      case 0x14:  // STHW
+        RET_ON_ERR(Store(ref, ea, 2U, t, err));
+        break;
+      case 0x15:  // STSB
+        RET_ON_ERR(Store(ref, ea, 1U, t, err));
+        break;
+      case 0x16:  // LDLW
+        if (ea & 0x3U) {
+            return CuErrMsg(err, "Unaligned LDLW (0x%08" PRIx32 ").", ea);
+        }
+        RET_ON_ERR(Load(ref, ea, 4U, &val, err));
+        ref->resv_valid = true;
+        ref->resv_addr = ea;
+        ref->resv_val = val;
+        SetReg(ref, rt, val);
+        break;
+      case 0x17: {  // STCW
+        if (ea & 0x3U) {
+            return CuErrMsg(err, "Unaligned STCW (0x%08" PRIx32 ").", ea);
+        }
+        RET_ON_ERR(Load(ref, ea, 4U, &val, err));
+        const bool ok = ref->resv_valid && ref->resv_addr == ea &&
+          ref->resv_val == val;
+        if (ok) {
+            RET_ON_ERR(Store(ref, ea, 4U, t, err));
+        }
+        ref->resv_valid = false;
+        SetReg(ref, rt, ok ? 1U : 0U);
+        break;
+      }
+      case 0x18:  // FENC
+        break;
+      default:
+        return CuErrMsg(err, "Bad instruction (op0=%02" PRIx32 ").", op0);
+    }
+
+    if (next_pc >= ref->mem_size || (next_pc & 0x3U)) {
+        return CuErrMsg(err, "Bad jump-target (0x%08" PRIx32 ").", next_pc);
+    }
+    ref->pc = next_pc;
+    return true;
+}
@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_REFCUP_INCLUDED
+#define CUSS_REFCUP_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "errors.h"
+
+// The complete state of a CUP core and its memory in the reference-model.
+typedef struct CuRefCup {
+    uint32_t iregs[CU_NUM_IREGS];
+    uint32_t epr;
+    uint32_t pc;
+    bool neg;
+    bool ovf;
+    bool car;
+    bool zer;
+    // The reservation of the last LDLW, for STCW.
+    bool resv_valid;
+    uint32_t resv_addr;
+    uint32_t resv_val;
+    uint8_t* mem;
+    uint32_t mem_size;
+    // Whether each page of `mem` has been written to since the last reset.
+    bool* dirty_pages;
+} CuRefCup;
+
+extern bool CuRefInit(CuRefCup* restrict ref, uint32_t mem_size,
+  CuError* restrict err);
+extern void CuRefFree(CuRefCup* restrict ref);
+
+extern bool CuRefStep(CuRefCup* restrict ref, CuError* restrict err);
+
+#endif  // CUSS_REFCUP_INCLUDED
@@ -0,0 +1,253 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "sdldisp.h"
+
+#include "SDL_error.h"
+#include "SDL_pixels.h"
+#include "SDL_rect.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "memory.h"
+#include "sdltxt.h"
+
+// Every row of the frame-buffer is a page of memory, so the written pages are
+// the written rows.
+#if CU_FB_PITCH != CU_MEM_PAGE_SIZE
+#error "A row of the frame-buffer must fill a page of memory."
+#endif
+
+#if CU_TXT_SIZE % CU_MEM_PAGE_SIZE != 0
+#error "The cell-grid must fill whole pages of memory."
+#endif
+
+#define TXT_PAGES (CU_TXT_SIZE / CU_MEM_PAGE_SIZE)
+#define CELLS_PER_PAGE (CU_MEM_PAGE_SIZE / 2U)
+
+// The 16 colors of the CGA palette, as pixel-values of `txt_texture`.
+static const uint32_t cga_colors[16] = {
+    0x000000U, 0x0000aaU, 0x00aa00U, 0x00aaaaU,
+    0xaa0000U, 0xaa00aaU, 0xaa5500U, 0xaaaaaaU,
+    0x555555U, 0x5555ffU, 0x55ff55U, 0x55ffffU,
+    0xff5555U, 0xff55ffU, 0xffff55U, 0xffffffU,
+};
+
+static SDL_Texture* fb_texture = NULL;
+static SDL_Texture* txt_texture = NULL;
+
+// The display-mode as of the last update.
+static uint32_t disp_mode = CU_DISP_MODE_FB;
+
+// Whether every row (or cell) must be uploaded, as the texture holds nothing
+// yet.
+static bool fb_stale = true;
+static bool txt_stale = true;
+
+// Whether each row of the frame-buffer has been written to.
+static bool fb_written[CU_FB_HEIGHT];
+
+// The cells of the cell-grid as of the last update, the pixels they were
+// rasterized into, and whether each row of cells has been rasterized since it
+// was last uploaded.
+static uint16_t txt_shadow[CU_TXT_ROWS * CU_TXT_COLS];
+static uint32_t* txt_pixels = NULL;
+static int txt_width = 0;
+static int txt_height = 0;
+static bool txt_dirty_rows[CU_TXT_ROWS];
+
+bool CuSdlDispSetUp(SDL_Renderer* restrict renderer, CuError* restrict err) {
+    // The bytes of a pixel in memory are blue, green, red and unused, in that
+    // order, whatever the byte-order of the host.
+    fb_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_BGRA32,
+      SDL_TEXTUREACCESS_STREAMING, CU_FB_WIDTH, CU_FB_HEIGHT);
+    if (fb_texture == NULL) {
+        return CuErrMsg(err, "Unable to create display-texture: %s",
+          SDL_GetError());
+    }
+    SDL_SetTextureBlendMode(fb_texture, SDL_BLENDMODE_NONE);
+
+    // The cell-grid is rasterized on the host, in its own byte-order.
+    txt_width = (int)CU_TXT_COLS * CuSdlTxtWidth();
+    txt_height = (int)CU_TXT_ROWS * CuSdlTxtHeight();
+    txt_pixels = malloc((size_t)txt_width * (size_t)txt_height *
+      sizeof(uint32_t));
+    if (txt_pixels == NULL) {
+        return CuErrMsg(err, "Unable to allocate text-mode pixels.");
+    }
+    txt_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+      SDL_TEXTUREACCESS_STREAMING, txt_width, txt_height);
+    if (txt_texture == NULL) {
+        return CuErrMsg(err, "Unable to create text-mode texture: %s",
+          SDL_GetError());
+    }
+    SDL_SetTextureBlendMode(txt_texture, SDL_BLENDMODE_NONE);
+
+    disp_mode = CU_DISP_MODE_FB;
+    fb_stale = true;
+    txt_stale = true;
+    return true;
+}
+
+bool CuSdlDispTearDown(CuError* restrict err) {
+    (void)err;  // Suppress unused parameter warning.
+    if (fb_texture != NULL) {
+        SDL_DestroyTexture(fb_texture);
+    }
+    if (txt_texture != NULL) {
+        SDL_DestroyTexture(txt_texture);
+    }
+    free(txt_pixels);
+    fb_texture = NULL;
+    txt_texture = NULL;
+    txt_pixels = NULL;
+    return true;
+}
+
+// Copy the `num_rows` rows of the frame-buffer from `first_row` onwards into
+// the texture.
+static bool UploadFbRows(uint32_t first_row, uint32_t num_rows,
+  CuError* restrict err) {
+    const SDL_Rect rect = {
+        .x = 0, .y = (int)first_row, .w = CU_FB_WIDTH, .h = (int)num_rows,
+    };
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(fb_texture, &rect, &pixels, &pitch) != 0) {
+        return CuErrMsg(err, "Unable to lock display-texture: %s",
+          SDL_GetError());
+    }
+    CuError nerr;
+    for (uint32_t r = 0; r < num_rows; r++) {
+        if (!CuReadMemRange(CU_FB_BASE + (first_row + r) * CU_FB_PITCH,
+          CU_FB_PITCH, (uint8_t*)pixels + (size_t)r * (size_t)pitch, &nerr)) {
+            SDL_UnlockTexture(fb_texture);
+            return CuErrMsg(err, "Error reading frame-buffer: %s",
+              nerr.err_msg);
+        }
+    }
+    SDL_UnlockTexture(fb_texture);
+    return true;
+}
+
+static bool UpdateFb(bool* restrict updated, CuError* restrict err) {
+    CuTakeWrittenPages(CU_FB_BASE >> CU_MEM_PAGE_SHIFT, CU_FB_HEIGHT,
+      fb_written);
+
+    // Upload every run of written rows at once.
+    uint32_t r = 0;
+    while (r < CU_FB_HEIGHT) {
+        if (!fb_stale && !fb_written[r]) {
+            r++;
+            continue;
+        }
+        const uint32_t first_row = r;
+        while (r < CU_FB_HEIGHT && (fb_stale || fb_written[r])) {
+            r++;
+        }
+        RET_ON_ERR(UploadFbRows(first_row, r - first_row, err));
+        *updated = true;
+    }
+    fb_stale = false;
+    return true;
+}
+
+// Rasterize the cell `cell` at the index `idx` of the cell-grid.
+static void RasterizeCell(uint32_t idx, uint16_t cell) {
+    const uint32_t row = idx / CU_TXT_COLS;
+    const uint32_t col = idx % CU_TXT_COLS;
+    const uint8_t attr = (uint8_t)(cell >> 8);
+    uint32_t* pixels = txt_pixels +
+      (size_t)row * (size_t)CuSdlTxtHeight() * (size_t)txt_width +
+      (size_t)col * (size_t)CuSdlTxtWidth();
+    CuSdlTxtRenderGlyph(pixels, (size_t)txt_width, (uint8_t)(cell & 0xFFU),
+      cga_colors[attr & 0x0FU], cga_colors[attr >> 4]);
+    txt_dirty_rows[row] = true;
+}
+
+static bool UpdateText(bool* restrict updated, CuError* restrict err) {
+    // Only the pages of the cell-grid that have been written to can have
+    // changed cells, and only the cells that differ from the shadow-copy are
+    // rasterized again.
+    bool written[TXT_PAGES];
+    CuTakeWrittenPages(CU_TXT_BASE >> CU_MEM_PAGE_SHIFT, TXT_PAGES, written);
+    uint8_t cells[CU_MEM_PAGE_SIZE];
+    CuError nerr;
+    for (uint32_t p = 0; p < TXT_PAGES; p++) {
+        if (!txt_stale && !written[p]) {
+            continue;
+        }
+        if (!CuReadMemRange(CU_TXT_BASE + p * CU_MEM_PAGE_SIZE,
+          CU_MEM_PAGE_SIZE, cells, &nerr)) {
+            return CuErrMsg(err, "Error reading cell-grid: %s", nerr.err_msg);
+        }
+        for (uint32_t i = 0; i < CELLS_PER_PAGE; i++) {
+            const uint32_t idx = p * CELLS_PER_PAGE + i;
+            const uint16_t cell = (uint16_t)(cells[2U * i] |
+              (cells[2U * i + 1U] << 8));
+            if (txt_stale || cell != txt_shadow[idx]) {
+                txt_shadow[idx] = cell;
+                RasterizeCell(idx, cell);
+            }
+        }
+    }
+    txt_stale = false;
+
+    // Upload every run of rows of cells that were rasterized at once.
+    const int pitch = txt_width * (int)sizeof(uint32_t);
+    uint32_t r = 0;
+    while (r < CU_TXT_ROWS) {
+        if (!txt_dirty_rows[r]) {
+            r++;
+            continue;
+        }
+        const uint32_t first_row = r;
+        while (r < CU_TXT_ROWS && txt_dirty_rows[r]) {
+            txt_dirty_rows[r] = false;
+            r++;
+        }
+        const SDL_Rect rect = {
+            .x = 0, .y = (int)first_row * CuSdlTxtHeight(), .w = txt_width,
+            .h = (int)(r - first_row) * CuSdlTxtHeight(),
+        };
+        const uint32_t* pixels = txt_pixels + (size_t)rect.y *
+          (size_t)txt_width;
+        if (SDL_UpdateTexture(txt_texture, &rect, pixels, pitch) != 0) {
+            return CuErrMsg(err, "Unable to update text-mode texture: %s",
+              SDL_GetError());
+        }
+        *updated = true;
+    }
+    return true;
+}
+
+bool CuSdlDispUpdate(bool* restrict updated, CuError* restrict err) {
+    *updated = false;
+    uint32_t mode;
+    CuError nerr;
+    if (!CuGetWordAt(CU_DISP_MODE_ADDR, &mode, &nerr)) {
+        return CuErrMsg(err, "Error reading display-mode: %s", nerr.err_msg);
+    }
+    if (mode != CU_DISP_MODE_TEXT) {
+        mode = CU_DISP_MODE_FB;
+    }
+    if (mode != disp_mode) {
+        disp_mode = mode;
+        *updated = true;
+    }
+    if (disp_mode == CU_DISP_MODE_TEXT) {
+        return UpdateText(updated, err);
+    }
+    return UpdateFb(updated, err);
+}
+
+bool CuSdlDispRender(SDL_Renderer* restrict renderer, CuError* restrict err) {
+    SDL_Texture* texture = (disp_mode == CU_DISP_MODE_TEXT) ? txt_texture :
+      fb_texture;
+    if (SDL_RenderCopy(renderer, texture, /*srcrect=*/NULL,
+      /*dstrect=*/NULL) != 0) {
+        return CuErrMsg(err, "Unable to render display-texture: %s",
+          SDL_GetError());
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_SDLDISP_INCLUDED
+#define CUSS_SDLDISP_INCLUDED
+
+#include "SDL_render.h"
+#include <stdbool.h>
+
+#include "errors.h"
+
+// The simulated display, showing either the frame-buffer or the text-mode
+// cell-grid in memory (see "memory.h") through a texture of the renderer.
+extern bool CuSdlDispSetUp(SDL_Renderer* restrict renderer,
+  CuError* restrict err);
+extern bool CuSdlDispTearDown(CuError* restrict err);
+
+// Upload the rows of the frame-buffer that have been written to since the last
+// call (or every row, on the first call), or rasterize and upload the cells of
+// the cell-grid that have changed, as per the display-mode. Sets `updated` to
+// whether the display has changed.
+extern bool CuSdlDispUpdate(bool* restrict updated, CuError* restrict err);
+
+// Copy the display onto the whole of the current rendering-target.
+extern bool CuSdlDispRender(SDL_Renderer* restrict renderer,
+  CuError* restrict err);
+
+#endif  // CUSS_SDLDISP_INCLUDED
@@ -28,13 +28,40 @@ static int mon_curr_col = 0;
 static int mon_max_rows = 0;
 static int mon_max_cols = 0;
 
+// Whether each row of `mon_out_buf` has changed since it was last rendered,
+// or whether every row has (as when the text scrolls).
+static bool* mon_dirty_rows = NULL;
+static bool mon_all_dirty = true;
+// Whether the cursor was shown when it was last rendered.
+static bool mon_drawn_cursor = false;
+
+// Text from the Monitor-thread for the UI-thread, which applies it to
+// `mon_out_buf` once per frame. This is a single-producer, single-consumer
+// ring of bytes, whose indices run modulo twice its size so that a full ring
+// can be told apart from an empty one. The Monitor-thread drops its text once
+// `mon_txt_open` is cleared, rather than wait for a UI-thread that has gone.
+#define MON_TXT_RING_SIZE 65536
+#define MON_TXT_IDX_MASK (2 * MON_TXT_RING_SIZE - 1)
+static char mon_txt_ring[MON_TXT_RING_SIZE];
+static CuAtomic mon_txt_head = NULL;
+static CuAtomic mon_txt_tail = NULL;
+static CuAtomic mon_txt_open = NULL;
+
+// The executor-thread also hands over text, when it reports a stop while the
+// Monitor-thread waits for input, so the producers take turns via this.
+static CuMutex mon_txt_put_mut = NULL;
+
 static CuMutex mon_inp_mut = NULL;
 static CuCondVar mon_inp_cv = NULL;
 static bool mon_inp_active = false;
 static bool mon_inp_eof = true;
 static bool mon_show_cursor = false;
 
-bool CuSdlMonIoSetUp(int scr_width, int scr_height, CuError* restrict err) {
+static CuSdlMonWakeFn mon_wake_fn = NULL;
+
+bool CuSdlMonIoSetUp(int scr_width, int scr_height, CuSdlMonWakeFn wake_fn,
+  CuError* restrict err) {
+    mon_wake_fn = wake_fn;
     mon_max_rows = scr_height / CuSdlTxtHeight();
     mon_max_cols = scr_width / CuSdlTxtWidth();
     mon_inp_buf[0] = '\0';
@@ -42,10 +69,26 @@ bool CuSdlMonIoSetUp(int scr_width, int scr_height, CuError* restrict err) {
     if (mon_out_buf == NULL) {
         return CuErrMsg(err, "Unable to allocate Monitor text-buffer.");
     }
+    mon_dirty_rows = calloc(mon_max_rows, sizeof(bool));
+    if (mon_dirty_rows == NULL) {
+        return CuErrMsg(err, "Unable to allocate Monitor dirty-rows.");
+    }
+    mon_all_dirty = true;
+    mon_drawn_cursor = false;
     mon_init_row = 0;
     mon_curr_row = 0;
     mon_curr_col = 0;
 
+    if (mon_txt_open == NULL) {
+        RET_ON_ERR(CuAtomicCreate(&mon_txt_head, 0, err));
+        RET_ON_ERR(CuAtomicCreate(&mon_txt_tail, 0, err));
+        RET_ON_ERR(CuAtomicCreate(&mon_txt_open, 0, err));
+    }
+    CuAtomicSet(&mon_txt_head, 0);
+    CuAtomicSet(&mon_txt_tail, 0);
+    CuAtomicSet(&mon_txt_open, 1);
+
+    RET_ON_ERR(CuMutCreate(&mon_txt_put_mut, err));
     RET_ON_ERR(CuMutCreate(&mon_inp_mut, err));
     RET_ON_ERR(CuCondVarCreate(&mon_inp_cv, err));
     mon_inp_active = false;
@@ -55,6 +98,7 @@ bool CuSdlMonIoSetUp(int scr_width, int scr_height, CuError* restrict err) {
 }
 
 bool CuSdlMonIoTearDown(CuError* restrict err) {
+    CuAtomicSet(&mon_txt_open, 0);
     mon_inp_eof = true;
     if (mon_inp_active) {
         RET_ON_ERR(CuCondVarSignal(&mon_inp_cv, err));
@@ -77,18 +121,29 @@ bool CuSdlMonIoTearDown(CuError* restrict err) {
     RET_ON_ERR(CuCondVarDestroy(&mon_inp_cv, err));
     RET_ON_ERR(CuMutUnlock(&mon_inp_mut, err));
     RET_ON_ERR(CuMutDestroy(&mon_inp_mut, err));
+    RET_ON_ERR(CuMutDestroy(&mon_txt_put_mut, err));
 
     mon_inp_buf[0] = '\0';
     free(mon_out_buf);
+    free(mon_dirty_rows);
+    mon_out_buf = NULL;
+    mon_dirty_rows = NULL;
     mon_init_row = 0;
     mon_curr_row = 0;
     mon_curr_col = 0;
 
     mon_inp_active = false;
     mon_show_cursor = false;
+    mon_wake_fn = NULL;
     return true;
 }
 
+static inline void WakeUi(void) {
+    if (mon_wake_fn != NULL) {
+        mon_wake_fn();
+    }
+}
+
 static inline uint8_t* CurrMonRowData(void) {
     return mon_out_buf + (mon_curr_row * mon_max_cols);
 }
@@ -102,19 +157,21 @@ static inline int NumMonRows(void) {
 
 static uint8_t* NextMonRowData(void) {
     if (NumMonRows() == mon_max_rows) {
+        // Every row on the screen moves up by one.
         mon_init_row = (mon_init_row + 1) % mon_max_rows;
+        mon_all_dirty = true;
     }
     mon_curr_row = (mon_curr_row + 1) % mon_max_rows;
     mon_curr_col = 0;
+    mon_dirty_rows[mon_curr_row] = true;
     return CurrMonRowData();
 }
 
-static void EmitMonTxt(const char* restrict txt) {
-#define MAX_CHARS_TO_EMIT 65536
-    int n = 0;
-    char c;
+static void EmitMonTxt(const char* restrict txt, size_t len) {
     uint8_t* restrict row_data = CurrMonRowData();
-    while (n < MAX_CHARS_TO_EMIT && (c = *txt++) != '\0') {
+    mon_dirty_rows[mon_curr_row] = true;
+    for (size_t i = 0; i < len; i++) {
+        const char c = txt[i];
         if (c == '\n' && mon_curr_col < mon_max_cols) {
             row_data[mon_curr_col] = 0x00;
         }
@@ -124,16 +181,56 @@ static void EmitMonTxt(const char* restrict txt) {
         if (c != '\n') {
             row_data[mon_curr_col++] = (uint8_t)c;
         }
-        n++;
     }
     if (mon_curr_col < mon_max_cols) {
         row_data[mon_curr_col] = 0x00;
     }
-#undef MAX_CHARS_TO_EMIT
+}
+
+// Hand `txt` over to the UI-thread, waiting for room in the ring if needed.
+static void QueueMonTxt(const char* restrict txt) {
+    size_t len = strlen(txt);
+    while (len > 0 && CuAtomicGet(&mon_txt_open) != 0) {
+        const int tail = CuAtomicGet(&mon_txt_tail);
+        const int head = CuAtomicGet(&mon_txt_head);
+        const size_t used = (size_t)((tail - head) & MON_TXT_IDX_MASK);
+        const size_t start = (size_t)tail & (MON_TXT_RING_SIZE - 1);
+        size_t n = MON_TXT_RING_SIZE - used;
+        if (n == 0) {
+#define MON_TXT_WAIT_MS 1
+            SDL_Delay(MON_TXT_WAIT_MS);
+#undef MON_TXT_WAIT_MS
+            continue;
+        }
+        n = (n < len) ? n : len;
+        n = (n < MON_TXT_RING_SIZE - start) ? n : MON_TXT_RING_SIZE - start;
+        memcpy(mon_txt_ring + start, txt, n);
+        CuAtomicSet(&mon_txt_tail, (tail + (int)n) & MON_TXT_IDX_MASK);
+        WakeUi();
+        txt += n;
+        len -= n;
+    }
+}
+
+// Apply the text handed over by the Monitor-thread so far.
+static void DrainMonTxt(void) {
+    const int head = CuAtomicGet(&mon_txt_head);
+    const int tail = CuAtomicGet(&mon_txt_tail);
+    const size_t used = (size_t)((tail - head) & MON_TXT_IDX_MASK);
+    if (used == 0) {
+        return;
+    }
+    const size_t start = (size_t)head & (MON_TXT_RING_SIZE - 1);
+    const size_t n = (used < MON_TXT_RING_SIZE - start) ? used :
+      MON_TXT_RING_SIZE - start;
+    EmitMonTxt(mon_txt_ring + start, n);
+    EmitMonTxt(mon_txt_ring, used - n);
+    CuAtomicSet(&mon_txt_head, tail);
 }
 
 static void UnemitMonTxt(size_t n) {
     uint8_t* restrict row_data = CurrMonRowData();
+    mon_dirty_rows[mon_curr_row] = true;
     for (size_t i = 0; i < n; i++) {
         if (mon_curr_col > 0) {
             row_data[--mon_curr_col] = 0x00;
@@ -142,6 +239,7 @@ static void UnemitMonTxt(size_t n) {
             mon_curr_col = mon_max_cols - 1;
             row_data = CurrMonRowData();
             row_data[mon_curr_col] = 0x00;
+            mon_dirty_rows[mon_curr_row] = true;
         } else {
             return;
         }
@@ -151,6 +249,7 @@ static void UnemitMonTxt(size_t n) {
 static uint32_t FlipCursorBlink(uint32_t interval, void* param) {
     (void)param;  // Suppress unused variable warning.
     mon_show_cursor = !mon_show_cursor;
+    WakeUi();
     if (mon_inp_active) {
         return interval;
     }
@@ -161,10 +260,12 @@ static uint32_t FlipCursorBlink(uint32_t interval, void* param) {
 bool CuSdlMonIoGetInp(char* restrict buf, size_t buf_size, bool* restrict eof,
   CuError* restrict err) {
     mon_inp_buf[0] = '\0';
-    mon_inp_active = true;
     mon_show_cursor = true;
 
-    EmitMonTxt(" ");  // Add a place-holder for the cursor.
+    RET_ON_ERR(CuMutLock(&mon_txt_put_mut, err));
+    mon_inp_active = true;
+    QueueMonTxt(" ");  // Add a place-holder for the cursor.
+    RET_ON_ERR(CuMutUnlock(&mon_txt_put_mut, err));
 #define CURSOR_BLINK_MS 500
     const SDL_TimerID timer_id = SDL_AddTimer(CURSOR_BLINK_MS, FlipCursorBlink,
       /*param=*/NULL);
@@ -186,7 +287,9 @@ bool CuSdlMonIoGetInp(char* restrict buf, size_t buf_size, bool* restrict eof,
         CuLogWarn("Could not remove cursor-blink timer-function %d.", timer_id);
     }
     mon_show_cursor = false;
+    RET_ON_ERR(CuMutLock(&mon_txt_put_mut, err));
     mon_inp_active = false;
+    RET_ON_ERR(CuMutUnlock(&mon_txt_put_mut, err));
     *eof = mon_inp_eof;
 
     return true;
@@ -196,35 +299,97 @@ bool CuSdlMonIoPutMsg(const char* restrict msg, CuError* restrict err) {
     if (msg == NULL) {
         return CuErrMsg(err, "NULL `msg` argument.");
     }
-    EmitMonTxt(msg);
-    return true;
+    RET_ON_ERR(CuMutLock(&mon_txt_put_mut, err));
+    QueueMonTxt(msg);
+    if (mon_inp_active) {
+        // The text lands after the input echoed so far, so echo that again
+        // after it, along with a new place-holder for the cursor.
+        char inp_buf[MAX_MON_INP];
+        RET_ON_ERR(CuMutLock(&mon_inp_mut, err));
+        strcpy(inp_buf, mon_inp_buf);
+        RET_ON_ERR(CuMutUnlock(&mon_inp_mut, err));
+        QueueMonTxt(inp_buf);
+        QueueMonTxt(" ");
+    }
+    return CuMutUnlock(&mon_txt_put_mut, err);
+}
+
+// The length of the text in the row `row` of `mon_out_buf`.
+static size_t MonRowLen(int row) {
+    const uint8_t* row_txt = mon_out_buf + (row * mon_max_cols);
+    const void* first_nil = memchr(row_txt, 0x00, mon_max_cols);
+    return (first_nil != NULL) ? (size_t)((const uint8_t*)first_nil - row_txt) :
+      (size_t)mon_max_cols;
+}
+
+static void AddDirtyRect(SDL_Rect* restrict dirty,
+  const SDL_Rect* restrict rect) {
+    SDL_Rect all;
+    SDL_UnionRect(dirty, rect, &all);
+    *dirty = all;
 }
 
-bool CuSdlMonIoRender(SDL_Surface* restrict screen, CuError* restrict err) {
-    SDL_FillRect(screen, /*rect=*/NULL,
-      SDL_MapRGBA(screen->format, 0x00, 0x5f, 0x87, 0xff));
+bool CuSdlMonIoRender(SDL_Surface* restrict screen, SDL_Rect* restrict dirty,
+  CuError* restrict err) {
+    DrainMonTxt();
+    dirty->x = 0;
+    dirty->y = 0;
+    dirty->w = 0;
+    dirty->h = 0;
 
+    const uint32_t bg_clr = SDL_MapRGBA(screen->format, 0x00, 0x5f, 0x87,
+      0xff);
     const SDL_Color fg_clr = {.r = 0xee, .g = 0xee, .b = 0xee, .a = 0xff};
     RET_ON_ERR(CuSdlTxtSetColor(&fg_clr, err));
+    if (mon_all_dirty) {
+        SDL_FillRect(screen, /*rect=*/NULL, bg_clr);
+        const SDL_Rect all = {.x = 0, .y = 0, .w = screen->w, .h = screen->h};
+        AddDirtyRect(dirty, &all);
+    }
 
+    // Redraw the rows that have changed, along with the cell of the cursor if
+    // it has blinked since it was last rendered.
+    const bool show_cursor = mon_inp_active && mon_show_cursor;
     const int num_rows = NumMonRows();
     for (int i = 0; i < num_rows; i++) {
         const int the_row = (mon_init_row + i) % mon_max_rows;
-        uint8_t* the_txt = mon_out_buf + (the_row * mon_max_cols);
-        if (the_txt[0] == 0x00) {
+        const bool is_cursor_row = mon_inp_active && the_row == mon_curr_row;
+        if (!mon_all_dirty && !mon_dirty_rows[the_row] &&
+          !(is_cursor_row && show_cursor != mon_drawn_cursor)) {
             continue;
         }
-        size_t txt_sz = mon_max_cols;
-        const void* first_nil = memchr(the_txt, 0x00, mon_max_cols);
-        if (first_nil != NULL) {
-            txt_sz = (uint8_t*)first_nil - the_txt;
+        uint8_t* the_txt = mon_out_buf + (the_row * mon_max_cols);
+        const size_t txt_sz = MonRowLen(the_row);
+        SDL_Rect rect = {
+            .x = 0, .y = i * CuSdlTxtHeight(), .w = screen->w,
+            .h = CuSdlTxtHeight(),
+        };
+        if (!mon_all_dirty && !mon_dirty_rows[the_row]) {
+            if (txt_sz == 0) {
+                continue;
+            }
+            // Only the cursor has changed.
+            rect.x = (int)(txt_sz - 1) * CuSdlTxtWidth();
+            rect.w = CuSdlTxtWidth();
         }
-        if (mon_inp_active && the_row == mon_curr_row && txt_sz > 0) {
-            the_txt[txt_sz - 1] = mon_show_cursor ? 0xdb : 0x20;
+        mon_dirty_rows[the_row] = false;
+        if (!mon_all_dirty) {
+            SDL_FillRect(screen, &rect, bg_clr);
+            AddDirtyRect(dirty, &rect);
         }
-        SDL_Point pos = {.x = 0, .y = i * CuSdlTxtHeight()};
-        RET_ON_ERR(CuSdlTxtRenderByteSeq(screen, &pos, the_txt, txt_sz, err));
+        if (txt_sz == 0) {
+            continue;
+        }
+        if (is_cursor_row) {
+            the_txt[txt_sz - 1] = show_cursor ? 0xdb : 0x20;
+            mon_drawn_cursor = show_cursor;
+        }
+        const size_t skip = (size_t)(rect.x / CuSdlTxtWidth());
+        SDL_Point pos = {.x = rect.x, .y = rect.y};
+        RET_ON_ERR(CuSdlTxtRenderByteSeq(screen, &pos, the_txt + skip,
+          txt_sz - skip, err));
     }
+    mon_all_dirty = false;
     return true;
 }
 
@@ -232,6 +397,8 @@ bool CuSdlMonProcEvt(const SDL_Event* restrict evt, CuError* restrict err) {
     if (!mon_inp_active) {
         return true;
     }
+    // Apply any pending text first, including the place-holder for the cursor.
+    DrainMonTxt();
     const size_t mon_inp_size = strlen(mon_inp_buf);
     switch (evt->type) {
       case SDL_TEXTINPUT:
@@ -240,8 +407,8 @@ bool CuSdlMonProcEvt(const SDL_Event* restrict evt, CuError* restrict err) {
             strncat(mon_inp_buf, evt->text.text, MAX_MON_INP - mon_inp_size);
             RET_ON_ERR(CuMutUnlock(&mon_inp_mut, err));
             UnemitMonTxt(1);  // Remove the place-holder for the cursor.
-            EmitMonTxt(evt->text.text);
-            EmitMonTxt(" ");  // Add a place-holder for the cursor.
+            EmitMonTxt(evt->text.text, strlen(evt->text.text));
+            EmitMonTxt(" ", 1);  // Add a place-holder for the cursor.
         }
         break;
 
@@ -262,8 +429,10 @@ bool CuSdlMonProcEvt(const SDL_Event* restrict evt, CuError* restrict err) {
       case SDL_KEYDOWN:
         if (evt->key.keysym.sym == SDLK_BACKSPACE && mon_inp_size > 0) {
             UnemitMonTxt(2);  // Remove the place-holder for the cursor as well.
+            RET_ON_ERR(CuMutLock(&mon_inp_mut, err));
             mon_inp_buf[mon_inp_size - 1] = '\0';
-            EmitMonTxt(" ");  // Add a place-holder for the cursor.
+            RET_ON_ERR(CuMutUnlock(&mon_inp_mut, err));
+            EmitMonTxt(" ", 1);  // Add a place-holder for the cursor.
         }
         break;
     }
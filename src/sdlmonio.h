@@ -4,21 +4,30 @@
 #define CUSS_SDLMONIO_INCLUDED
 
 #include "SDL_events.h"
+#include "SDL_rect.h"
 #include "SDL_surface.h"
 #include <stdbool.h>
 
 #include "errors.h"
 
+// The type of a function called from any thread when the Monitor has something
+// new to render, to wake up the UI-thread.
+typedef void (*CuSdlMonWakeFn)(void);
+
+// Set up the Monitor I/O for a screen of `scr_width` x `scr_height` pixels,
+// calling `wake_fn` (if not NULL) whenever it has something new to render.
 extern bool CuSdlMonIoSetUp(int scr_width, int scr_height,
-  CuError* restrict err);
+  CuSdlMonWakeFn wake_fn, CuError* restrict err);
 extern bool CuSdlMonIoTearDown(CuError* restrict err);
 
 extern bool CuSdlMonIoGetInp(char* restrict buf, size_t buf_size,
   bool* restrict eof, CuError* restrict err);
 extern bool CuSdlMonIoPutMsg(const char* restrict msg, CuError* restrict err);
 
+// Redraw the parts of `screen` that have changed since the last call, setting
+// `dirty` to a rectangle enclosing them (which is empty if nothing changed).
 extern bool CuSdlMonIoRender(SDL_Surface* restrict screen,
-  CuError* restrict err);
+  SDL_Rect* restrict dirty, CuError* restrict err);
 
 extern bool CuSdlMonProcEvt(const SDL_Event* restrict evt,
   CuError* restrict err);
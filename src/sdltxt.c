@@ -3,6 +3,11 @@
 #include "sdltxt.h"
 
 #include "SDL_error.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define VGA_FONT_CHARS 256U
 #define VGA_FONT_WIDTH 8U
@@ -10,6 +15,9 @@
 
 static SDL_Surface* font_surface = NULL;
 
+// The color of text, as last set by `CuSdlTxtSetColor()`.
+static SDL_Color txt_color = {.r = 0xff, .g = 0xff, .b = 0xff, .a = 0xff};
+
 // Translated bitmap-data of "VGA-ROM.F16" from the font-collection by
 // Joseph (Yossi) Gil that used to be available at:
 //   ftp://ftp.simtel.net/pub/simtelnet/msdos/screen/fntcol16.zip
@@ -856,6 +864,7 @@ int CuSdlTxtWidth() { return VGA_FONT_WIDTH; }
 int CuSdlTxtHeight() { return VGA_FONT_HEIGHT; }
 
 bool CuSdlTxtSetColor(const SDL_Color* restrict clr, CuError* restrict err) {
+    txt_color = *clr;
     if (SDL_SetSurfaceColorMod(font_surface, clr->r, clr->g, clr->b) != 0) {
         return CuErrMsg(err, "Unable to set font-surface color-modulation: %s",
           SDL_GetError());
@@ -879,6 +888,81 @@ static inline bool RenderByte(SDL_Surface* restrict screen,
     return true;
 }
 
+// Expand the bits of a row of a glyph into the 8 pixels at `dst`, setting the
+// pixel for every set bit to `fg` and leaving the others as they are (like the
+// color-keyed `font_surface`).
+static inline void ExpandGlyphRow(uint32_t* restrict dst, uint8_t bits,
+  uint32_t fg) {
+#if defined(__AVX2__)
+    const __m256i sel = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04,
+      0x02, 0x01);
+    const __m256i mask = _mm256_cmpeq_epi32(
+      _mm256_and_si256(_mm256_set1_epi32(bits), sel), sel);
+    const __m256i old = _mm256_loadu_si256((const __m256i*)dst);
+    _mm256_storeu_si256((__m256i*)dst,
+      _mm256_blendv_epi8(old, _mm256_set1_epi32((int)fg), mask));
+#elif defined(__SSE2__)
+    const __m128i fgv = _mm_set1_epi32((int)fg);
+    const __m128i bitv = _mm_set1_epi32(bits);
+    const __m128i sel_hi = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+    const __m128i sel_lo = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+    const __m128i mask_hi = _mm_cmpeq_epi32(_mm_and_si128(bitv, sel_hi),
+      sel_hi);
+    const __m128i mask_lo = _mm_cmpeq_epi32(_mm_and_si128(bitv, sel_lo),
+      sel_lo);
+    __m128i* dst_hi = (__m128i*)dst;
+    __m128i* dst_lo = (__m128i*)(dst + 4);
+    _mm_storeu_si128(dst_hi, _mm_or_si128(_mm_and_si128(mask_hi, fgv),
+      _mm_andnot_si128(mask_hi, _mm_loadu_si128(dst_hi))));
+    _mm_storeu_si128(dst_lo, _mm_or_si128(_mm_and_si128(mask_lo, fgv),
+      _mm_andnot_si128(mask_lo, _mm_loadu_si128(dst_lo))));
+#else
+    for (size_t j = 0U; j < VGA_FONT_WIDTH; j++) {
+        if (bits & (0x80U >> j)) {
+            dst[j] = fg;
+        }
+    }
+#endif
+}
+
+// Render the `n` glyphs of `seq` at `pos` straight into the pixels of the
+// 32-bpp `screen`, one row of pixels of all of them at a time. The glyphs must
+// lie within the width of `screen`.
+static void ExpandByteSeq(SDL_Surface* restrict screen,
+  const SDL_Point* restrict pos, const uint8_t* restrict seq, size_t n) {
+    const uint32_t fg = SDL_MapRGBA(screen->format, txt_color.r, txt_color.g,
+      txt_color.b, txt_color.a);
+    const int num_rows = (screen->h - pos->y < (int)VGA_FONT_HEIGHT) ?
+      screen->h - pos->y : (int)VGA_FONT_HEIGHT;
+    uint8_t* row_pos = (uint8_t*)screen->pixels + pos->y * screen->pitch +
+      pos->x * (int)sizeof(uint32_t);
+    for (int r = 0; r < num_rows; r++) {
+        uint32_t* dst = (uint32_t*)row_pos;
+        for (size_t i = 0U; i < n; i++) {
+            const uint8_t bits = vga_8x16[seq[i] * VGA_FONT_HEIGHT + r];
+            if (bits != 0) {
+                ExpandGlyphRow(dst, bits, fg);
+            }
+            dst += VGA_FONT_WIDTH;
+        }
+        row_pos += screen->pitch;
+    }
+}
+
+void CuSdlTxtRenderGlyph(uint32_t* restrict pixels, size_t stride,
+  uint8_t byt, uint32_t fg, uint32_t bg) {
+    const uint8_t* glyph = vga_8x16 + byt * VGA_FONT_HEIGHT;
+    for (size_t r = 0U; r < VGA_FONT_HEIGHT; r++) {
+        uint32_t* dst = pixels + r * stride;
+        for (size_t j = 0U; j < VGA_FONT_WIDTH; j++) {
+            dst[j] = bg;
+        }
+        if (glyph[r] != 0) {
+            ExpandGlyphRow(dst, glyph[r], fg);
+        }
+    }
+}
+
 bool CuSdlTxtRenderByteSeq(SDL_Surface* restrict screen,
   const SDL_Point* restrict pos, const uint8_t* restrict seq, size_t n,
   CuError* restrict err) {
@@ -892,8 +976,19 @@ bool CuSdlTxtRenderByteSeq(SDL_Surface* restrict screen,
         return true;
     }
 
+    // Expand the glyphs that fit wholly within the screen ourselves, unless
+    // blending or an unusual screen-surface needs `SDL_BlitSurface()`.
+    size_t i = 0U;
     SDL_Point cpos = {.x = pos->x, .y = pos->y};
-    for (size_t i = 0U; i < n && cpos.x < screen->w; i++) {
+    if (pos->x >= 0 && pos->y >= 0 && pos->x < screen->w &&
+      screen->format->BytesPerPixel == sizeof(uint32_t) &&
+      !SDL_MUSTLOCK(screen) && txt_color.a == 0xff) {
+        const size_t max_n = (size_t)(screen->w - pos->x) / VGA_FONT_WIDTH;
+        i = (n < max_n) ? n : max_n;
+        ExpandByteSeq(screen, pos, seq, i);
+        cpos.x += (int)(i * VGA_FONT_WIDTH);
+    }
+    for (; i < n && cpos.x < screen->w; i++) {
         RET_ON_ERR(RenderByte(screen, &cpos, seq[i], err));
         cpos.x += VGA_FONT_WIDTH;
     }
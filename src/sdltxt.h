@@ -26,4 +26,9 @@ extern bool CuSdlTxtRenderByteSeq(SDL_Surface* restrict screen,
   const SDL_Point* restrict pos, const uint8_t* restrict seq, size_t n,
   CuError* restrict err);
 
+// Render the glyph of `byt` into the 32-bpp pixels at `pixels`, whose rows are
+// `stride` pixels apart, with the pixel-values `fg` and `bg`.
+extern void CuSdlTxtRenderGlyph(uint32_t* restrict pixels, size_t stride,
+  uint8_t byt, uint32_t fg, uint32_t bg);
+
 #endif  // CUSS_SDLTXT_INCLUDED
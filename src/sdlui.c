@@ -8,11 +8,17 @@
 #include "SDL.h"
 #include <stdint.h>
 
+#include "concur.h"
+#include "cpu.h"
 #include "logger.h"
+#include "memory.h"
+#include "sdldisp.h"
 #include "sdlmonio.h"
 #include "sdltxt.h"
 
 #define TARGET_FPS 60
+// How long the UI-thread waits for an event when nothing else would wake it.
+#define IDLE_WAIT_MS 500
 #define MAX_FRAME_TIMES 256
 #define INVALID_PERF_CTR 0xDEADC0DEDEADC0DELLU
 
@@ -32,7 +38,17 @@ static SDL_Renderer* renderer = NULL;
 static SDL_Surface* screen = NULL;
 static SDL_Texture* screen_texture = NULL;
 
-static bool is_monitor_active = true;  // TODO: Set it correctly.
+// Whether the Monitor is shown, rather than the simulated display.
+static bool is_monitor_active = true;
+
+// Whether the window must be presented again even if the screen has not
+// changed, as when it has been uncovered.
+static bool needs_present = true;
+
+// The type of the event that wakes the UI-thread from another thread, and
+// whether one is already queued, so that there is at most one at a time.
+static uint32_t wake_evt_type = (uint32_t)-1;
+static CuAtomic wake_pending = NULL;
 
 static struct FrameTimes frame_times[MAX_FRAME_TIMES];
 static int curr_frame = 0;
@@ -155,6 +171,18 @@ static bool CreateScreenSurface(SDL_PixelFormatEnum pixel_format,
     return true;
 }
 
+// Wake up the UI-thread to render what has changed. Safe to call from any
+// thread.
+static void WakeUi(void) {
+    if (!CuAtomicCas(&wake_pending, 0, 1)) {
+        return;
+    }
+    SDL_Event evt = {.type = wake_evt_type};
+    if (SDL_PushEvent(&evt) != 1) {
+        CuAtomicSet(&wake_pending, 0);
+    }
+}
+
 bool CuSdlUiSetUp(CuError* restrict err) {
     TryToSetSdlHint("SDL_HINT_RENDER_DRIVER", "opengl");
     TryToSetSdlHint("SDL_HINT_RENDER_VSYNC", "0");
@@ -185,9 +213,22 @@ bool CuSdlUiSetUp(CuError* restrict err) {
         frame_times[i].flip_ctr = INVALID_PERF_CTR;
     }
     curr_frame = 0;
+    needs_present = true;
 
     RET_ON_ERR(CuSdlTxtSetUp(screen->format, err));
-    RET_ON_ERR(CuSdlMonIoSetUp(SCR_WIDTH, SCR_HEIGHT, err));
+    wake_evt_type = SDL_RegisterEvents(1);
+    if (wake_evt_type == (uint32_t)-1) {
+        return CuErrMsg(err, "Could not register wake-up event: %s",
+          SDL_GetError());
+    }
+    if (wake_pending == NULL) {
+        RET_ON_ERR(CuAtomicCreate(&wake_pending, 0, err));
+    }
+    CuAtomicSet(&wake_pending, 0);
+
+    RET_ON_ERR(CuSdlMonIoSetUp(SCR_WIDTH, SCR_HEIGHT, WakeUi, err));
+    RET_ON_ERR(CuSdlDispSetUp(renderer, err));
+    is_monitor_active = true;
     return true;
 }
 
@@ -226,8 +267,12 @@ static void PrintRenderTimings(void) {
 bool CuSdlUiTearDown(CuError* restrict err) {
     PrintRenderTimings();
 
+    RET_ON_ERR(CuSdlDispTearDown(err));
     RET_ON_ERR(CuSdlMonIoTearDown(err));
     RET_ON_ERR(CuSdlTxtTearDown(err));
+    if (wake_pending != NULL) {
+        RET_ON_ERR(CuAtomicDestroy(&wake_pending, err));
+    }
 
     SDL_DestroyTexture(screen_texture);
     SDL_FreeSurface(screen);
@@ -246,19 +291,39 @@ bool CuSdlUiTearDown(CuError* restrict err) {
 static bool RenderFrame(CuError* restrict err) {
     const uint64_t t0 = SDL_GetPerformanceCounter();
 
+    // The simulated display is drawn straight into its texture.
+    SDL_Rect dirty = {.x = 0, .y = 0, .w = 0, .h = 0};
     if (is_monitor_active) {
-        RET_ON_ERR(CuSdlMonIoRender(screen, err));
+        RET_ON_ERR(CuSdlMonIoRender(screen, &dirty, err));
+    } else {
+        bool updated;
+        RET_ON_ERR(CuSdlDispUpdate(&updated, err));
+        needs_present = needs_present || updated;
     }
     const uint64_t t_draw = SDL_GetPerformanceCounter();
 
-    SDL_UpdateTexture(screen_texture, /*rect=*/NULL, screen->pixels,
-      screen->pitch);
+    // Only upload the part of the screen that has changed, if any.
+    if (dirty.w > 0 && dirty.h > 0) {
+        const uint8_t* pixels = (const uint8_t*)screen->pixels +
+          dirty.y * screen->pitch + dirty.x * screen->format->BytesPerPixel;
+        SDL_UpdateTexture(screen_texture, &dirty, pixels, screen->pitch);
+        needs_present = true;
+    }
     const uint64_t t_blit = SDL_GetPerformanceCounter();
 
+    if (!needs_present) {
+        // Nothing has changed, so there is no frame to time or to pace.
+        return true;
+    }
     SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, screen_texture, /*srcrect=*/NULL,
-      /*dstrect=*/NULL);
+    if (is_monitor_active) {
+        SDL_RenderCopy(renderer, screen_texture, /*srcrect=*/NULL,
+          /*dstrect=*/NULL);
+    } else {
+        RET_ON_ERR(CuSdlDispRender(renderer, err));
+    }
     SDL_RenderPresent(renderer);
+    needs_present = false;
     const uint64_t t_flip = SDL_GetPerformanceCounter();
 
     const uint64_t total_ctr = t_flip - t0;
@@ -274,13 +339,44 @@ static bool RenderFrame(CuError* restrict err) {
     return true;
 }
 
+// Switch between showing the Monitor and the simulated display, each at its
+// own logical screen-resolution.
+static bool ToggleMonitor(CuError* restrict err) {
+    is_monitor_active = !is_monitor_active;
+    const int w = is_monitor_active ? SCR_WIDTH : (int)CU_FB_WIDTH;
+    const int h = is_monitor_active ? SCR_HEIGHT : (int)CU_FB_HEIGHT;
+    if (SDL_RenderSetLogicalSize(renderer, w, h) != 0) {
+        return CuErrMsg(err, "Could not set renderer logical size to %dx%d: %s",
+          w, h, SDL_GetError());
+    }
+    needs_present = true;
+    return true;
+}
+
+// How long to wait for an event before rendering the next frame. The Monitor
+// wakes the UI-thread when it has something new to show, but the simulated
+// display can only be checked for changes while the executor is running.
+static int GetWaitTimeoutMs(void) {
+    if (!is_monitor_active && CuGetCpuState() == CU_CPU_RUNNING) {
+        return 1000 / TARGET_FPS;
+    }
+    return IDLE_WAIT_MS;
+}
+
 bool CuSdlUiRunEventLoop(CuError* restrict err) {
     bool quit = false;
     while (!quit) {
         RET_ON_ERR(RenderFrame(err));
 
+        // Sleep until there is an event, then handle every pending event
+        // before rendering again.
         SDL_Event evt;
-        while (SDL_PollEvent(&evt) == 1) {
+        for (int got = SDL_WaitEventTimeout(&evt, GetWaitTimeoutMs());
+          got == 1 && !quit; got = SDL_PollEvent(&evt)) {
+            if (evt.type == wake_evt_type) {
+                CuAtomicSet(&wake_pending, 0);
+                continue;
+            }
             switch (evt.type) {
               case SDL_QUIT:
                 quit = true;
@@ -289,12 +385,17 @@ bool CuSdlUiRunEventLoop(CuError* restrict err) {
               case SDL_KEYUP:
                 if (evt.key.keysym.sym == SDLK_ESCAPE) {
                     quit = true;
+                } else if (evt.key.keysym.sym == SDLK_F2) {
+                    RET_ON_ERR(ToggleMonitor(err));
+                    continue;
                 }
                 break;
 
               case SDL_WINDOWEVENT:
                 if (evt.window.event == SDL_WINDOWEVENT_CLOSE) {
                     quit = true;
+                } else if (evt.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                    needs_present = true;
                 }
                 break;
             }
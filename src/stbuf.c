@@ -0,0 +1,217 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "stbuf.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+
+// The number of bytes needed for a bit per byte of a page.
+#define PAGE_MASK_SIZE (CU_MEM_PAGE_SIZE / 8U)
+
+// The slot of a page of memory that is not in the store-buffer.
+#define NO_SLOT (-1)
+
+struct CuStoreBuf {
+    // The slot holding the private copy of each page of memory, if any.
+    int16_t* slots;
+    uint32_t num_mem_pages;
+    int num_used;
+    uint32_t page_nums[CU_SBUF_MAX_PAGES];
+    // A copy of the whole page, so that loads need not merge it with memory.
+    uint8_t data[CU_SBUF_MAX_PAGES][CU_MEM_PAGE_SIZE];
+    // A bit for every byte of the page that has been stored to.
+    uint8_t dirty[CU_SBUF_MAX_PAGES][PAGE_MASK_SIZE];
+};
+
+bool CuSbufCreate(CuStoreBuf** restrict sbuf, CuError* restrict err) {
+    if (sbuf == NULL) {
+        return CuErrMsg(err, "NULL `sbuf` argument.");
+    }
+    *sbuf = malloc(sizeof (struct CuStoreBuf));
+    if (*sbuf == NULL) {
+        return CuErrMsg(err, "Unable to allocate store-buffer.");
+    }
+    CuStoreBuf* sb = *sbuf;
+    sb->num_mem_pages = CuGetMemSize() >> CU_MEM_PAGE_SHIFT;
+    sb->slots = malloc(sb->num_mem_pages * sizeof sb->slots[0]);
+    if (sb->slots == NULL) {
+        free(sb);
+        *sbuf = NULL;
+        return CuErrMsg(err, "Unable to allocate store-buffer slots.");
+    }
+    for (uint32_t p = 0; p < sb->num_mem_pages; p++) {
+        sb->slots[p] = NO_SLOT;
+    }
+    sb->num_used = 0;
+    memset(sb->dirty, 0, sizeof sb->dirty);
+    return true;
+}
+
+void CuSbufDestroy(CuStoreBuf* restrict sbuf) {
+    if (sbuf != NULL) {
+        free(sbuf->slots);
+        free(sbuf);
+    }
+}
+
+static inline int GetSlot(const CuStoreBuf* restrict sbuf, uint32_t addr) {
+    const uint32_t page = addr >> CU_MEM_PAGE_SHIFT;
+    return page < sbuf->num_mem_pages ? sbuf->slots[page] : NO_SLOT;
+}
+
+// Whether any of the `nbytes` bytes from `addr` onwards are in pages with
+// private copies, in which case they must be read from there.
+static inline bool IsBuffered(const CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint32_t nbytes) {
+    return sbuf->num_used > 0 && (GetSlot(sbuf, addr) != NO_SLOT ||
+      GetSlot(sbuf, addr + nbytes - 1U) != NO_SLOT);
+}
+
+static bool IsValidRange(uint32_t addr, uint32_t nbytes,
+  CuError* restrict err) {
+    RET_ON_ERR(CuIsValidPhyMemAddr(addr, err) &&
+      CuIsValidPhyMemAddr(addr + nbytes - 1U, err));
+    if (addr + nbytes - 1U < addr) {
+        return CuErrMsg(err, "Bad memory-address (0x%08" PRIx32 ").", addr);
+    }
+    return true;
+}
+
+static bool ReadBytes(const CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint32_t nbytes, uint8_t* restrict bytes, CuError* restrict err) {
+    RET_ON_ERR(IsValidRange(addr, nbytes, err));
+    for (uint32_t i = 0; i < nbytes; i++) {
+        const uint32_t a = addr + i;
+        const int slot = GetSlot(sbuf, a);
+        if (slot != NO_SLOT) {
+            bytes[i] = sbuf->data[slot][a & (CU_MEM_PAGE_SIZE - 1U)];
+        } else {
+            RET_ON_ERR(CuGetByteAt(a, &bytes[i], err));
+        }
+    }
+    return true;
+}
+
+static bool WriteBytes(CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint32_t nbytes, const uint8_t* restrict bytes, CuError* restrict err) {
+    RET_ON_ERR(IsValidRange(addr, nbytes, err));
+    for (uint32_t i = 0; i < nbytes; i++) {
+        const uint32_t a = addr + i;
+        const uint32_t page = a >> CU_MEM_PAGE_SHIFT;
+        int slot = sbuf->slots[page];
+        if (slot == NO_SLOT) {
+            if (sbuf->num_used == CU_SBUF_MAX_PAGES) {
+                return CuErrMsg(err, "Store-buffer overflow.");
+            }
+            slot = sbuf->num_used++;
+            sbuf->slots[page] = (int16_t)slot;
+            sbuf->page_nums[slot] = page;
+            RET_ON_ERR(CuReadMemRange(page << CU_MEM_PAGE_SHIFT,
+              CU_MEM_PAGE_SIZE, sbuf->data[slot], err));
+        }
+        const uint32_t off = a & (CU_MEM_PAGE_SIZE - 1U);
+        sbuf->data[slot][off] = bytes[i];
+        sbuf->dirty[slot][off >> 3] |= (uint8_t)(1U << (off & 7U));
+    }
+    return true;
+}
+
+bool CuSbufGetByteAt(const CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint8_t* restrict val, CuError* restrict err) {
+    if (!IsBuffered(sbuf, addr, 1U)) {
+        return CuGetByteAt(addr, val, err);
+    }
+    RET_ON_ERR(ReadBytes(sbuf, addr, 1U, val, err));
+    return true;
+}
+
+bool CuSbufGetHalfWordAt(const CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint16_t* restrict val, CuError* restrict err) {
+    if (!IsBuffered(sbuf, addr, 2U)) {
+        return CuGetHalfWordAt(addr, val, err);
+    }
+    uint8_t bytes[2];
+    RET_ON_ERR(ReadBytes(sbuf, addr, 2U, bytes, err));
+    *val = (uint16_t)(bytes[0]) | ((uint16_t)(bytes[1]) << 8);
+    return true;
+}
+
+bool CuSbufGetWordAt(const CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint32_t* restrict val, CuError* restrict err) {
+    if (!IsBuffered(sbuf, addr, 4U)) {
+        return CuGetWordAt(addr, val, err);
+    }
+    uint8_t bytes[4];
+    RET_ON_ERR(ReadBytes(sbuf, addr, 4U, bytes, err));
+    *val = (uint32_t)(bytes[0]) | ((uint32_t)(bytes[1]) << 8) |
+      ((uint32_t)(bytes[2]) << 16) | ((uint32_t)(bytes[3]) << 24);
+    return true;
+}
+
+bool CuSbufSetByteAt(CuStoreBuf* restrict sbuf, uint32_t addr, uint8_t val,
+  CuError* restrict err) {
+    RET_ON_ERR(WriteBytes(sbuf, addr, 1U, &val, err));
+    return true;
+}
+
+bool CuSbufSetHalfWordAt(CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint16_t val, CuError* restrict err) {
+    const uint8_t bytes[2] = {
+        (uint8_t)(val & 0x00FFU), (uint8_t)((val & 0xFF00U) >> 8),
+    };
+    RET_ON_ERR(WriteBytes(sbuf, addr, 2U, bytes, err));
+    return true;
+}
+
+bool CuSbufSetWordAt(CuStoreBuf* restrict sbuf, uint32_t addr, uint32_t val,
+  CuError* restrict err) {
+    const uint8_t bytes[4] = {
+        (uint8_t)(val & 0x000000FFU), (uint8_t)((val & 0x0000FF00U) >> 8),
+        (uint8_t)((val & 0x00FF0000U) >> 16),
+        (uint8_t)((val & 0xFF000000U) >> 24),
+    };
+    RET_ON_ERR(WriteBytes(sbuf, addr, 4U, bytes, err));
+    return true;
+}
+
+bool CuSbufIsFull(const CuStoreBuf* restrict sbuf) {
+    // An unaligned store can straddle two pages.
+    return sbuf->num_used > CU_SBUF_MAX_PAGES - 2;
+}
+
+bool CuSbufCommit(CuStoreBuf* restrict sbuf, CuSbufCommitFn fn, void* data,
+  CuError* restrict err) {
+    for (int slot = 0; slot < sbuf->num_used; slot++) {
+        const uint32_t base = sbuf->page_nums[slot] << CU_MEM_PAGE_SHIFT;
+        const uint8_t* dirty = sbuf->dirty[slot];
+        uint32_t off = 0;
+        while (off < CU_MEM_PAGE_SIZE) {
+            if (dirty[off >> 3] == 0 && (off & 7U) == 0) {
+                off += 8U;
+                continue;
+            }
+            if (!(dirty[off >> 3] & (1U << (off & 7U)))) {
+                off++;
+                continue;
+            }
+            const uint32_t start = off;
+            while (off < CU_MEM_PAGE_SIZE &&
+              (dirty[off >> 3] & (1U << (off & 7U)))) {
+                off++;
+            }
+            RET_ON_ERR(CuWriteMemRange(base + start, off - start,
+              sbuf->data[slot] + start, err));
+            if (fn != NULL) {
+                fn(data, base + start, off - start);
+            }
+        }
+        memset(sbuf->dirty[slot], 0, PAGE_MASK_SIZE);
+        sbuf->slots[sbuf->page_nums[slot]] = NO_SLOT;
+    }
+    sbuf->num_used = 0;
+    return true;
+}
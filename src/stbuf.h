@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_STBUF_INCLUDED
+#define CUSS_STBUF_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "errors.h"
+
+// A store-buffer holds the stores made by a core during a quantum of the
+// deterministic scheduler, keeping them private to that core until they are
+// committed to memory at the end of the quantum. Loads through it see the
+// stores of the same core along with memory as of the start of the quantum.
+//
+// It holds private copies of up to `CU_SBUF_MAX_PAGES` pages of memory.
+typedef struct CuStoreBuf CuStoreBuf;
+
+#define CU_SBUF_MAX_PAGES 32
+
+extern bool CuSbufCreate(CuStoreBuf** restrict sbuf, CuError* restrict err);
+extern void CuSbufDestroy(CuStoreBuf* restrict sbuf);
+
+extern bool CuSbufGetByteAt(const CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint8_t* restrict val, CuError* restrict err);
+extern bool CuSbufGetHalfWordAt(const CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint16_t* restrict val, CuError* restrict err);
+extern bool CuSbufGetWordAt(const CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint32_t* restrict val, CuError* restrict err);
+
+extern bool CuSbufSetByteAt(CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint8_t val, CuError* restrict err);
+extern bool CuSbufSetHalfWordAt(CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint16_t val, CuError* restrict err);
+extern bool CuSbufSetWordAt(CuStoreBuf* restrict sbuf, uint32_t addr,
+  uint32_t val, CuError* restrict err);
+
+// Whether the store-buffer might not have room for the pages of another store,
+// so that it must be committed first.
+extern bool CuSbufIsFull(const CuStoreBuf* restrict sbuf);
+
+// The type of a function called by `CuSbufCommit()` for every run of `nbytes`
+// bytes from `addr` onwards that it writes to memory.
+typedef void (*CuSbufCommitFn)(void* data, uint32_t addr, uint32_t nbytes);
+
+// Write the bytes stored into the store-buffer to memory, in the order in
+// which their pages were first stored to, and empty it.
+extern bool CuSbufCommit(CuStoreBuf* restrict sbuf, CuSbufCommitFn fn,
+  void* data, CuError* restrict err);
+
+#endif  // CUSS_STBUF_INCLUDED
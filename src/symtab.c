@@ -0,0 +1,248 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#include "symtab.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The addresses of the symbols in ascending order, along with the offsets of
+// their names in `sym_names`, kept apart so that searches only touch the
+// addresses.
+static uint32_t* sym_addrs = NULL;
+static uint32_t* sym_name_offs = NULL;
+static char* sym_names = NULL;
+static uint32_t num_symbols = 0;
+
+typedef struct Symbol {
+    uint32_t addr;
+    uint32_t name_off;
+} Symbol;
+
+// Order symbols by address, and symbols with the same address as they appear
+// in the map-file.
+static int CompareSymbols(const void* a, const void* b) {
+    const Symbol* sa = a;
+    const Symbol* sb = b;
+    if (sa->addr != sb->addr) {
+        return (sa->addr < sb->addr) ? -1 : 1;
+    }
+    return (sa->name_off < sb->name_off) ? -1 : (sa->name_off > sb->name_off);
+}
+
+// Return the number of symbols at or before `addr`.
+static inline uint32_t CountSymsUpTo(uint32_t addr) {
+    if (num_symbols == 0) {
+        return 0;
+    }
+    const uint32_t* base = sym_addrs;
+    uint32_t n = num_symbols;
+    while (n > 1) {
+        const uint32_t half = n / 2;
+        base = (base[half] <= addr) ? base + half : base;
+        n -= half;
+    }
+    return (uint32_t)(base - sym_addrs) + (base[0] <= addr);
+}
+
+// Parse a "<addr> <name>" line into `addr` and `name`, returning false for an
+// empty line or a comment, and failing for anything else.
+static bool ParseLine(char* restrict line, uint32_t line_num,
+  uint32_t* restrict addr, char** restrict name, bool* restrict ok,
+  CuError* restrict err) {
+    *ok = true;
+    char* hash = strchr(line, '#');
+    if (hash != NULL) {
+        *hash = '\0';
+    }
+    char* p = line;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p == '\0') {
+        return false;
+    }
+
+    char* end = NULL;
+    const unsigned long val = strtoul(p, &end, 16);
+    if (end == p || !isspace((unsigned char)*end) || val > UINT32_MAX) {
+        *ok = CuErrMsg(err, "Bad address on line %" PRIu32 ".", line_num);
+        return false;
+    }
+    p = end;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    char* start = p;
+    while (isalnum((unsigned char)*p) || *p == '_' || *p == '.') {
+        p++;
+    }
+    end = p;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (end == start || isdigit((unsigned char)*start) || *p != '\0') {
+        *ok = CuErrMsg(err, "Bad name on line %" PRIu32 ".", line_num);
+        return false;
+    }
+    if (end - start >= CU_SYM_MAX_NAME) {
+        *ok = CuErrMsg(err, "Name too long on line %" PRIu32 ".", line_num);
+        return false;
+    }
+    *end = '\0';
+    *addr = (uint32_t)val;
+    *name = start;
+    return true;
+}
+
+// Read the symbols in `f` into `syms` and their names into `names`.
+static bool ReadSymbols(FILE* restrict f, Symbol** restrict syms,
+  uint32_t* restrict num_syms, char** restrict names, CuError* restrict err) {
+    uint32_t syms_cap = 0;
+    size_t names_len = 0;
+    size_t names_cap = 0;
+    uint32_t line_num = 0;
+#define MAX_LINE_SIZE 128
+    char line[MAX_LINE_SIZE];
+    while (fgets(line, MAX_LINE_SIZE, f) != NULL) {
+#undef MAX_LINE_SIZE
+        line_num++;
+        uint32_t addr;
+        char* name;
+        bool ok;
+        if (!ParseLine(line, line_num, &addr, &name, &ok, err)) {
+            RET_ON_ERR(ok);
+            continue;
+        }
+
+        if (*num_syms == syms_cap) {
+            syms_cap = (syms_cap == 0) ? 256 : 2 * syms_cap;
+            Symbol* new_syms = realloc(*syms, syms_cap * sizeof **syms);
+            if (new_syms == NULL) {
+                return CuErrMsg(err, "Could not allocate symbols.");
+            }
+            *syms = new_syms;
+        }
+        const size_t name_len = strlen(name) + 1;
+        if (names_len + name_len > names_cap) {
+            names_cap = (names_cap == 0) ? 4096 : 2 * names_cap;
+            char* new_names = realloc(*names, names_cap);
+            if (new_names == NULL) {
+                return CuErrMsg(err, "Could not allocate symbol-names.");
+            }
+            *names = new_names;
+        }
+        memcpy(*names + names_len, name, name_len);
+        (*syms)[*num_syms].addr = addr;
+        (*syms)[*num_syms].name_off = (uint32_t)names_len;
+        (*num_syms)++;
+        names_len += name_len;
+    }
+    if (ferror(f)) {
+        return CuErrMsg(err, "Error reading file.");
+    }
+    return true;
+}
+
+bool CuLoadSymbols(const char* restrict file, uint32_t* restrict num_syms,
+  CuError* restrict err) {
+    if (file == NULL) {
+        return CuErrMsg(err, "Missing file-name.");
+    }
+    FILE* f = fopen(file, "r");
+    if (f == NULL) {
+        return CuErrMsg(err, "Could not open file (%s).", strerror(errno));
+    }
+    Symbol* syms = NULL;
+    char* names = NULL;
+    uint32_t n = 0;
+    const bool read_ok = ReadSymbols(f, &syms, &n, &names, err);
+    fclose(f);
+    uint32_t* addrs = read_ok ? malloc((n + 1) * sizeof addrs[0]) : NULL;
+    uint32_t* name_offs = read_ok ? malloc((n + 1) * sizeof name_offs[0]) :
+      NULL;
+    if (addrs == NULL || name_offs == NULL) {
+        free(syms);
+        free(names);
+        free(addrs);
+        free(name_offs);
+        return read_ok ? CuErrMsg(err, "Could not allocate symbols.") : false;
+    }
+
+    // Keep only the first symbol for an address.
+    qsort(syms, n, sizeof syms[0], CompareSymbols);
+    uint32_t num_uniq = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (num_uniq > 0 && addrs[num_uniq - 1] == syms[i].addr) {
+            continue;
+        }
+        addrs[num_uniq] = syms[i].addr;
+        name_offs[num_uniq] = syms[i].name_off;
+        num_uniq++;
+    }
+    free(syms);
+
+    CuClearSymbols();
+    sym_addrs = addrs;
+    sym_name_offs = name_offs;
+    sym_names = names;
+    num_symbols = num_uniq;
+    *num_syms = num_uniq;
+    return true;
+}
+
+void CuClearSymbols(void) {
+    free(sym_addrs);
+    free(sym_name_offs);
+    free(sym_names);
+    sym_addrs = NULL;
+    sym_name_offs = NULL;
+    sym_names = NULL;
+    num_symbols = 0;
+}
+
+uint32_t CuGetNumSymbols(void) {
+    return num_symbols;
+}
+
+const char* CuFindSymbol(uint32_t addr, uint32_t* restrict sym_addr) {
+    const uint32_t n = CountSymsUpTo(addr);
+    if (n == 0) {
+        return NULL;
+    }
+    *sym_addr = sym_addrs[n - 1];
+    return sym_names + sym_name_offs[n - 1];
+}
+
+bool CuGetNextSymAddr(uint32_t addr, uint32_t* restrict next_addr) {
+    const uint32_t n = CountSymsUpTo(addr);
+    if (n == num_symbols) {
+        return false;
+    }
+    *next_addr = sym_addrs[n];
+    return true;
+}
+
+bool CuLookUpSymbol(const char* restrict name, uint32_t* restrict addr) {
+    for (uint32_t i = 0; i < num_symbols; i++) {
+        if (strcmp(sym_names + sym_name_offs[i], name) == 0) {
+            *addr = sym_addrs[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t CuPutSymAddr(uint32_t addr, char* restrict buf, size_t size) {
+    uint32_t sym_addr;
+    const char* name = CuFindSymbol(addr, &sym_addr);
+    if (name == NULL || size == 0) {
+        return 0;
+    }
+    const int len = (addr == sym_addr) ? snprintf(buf, size, "%s", name) :
+      snprintf(buf, size, "%s+0x%" PRIx32, name, addr - sym_addr);
+    return ((size_t)len < size) ? (size_t)len : size - 1;
+}
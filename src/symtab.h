@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_SYMTAB_INCLUDED
+#define CUSS_SYMTAB_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errors.h"
+
+// A table of symbols (names for memory-addresses), loaded from a map-file with
+// one "<addr> <name>" line per symbol, where <addr> is hexadecimal and '#'
+// starts a comment. The addresses are kept sorted in an array of their own, so
+// that finding the symbol for an address is a branch-free binary search
+// touching few cache-lines.
+
+// The maximum length of the name of a symbol, including the terminal NUL.
+#define CU_SYM_MAX_NAME 32
+
+// Load the symbols in `file`, replacing the symbols loaded previously, if any,
+// and set `num_syms` to their number.
+extern bool CuLoadSymbols(const char* restrict file,
+  uint32_t* restrict num_syms, CuError* restrict err);
+extern void CuClearSymbols(void);
+extern uint32_t CuGetNumSymbols(void);
+
+// Return the name of the symbol at or closest before `addr` and set `sym_addr`
+// to its address, or return NULL if there is no such symbol.
+extern const char* CuFindSymbol(uint32_t addr, uint32_t* restrict sym_addr);
+
+// Set `next_addr` to the address of the first symbol after `addr`, returning
+// false if there is no such symbol.
+extern bool CuGetNextSymAddr(uint32_t addr, uint32_t* restrict next_addr);
+
+// Set `addr` to the address of the symbol named `name`, returning false if
+// there is no such symbol.
+extern bool CuLookUpSymbol(const char* restrict name, uint32_t* restrict addr);
+
+// Write `addr` as "<name>" or "<name>+0x<offset>" into `buf`, returning the
+// length of the text, which is zero if there is no symbol for `addr`.
+extern size_t CuPutSymAddr(uint32_t addr, char* restrict buf, size_t size);
+
+#endif  // CUSS_SYMTAB_INCLUDED
@@ -0,0 +1,168 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+// Needed for `nanosleep()`.
+#define _POSIX_C_SOURCE 200809L
+
+#include "timing.h"
+
+#include "SDL_timer.h"
+#include <stddef.h>
+#include <time.h>
+
+// The number of MSBs identifying the primary op-code `op0`.
+#define NUM_OP0S (1 << 6)
+
+// The number of LSBs identifying the secondary op-code `op1`.
+#define NUM_OP1S (1 << 6)
+
+// Extract the `op0`, and `op1` fields from an instruction.
+#define GET_OP0(insn) (uint8_t)(((insn & 0xFC000000U) >> 26) & 0x0000003FU)
+#define GET_OP1(insn) (uint8_t)((insn) & 0x0000003FU)
+
+// Extra cycles taken by a load or a store from an unaligned memory-address.
+#define UNALIGNED_ACCESS_PENALTY 3U
+
+// Extra cycles taken to redirect instruction-fetch for a jump or a branch.
+#define TAKEN_BRANCH_PENALTY 2U
+
+#define NANOS_PER_SEC 1000000000LLU
+
+// How far a paced core may fall behind host-time before it is no longer
+// allowed to catch up.
+#define MAX_PACE_LAG_NS 100000000U
+
+// The number of cycles taken by each instruction, indexed by `op0` and `op1`.
+// Rows for instructions that do not use `op1` have the same latency in every
+// column, so that a look-up does not need to check the instruction-format.
+static uint8_t cup_op_cycles[NUM_OP0S][NUM_OP1S];
+
+static uint32_t cup_clock_hz = CU_DEF_CLOCK_HZ;
+static bool cup_paced = false;
+
+// Host-time spent executing instructions, excluding time spent paused.
+static uint64_t host_ns = 0;
+static uint64_t host_start_ns = 0;
+
+static void SetOp0Cycles(uint8_t op0, uint8_t cycles) {
+    for (int i = 0; i < NUM_OP1S; i++) {
+        cup_op_cycles[op0][i] = cycles;
+    }
+}
+
+void CuTimInit(uint32_t clock_hz) {
+    for (int i = 0; i < NUM_OP0S; i++) {
+        SetOp0Cycles(i, 1U);
+    }
+
+    // MULR, MULF, DIVR, and DIVF are multi-cycle operations.
+    cup_op_cycles[0x00][0x18] = 4U;
+    cup_op_cycles[0x00][0x19] = 4U;
+    cup_op_cycles[0x00][0x1a] = 20U;
+    cup_op_cycles[0x00][0x1b] = 20U;
+
+    // LDWD, LDHS, LDHU, LDBS, and LDBU need an extra cycle to access memory.
+    for (uint8_t op0 = 0x0e; op0 <= 0x12; op0++) {
+        SetOp0Cycles(op0, 2U);
+    }
+
+    // So do LDLW and STCW.
+    SetOp0Cycles(0x16, 2U);
+    SetOp0Cycles(0x17, 2U);
+
+    cup_clock_hz = (clock_hz == 0) ? CU_DEF_CLOCK_HZ : clock_hz;
+    cup_paced = false;
+    host_ns = 0;
+    host_start_ns = 0;
+}
+
+void CuTimSetClock(uint32_t clock_hz, bool paced) {
+    cup_clock_hz = (clock_hz == 0) ? CU_DEF_CLOCK_HZ : clock_hz;
+    cup_paced = paced;
+}
+
+bool CuTimIsPaced(void) {
+    return cup_paced;
+}
+
+uint32_t CuTimGetOpCycles(uint32_t insn) {
+    return cup_op_cycles[GET_OP0(insn)][GET_OP1(insn)];
+}
+
+void CuTimCountOp(CuTimCounters* restrict ctrs, uint32_t insn) {
+    ctrs->insns++;
+    ctrs->cycles += cup_op_cycles[GET_OP0(insn)][GET_OP1(insn)];
+}
+
+void CuTimUnalignedAccess(CuTimCounters* restrict ctrs) {
+    ctrs->cycles += UNALIGNED_ACCESS_PENALTY;
+}
+
+void CuTimTakenBranch(CuTimCounters* restrict ctrs) {
+    ctrs->cycles += TAKEN_BRANCH_PENALTY;
+}
+
+uint64_t CuTimGetHostNs(void) {
+    const uint64_t ctr = SDL_GetPerformanceCounter();
+    const uint64_t freq = SDL_GetPerformanceFrequency();
+    // Split the conversion to avoid overflowing for large counter-values.
+    return (ctr / freq) * NANOS_PER_SEC + (ctr % freq) * NANOS_PER_SEC / freq;
+}
+
+void CuTimStartPacer(CuTimPacer* restrict pacer,
+  const CuTimCounters* restrict ctrs) {
+    pacer->base_ns = CuTimGetHostNs();
+    pacer->base_cycles = ctrs->cycles;
+}
+
+bool CuTimPace(CuTimPacer* restrict pacer,
+  const CuTimCounters* restrict ctrs) {
+    const uint64_t cycles = ctrs->cycles - pacer->base_cycles;
+    // Split the conversion to avoid overflowing for large cycle-counts.
+    const uint64_t due_ns = pacer->base_ns +
+      (cycles / cup_clock_hz) * NANOS_PER_SEC +
+      (cycles % cup_clock_hz) * NANOS_PER_SEC / cup_clock_hz;
+    const uint64_t now_ns = CuTimGetHostNs();
+    if (now_ns >= due_ns) {
+        if (now_ns - due_ns > MAX_PACE_LAG_NS) {
+            CuTimStartPacer(pacer, ctrs);
+        }
+        return true;
+    }
+    uint64_t sleep_ns = due_ns - now_ns;
+    const bool caught_up = sleep_ns <= CU_TIM_MAX_PACE_NS;
+    if (!caught_up) {
+        sleep_ns = CU_TIM_MAX_PACE_NS;
+    }
+    const struct timespec req = {
+        .tv_sec = 0, .tv_nsec = (long)sleep_ns,
+    };
+    nanosleep(&req, NULL);
+    return caught_up;
+}
+
+void CuTimStartHostClock(void) {
+    if (host_start_ns == 0) {
+        host_start_ns = CuTimGetHostNs();
+    }
+}
+
+void CuTimStopHostClock(void) {
+    if (host_start_ns != 0) {
+        host_ns += CuTimGetHostNs() - host_start_ns;
+        host_start_ns = 0;
+    }
+}
+
+void CuTimGetStats(const CuTimCounters* restrict ctrs,
+  CuTimingStats* restrict stats) {
+    if (ctrs == NULL || stats == NULL) {
+        return;
+    }
+    stats->insns = ctrs->insns;
+    stats->cycles = ctrs->cycles;
+    stats->host_ns = host_ns;
+    if (host_start_ns != 0) {
+        stats->host_ns += CuTimGetHostNs() - host_start_ns;
+    }
+    stats->clock_hz = cup_clock_hz;
+}
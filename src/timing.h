@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: Copyright (c) 2022 Ranjit Mathew.
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CUSS_TIMING_INCLUDED
+#define CUSS_TIMING_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The default clock-rate of the simulated CUP core.
+#define CU_DEF_CLOCK_HZ 1000000000U
+
+// A snapshot of the cycle-accounting done by the timing-model.
+typedef struct CuTimingStats {
+    uint64_t insns;
+    uint64_t cycles;
+    uint64_t host_ns;
+    uint32_t clock_hz;
+} CuTimingStats;
+
+// The cycle-accounting done by the timing-model for a single CUP core.
+typedef struct CuTimCounters {
+    uint64_t insns;
+    uint64_t cycles;
+} CuTimCounters;
+
+extern void CuTimInit(uint32_t clock_hz);
+
+// Change the clock-rate of the simulated CUP cores, and whether to pace their
+// execution so that simulated time keeps up with (but does not run ahead of)
+// host-time.
+extern void CuTimSetClock(uint32_t clock_hz, bool paced);
+extern bool CuTimIsPaced(void);
+
+extern uint32_t CuTimGetOpCycles(uint32_t insn);
+extern void CuTimCountOp(CuTimCounters* restrict ctrs, uint32_t insn);
+extern void CuTimUnalignedAccess(CuTimCounters* restrict ctrs);
+extern void CuTimTakenBranch(CuTimCounters* restrict ctrs);
+
+extern uint64_t CuTimGetHostNs(void);
+extern void CuTimStartHostClock(void);
+extern void CuTimStopHostClock(void);
+
+// Paces a core that executes instructions in batches, from the cycles counted
+// in `ctrs` when started.
+typedef struct CuTimPacer {
+    uint64_t base_ns;
+    uint64_t base_cycles;
+} CuTimPacer;
+
+extern void CuTimStartPacer(CuTimPacer* restrict pacer,
+  const CuTimCounters* restrict ctrs);
+
+// Sleep until host-time catches up with the simulated time in `ctrs`, for at
+// most `CU_TIM_MAX_PACE_NS` nanoseconds at a time so that the caller stays
+// responsive, returning whether host-time has caught up. A core that has
+// fallen far behind is not allowed to catch up in a burst.
+#define CU_TIM_MAX_PACE_NS 10000000U
+extern bool CuTimPace(CuTimPacer* restrict pacer,
+  const CuTimCounters* restrict ctrs);
+
+// Fill `stats` with the given counters, along with the host-time spent.
+extern void CuTimGetStats(const CuTimCounters* restrict ctrs,
+  CuTimingStats* restrict stats);
+
+#endif  // CUSS_TIMING_INCLUDED